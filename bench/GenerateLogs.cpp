@@ -0,0 +1,137 @@
+#include <charconv>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "LogGenerator.h"
+
+void PrintUsage()
+{
+  std::cout << "Usage: JerryParserLogGen [options] output(.log|.log.gz)\n"
+               "  --size N[K|M|G]   approximate uncompressed size (default: 16M)\n"
+               "  --density P       probability that a line is a Jerry Talisman purchase (default: 0.001)\n"
+               "  --no-color        strip the color codes from the other chat lines\n"
+               "  --seed N          random seed (default: 1)\n"
+               "  --adversarial     make half of the purchases malformed or edge cases (for JerryParserFuzz)\n";
+}
+
+template <typename T> bool ParseValue(std::string_view text, T &value)
+{
+  auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  return ec == std::errc{} && ptr == text.data() + text.size();
+}
+
+bool ParseSize(std::string_view text, size_t &size)
+{
+  size_t unit = 1;
+  if (!text.empty())
+  {
+    switch (text.back())
+    {
+    case 'K':
+    case 'k':
+      unit = 1024;
+      break;
+    case 'M':
+    case 'm':
+      unit = 1024 * 1024;
+      break;
+    case 'G':
+    case 'g':
+      unit = 1024 * 1024 * 1024;
+      break;
+    }
+    if (unit != 1)
+    {
+      text.remove_suffix(1);
+    }
+  }
+  if (!ParseValue(text, size))
+  {
+    return false;
+  }
+  size *= unit;
+  return true;
+}
+
+/**
+ * ベンチマーク用の合成ログを書き出すツール
+ * 出力先が .gz で終わる場合は gzip 形式で書き込む
+ */
+int main(int argc, char *argv[])
+{
+  LogGeneratorOptions options;
+  std::string output;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string_view arg = argv[i];
+    bool hasNext = i + 1 < argc;
+
+    if (arg == "--size" && hasNext)
+    {
+      if (!ParseSize(argv[++i], options.size))
+      {
+        std::cerr << "Invalid size: " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (arg == "--density" && hasNext)
+    {
+      if (!ParseValue<double>(argv[++i], options.purchaseDensity))
+      {
+        std::cerr << "Invalid density: " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (arg == "--no-color")
+    {
+      options.colorCodes = false;
+    }
+    else if (arg == "--adversarial")
+    {
+      options.adversarial = true;
+    }
+    else if (arg == "--seed" && hasNext)
+    {
+      if (!ParseValue<uint64_t>(argv[++i], options.seed))
+      {
+        std::cerr << "Invalid seed: " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (arg == "--help" || arg == "-h")
+    {
+      PrintUsage();
+      return 0;
+    }
+    else if (arg.starts_with("-") || !output.empty())
+    {
+      PrintUsage();
+      return 1;
+    }
+    else
+    {
+      output = arg;
+    }
+  }
+
+  if (output.empty())
+  {
+    PrintUsage();
+    return 1;
+  }
+
+  bool gzip = output.ends_with(".gz");
+  std::string content = GenerateSyntheticLog(options);
+  if (!WriteSyntheticLog(output, content, gzip))
+  {
+    std::cerr << "could not write: " << output << std::endl;
+    return 1;
+  }
+
+  std::cout << "Wrote " << content.size() << " bytes" << (gzip ? " (before compression)" : "") << " to " << output
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Format.h"
+#include "GzipDecoder.h"
+#include "LogFile.h"
+#include "LogGenerator.h"
+#include "Purchase.h"
+#include "PurchaseScanner.h"
+
+namespace
+{
+
+// 1ファイルあたりのサイズ（展開後の latest.log 程度）
+constexpr size_t kCorpusSize = 8 * 1024 * 1024;
+
+/**
+ * 購入メッセージが 1 / inverseDensity 行ごとに現れる合成ログ（毎回生成しないようにプロセス内で使い回す）
+ */
+const std::string &Corpus(int64_t inverseDensity)
+{
+  static std::map<int64_t, std::string> corpora;
+  auto it = corpora.find(inverseDensity);
+  if (it == corpora.end())
+  {
+    LogGeneratorOptions options;
+    options.size = kCorpusSize;
+    options.purchaseDensity = 1.0 / static_cast<double>(inverseDensity);
+    it = corpora.emplace(inverseDensity, GenerateSyntheticLog(options)).first;
+  }
+  return it->second;
+}
+
+/**
+ * 合成ログを一時ディレクトリへ書き出したファイルのパス
+ */
+const std::string &CorpusFile(bool gzip)
+{
+  static std::map<bool, std::string> files;
+  auto it = files.find(gzip);
+  if (it == files.end())
+  {
+    std::filesystem::path path = std::filesystem::temp_directory_path() / "JerryParserBench";
+    std::filesystem::create_directories(path);
+    path /= gzip ? "corpus.log.gz" : "corpus.log";
+    WriteSyntheticLog(path.string(), Corpus(1000), gzip);
+    it = files.emplace(gzip, path.string()).first;
+  }
+  return it->second;
+}
+
+/**
+ * ローテーション済みログを模した小さなファイル count 個のパス
+ */
+const std::vector<std::string> &SmallCorpusFiles(bool gzip, size_t count)
+{
+  static std::map<bool, std::vector<std::string>> files;
+  auto it = files.find(gzip);
+  if (it == files.end())
+  {
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "JerryParserBench" / "small";
+    std::filesystem::create_directories(directory);
+    LogGeneratorOptions options;
+    options.size = 16 * 1024;
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < count; i++)
+    {
+      options.seed = i + 1;
+      std::filesystem::path path = directory / (std::to_string(i) + (gzip ? ".log.gz" : ".log"));
+      WriteSyntheticLog(path.string(), GenerateSyntheticLog(options), gzip);
+      paths.push_back(path.string());
+    }
+    it = files.emplace(gzip, std::move(paths)).first;
+  }
+  return it->second;
+}
+
+void BM_IsGzCompressed(benchmark::State &state)
+{
+  const std::string &path = CorpusFile(state.range(0) != 0);
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(IsGzCompressed(path));
+  }
+}
+BENCHMARK(BM_IsGzCompressed)->ArgName("gzip")->Arg(0)->Arg(1);
+
+void BM_ReadFile(benchmark::State &state)
+{
+  const std::string &path = CorpusFile(state.range(0) != 0);
+  for (auto _ : state)
+  {
+    std::optional<std::string> content = ReadFile(path);
+    benchmark::DoNotOptimize(content);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(Corpus(1000).size()));
+}
+BENCHMARK(BM_ReadFile)->ArgName("gzip")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+void BM_MappedFile(benchmark::State &state)
+{
+  const std::string &path = CorpusFile(false);
+  for (auto _ : state)
+  {
+    MappedFile file(path);
+    benchmark::DoNotOptimize(file.View().data());
+  }
+}
+BENCHMARK(BM_MappedFile);
+
+void BM_FindSubstring(benchmark::State &state)
+{
+  const std::string &corpus = Corpus(state.range(0));
+  for (auto _ : state)
+  {
+    size_t count = 0;
+    for (size_t pos = 0; (pos = FindSubstring(corpus, "You purchased ", pos)) != std::string::npos; pos++)
+    {
+      count++;
+    }
+    benchmark::DoNotOptimize(count);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(corpus.size()));
+}
+BENCHMARK(BM_FindSubstring)
+    ->ArgName("linesPerPurchase")
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_FindCandidateLine(benchmark::State &state)
+{
+  const std::string &corpus = Corpus(state.range(0));
+  for (auto _ : state)
+  {
+    size_t count = 0;
+    size_t pos = 0;
+    std::string_view line;
+    while (FindCandidateLine(corpus, pos, line))
+    {
+      pos = static_cast<size_t>(line.data() + line.size() - corpus.data());
+      count++;
+    }
+    benchmark::DoNotOptimize(count);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(corpus.size()));
+}
+BENCHMARK(BM_FindCandidateLine)
+    ->ArgName("linesPerPurchase")
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_ExtractJerryPurchases(benchmark::State &state)
+{
+  const std::string &corpus = Corpus(state.range(0));
+  size_t purchases = 0;
+  for (auto _ : state)
+  {
+    PurchaseColumns result = ExtractJerryPurchases(corpus);
+    purchases = result.Size();
+    benchmark::DoNotOptimize(result.Costs().data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(corpus.size()));
+  state.counters["purchases"] = static_cast<double>(purchases);
+}
+BENCHMARK(BM_ExtractJerryPurchases)
+    ->ArgName("linesPerPurchase")
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_ScanJerryPurchases(benchmark::State &state)
+{
+  const std::string &corpus = Corpus(state.range(0));
+  for (auto _ : state)
+  {
+    PurchaseSummary summary;
+    PurchaseSummarySink sink(summary);
+    ScanJerryPurchases(corpus, sink);
+    benchmark::DoNotOptimize(summary);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(corpus.size()));
+}
+BENCHMARK(BM_ScanJerryPurchases)
+    ->ArgName("linesPerPurchase")
+    ->Arg(100)
+    ->Arg(1000)
+    ->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
+
+void BM_PurchaseStreamScanner(benchmark::State &state)
+{
+  const std::string &corpus = Corpus(1000);
+  size_t chunkSize = static_cast<size_t>(state.range(0));
+  for (auto _ : state)
+  {
+    PurchaseStreamScanner scanner;
+    std::string_view rest = corpus;
+    while (!rest.empty())
+    {
+      size_t size = std::min(rest.size(), chunkSize);
+      scanner.Feed(rest.substr(0, size));
+      rest.remove_prefix(size);
+    }
+    scanner.Finish();
+    benchmark::DoNotOptimize(scanner.Purchases().Costs().data());
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(corpus.size()));
+}
+BENCHMARK(BM_PurchaseStreamScanner)->ArgName("chunk")->Arg(4096)->Arg(kStreamBufferSize)->Unit(benchmark::kMillisecond);
+
+void BM_ScanSmallFiles(benchmark::State &state)
+{
+  const std::vector<std::string> &paths = SmallCorpusFiles(state.range(0) != 0, 256);
+  std::unique_ptr<GzipDecoder> decoder = CreateGzipDecoder(InflateBackend::ZLIB);
+  for (auto _ : state)
+  {
+    PurchaseSummary summary;
+    PurchaseSummarySink sink(summary);
+    for (const std::string &path : paths)
+    {
+      ScanPurchasesFromFile(path, *decoder, ItemCatalog::Jerry(), sink);
+    }
+    benchmark::DoNotOptimize(summary);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(paths.size()));
+}
+BENCHMARK(BM_ScanSmallFiles)->ArgName("gzip")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+void BM_PurchaseSummary(benchmark::State &state)
+{
+  // 多数のプレイヤーのログを集計する場合を想定し、抽出結果を繰り返して件数を増やす
+  PurchaseColumns found = ExtractJerryPurchases(Corpus(100));
+  PurchaseColumns purchases;
+  while (purchases.Size() < static_cast<size_t>(state.range(0)))
+  {
+    purchases.Append(found);
+  }
+  for (auto _ : state)
+  {
+    PurchaseSummary summary;
+    summary.Add(purchases);
+    benchmark::DoNotOptimize(summary);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(purchases.Size()));
+}
+BENCHMARK(BM_PurchaseSummary)->ArgName("purchases")->Arg(1000)->Arg(1 << 20);
+
+void BM_FormatNumber(benchmark::State &state)
+{
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(FormatNumber(1234567890));
+  }
+}
+BENCHMARK(BM_FormatNumber);
+
+void BM_FormatCoins(benchmark::State &state)
+{
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(FormatCoins(1234567890));
+  }
+}
+BENCHMARK(BM_FormatCoins);
+
+void BM_FormatNumberToBuffer(benchmark::State &state)
+{
+  FormatBuffer buffer;
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(FormatNumber(1234567890, buffer));
+  }
+}
+BENCHMARK(BM_FormatNumberToBuffer);
+
+void BM_FormatCoinsToBuffer(benchmark::State &state)
+{
+  FormatBuffer buffer;
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(FormatCoins(1234567890, buffer));
+  }
+}
+BENCHMARK(BM_FormatCoinsToBuffer);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,263 @@
+#include "LogGenerator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+#include <zlib.h>
+
+namespace
+{
+
+// 行頭の "[HH:MM:SS] " の長さ
+constexpr size_t kTimestampSize = 11;
+
+// テンプレート中の '&' は §カラーコードの位置を表す
+constexpr std::string_view kSectionSign = "\xC2\xA7";
+
+constexpr std::string_view kSystemLines[] = {
+    "[Client thread/INFO]: Setting user: Player",
+    "[Client thread/INFO]: Reloading ResourceManager: Default, FMLFileResourcePack:Forge Mod Loader",
+    "[Client thread/WARN]: Unable to play unknown soundEvent: minecraft:note.harp",
+    "[Client thread/ERROR]: Couldn't render entity",
+    "[Netty Client IO #3/INFO]: Connecting to mc.hypixel.net., 25565",
+    "[Sound Library Loader/INFO]: Sound engine started",
+    "[Client thread/INFO]: [STDOUT]: Loaded 2163 auction items",
+};
+
+constexpr std::string_view kChatLines[] = {
+    "&r&7Sending to server mini12A...&r",
+    "&6[MVP&c++&6] Player&f: anyone selling jerry boxes?",
+    "&aYou have &e3 &aunclaimed &6Jerry Boxes&a!",
+    "&e[NPC] &fJerry&f: Welcome to Jerry's Workshop!",
+    "&r&eYour &aGreen Jerry Talisman &ehas been recombobulated!&r",
+    "&cYou need to be at least Rank [VIP] to use that command!",
+};
+
+// "You purchased" を含むが Jerry Talisman の購入ではない行
+constexpr std::string_view kNearMissLines[] = {
+    "&aYou purchased &fEnchanted Book &afor &61,000 coins&a!",
+    "&aYou purchased &5Jerry-chine Gun &afor &612,500,000 coins&a!",
+    "&aYou purchased &9Green Jerry Talisman &cbut the auction was cancelled",
+};
+
+struct JerryItem
+{
+  std::string_view color;
+  std::string_view kind;
+  // 通常時と Recombobulated 時のレアリティのカラーコード
+  char rarity;
+  char recombobulatedRarity;
+  long long minCost;
+  long long maxCost;
+};
+
+constexpr JerryItem kJerryItems[] = {
+    {"Green", "Talisman", 'a', '9', 50000, 400000},
+    {"Blue", "Talisman", '9', '5', 300000, 1500000},
+    {"Purple", "Talisman", '5', '6', 1000000, 6000000},
+    {"Golden", "Artifact", '6', 'd', 4000000, 30000000},
+};
+
+void AppendColored(std::string &out, std::string_view text, bool colorCodes)
+{
+  for (size_t i = 0; i < text.size(); i++)
+  {
+    if (text[i] != '&')
+    {
+      out += text[i];
+    }
+    else if (colorCodes)
+    {
+      out += kSectionSign;
+    }
+    else
+    {
+      // コードの文字ごと取り除く
+      i++;
+    }
+  }
+}
+
+void AppendWithCommas(std::string &out, long long value)
+{
+  std::string digits = std::to_string(value);
+  for (size_t i = 0; i < digits.size(); i++)
+  {
+    if (i > 0 && (digits.size() - i) % 3 == 0)
+    {
+      out += ',';
+    }
+    out += digits[i];
+  }
+}
+
+/**
+ * 照合の境界を突く購入メッセージの行を加える関数
+ * 大文字小文字の違う品目名、省略形・小数点・桁あふれ・カンマの位置が不正な数値、カラーコードの有無、
+ * 1行に複数の購入や余分な "for "・" coins"、途中で切れた行、時刻の無い行や CR の行末を混ぜる
+ * 行頭の時刻は書き込み済みであること
+ */
+void AppendAdversarialPurchase(std::string &out, std::mt19937_64 &rng)
+{
+  constexpr std::string_view kColors[] = {"Green", "Blue", "Purple", "PurPle", "Golden", "green", "Gold"};
+  constexpr std::string_view kKinds[] = {"Talisman", "Artifact", "Talismans", "Ring"};
+  constexpr std::string_view kRarities = "0123456789abcdef";
+  constexpr std::string_view kBeforeCosts[] = {"&6", "", "&a&6", " ", "x", "&", "&61"};
+  constexpr std::string_view kCosts[] = {"1,234",
+                                         "1234",
+                                         "1,2,3,4",
+                                         ",5",
+                                         "1.5m",
+                                         "2.25k",
+                                         "3.b",
+                                         ".5K",
+                                         "k",
+                                         "12.5",
+                                         "1.2.3k",
+                                         "007",
+                                         "1,000.5k",
+                                         "0",
+                                         "5M",
+                                         "1.2345678912b",
+                                         "99999999999999999999",
+                                         "9,223,372,036,854,775,807",
+                                         "9223372036.854775807b",
+                                         "12,345.6,7k"};
+  constexpr std::string_view kTails[] = {"&a!",
+                                         "",
+                                         " coins",
+                                         " for 5 coins",
+                                         "&a! You purchased &9Blue Jerry Talisman &afor &6100 coins",
+                                         " for &6",
+                                         "&a! for 3 coins&a!"};
+  auto pick = [&](size_t count) { return static_cast<size_t>(rng() % count); };
+
+  // 直前に書いた行頭の時刻を、無いものや範囲外のものに変えることもある
+  if (pick(8) == 0)
+  {
+    out.resize(out.size() - kTimestampSize);
+    out += pick(2) == 0 ? "[25:61:99] " : "";
+  }
+
+  std::string line = "[Client thread/INFO]: [CHAT] ";
+  line += pick(3) == 0 ? "You purchased " : "&aYou purchased ";
+  if (pick(6) == 0)
+  {
+    line += "&9Green Jerry Talisman &7and ";
+  }
+  if (pick(4) != 0)
+  {
+    line += '&';
+  }
+  line += kRarities[pick(kRarities.size())];
+  line += kColors[pick(std::size(kColors))];
+  line += " Jerry ";
+  line += kKinds[pick(std::size(kKinds))];
+  line += pick(6) == 0 ? "  " : " ";
+  line += pick(3) == 0 ? "for " : "&afor ";
+  line += kBeforeCosts[pick(std::size(kBeforeCosts))];
+  line += kCosts[pick(std::size(kCosts))];
+  line += " coins";
+  line += kTails[pick(std::size(kTails))];
+  if (pick(10) == 0)
+  {
+    line.resize(pick(line.size()));
+  }
+
+  AppendColored(out, line, true);
+  out += pick(8) == 0 ? (pick(2) == 0 ? "\r" : "\r\n") : "\n";
+}
+
+} // namespace
+
+std::string GenerateSyntheticLog(const LogGeneratorOptions &options)
+{
+  std::mt19937_64 rng(options.seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  auto pick = [&](size_t count) { return static_cast<size_t>(rng() % count); };
+
+  std::string out;
+  out.reserve(options.size + 256);
+
+  unsigned seconds = 0;
+  while (out.size() < options.size)
+  {
+    seconds = (seconds + pick(3)) % (24 * 60 * 60);
+    char timestamp[16];
+    std::snprintf(timestamp, sizeof(timestamp), "[%02u:%02u:%02u] ", seconds / 3600, seconds / 60 % 60, seconds % 60);
+    out += timestamp;
+
+    double r = unit(rng);
+    if (r < options.purchaseDensity && options.adversarial && pick(2) == 0)
+    {
+      AppendAdversarialPurchase(out, rng);
+      continue;
+    }
+    if (r < options.purchaseDensity)
+    {
+      const JerryItem &item = kJerryItems[pick(std::size(kJerryItems))];
+      bool recombobulated = pick(10) == 0;
+      std::uniform_int_distribution<long long> cost(item.minCost, item.maxCost);
+
+      out += "[Client thread/INFO]: [CHAT] ";
+      out += kSectionSign;
+      out += "aYou purchased ";
+      out += kSectionSign;
+      out += recombobulated ? item.recombobulatedRarity : item.rarity;
+      out += item.color;
+      out += " Jerry ";
+      out += item.kind;
+      out += ' ';
+      out += kSectionSign;
+      out += "afor ";
+      out += kSectionSign;
+      out += '6';
+      AppendWithCommas(out, cost(rng));
+      out += " coins";
+      out += kSectionSign;
+      out += "a!";
+    }
+    else if (r < options.purchaseDensity * 2)
+    {
+      out += "[Client thread/INFO]: [CHAT] ";
+      AppendColored(out, kNearMissLines[pick(std::size(kNearMissLines))], options.colorCodes);
+    }
+    else if (pick(10) < 3)
+    {
+      out += "[Client thread/INFO]: [CHAT] ";
+      AppendColored(out, kChatLines[pick(std::size(kChatLines))], options.colorCodes);
+    }
+    else
+    {
+      out += kSystemLines[pick(std::size(kSystemLines))];
+    }
+    out += '\n';
+  }
+  return out;
+}
+
+bool WriteSyntheticLog(const std::string &filePath, std::string_view content, bool gzip)
+{
+  if (!gzip)
+  {
+    std::ofstream file(filePath, std::ios::binary);
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    return static_cast<bool>(file);
+  }
+
+  gzFile file = gzopen(filePath.c_str(), "wb");
+  if (!file)
+  {
+    return false;
+  }
+  bool ok = true;
+  while (ok && !content.empty())
+  {
+    unsigned size = static_cast<unsigned>(std::min<size_t>(content.size(), 1 << 20));
+    ok = gzwrite(file, content.data(), size) == static_cast<int>(size);
+    content.remove_prefix(size);
+  }
+  return gzclose(file) == Z_OK && ok;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * 合成ログの生成条件
+ */
+struct LogGeneratorOptions
+{
+  // 生成するログのおおよそのサイズ（バイト）
+  size_t size = 16 * 1024 * 1024;
+  // 1行が Jerry Talisman の購入メッセージになる確率
+  double purchaseDensity = 0.001;
+  // 購入以外のチャット行にも §カラーコードを付けるか
+  // 購入メッセージはレアリティの判定にカラーコードを使うので常に付ける
+  bool colorCodes = true;
+  // 購入メッセージの半分を、数値の書き方・品目名・行末などを崩した行にするか（JerryParserFuzz の照合用）
+  bool adversarial = false;
+  // 同じシードからは同じログが生成される
+  uint64_t seed = 1;
+};
+
+/**
+ * Minecraft クライアントのログに似た合成ログを生成する関数
+ * 通常のログ行、チャット行、Jerry 以外の購入メッセージ、Jerry Talisman の購入メッセージを混ぜる
+ */
+std::string GenerateSyntheticLog(const LogGeneratorOptions &options);
+
+/**
+ * 生成したログをファイルへ書き込む関数
+ * gzip が true なら .log.gz と同じ gzip 形式で書き込む
+ */
+bool WriteSyntheticLog(const std::string &filePath, std::string_view content, bool gzip);
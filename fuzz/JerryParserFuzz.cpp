@@ -0,0 +1,479 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <zlib.h>
+
+#include "GzipDecoder.h"
+#include "ItemCatalog.h"
+#include "LegacyParser.h"
+#include "Purchase.h"
+#include "PurchaseScanner.h"
+#include "XxHash.h"
+
+#ifndef JERRYPARSER_LIBFUZZER
+#include "LogGenerator.h"
+#endif
+
+namespace
+{
+
+// std::regex は行の長さに比例した深さの再帰で照合するので、これより長い行を含む入力は試さない
+constexpr size_t kMaxLineLength = 4096;
+
+/**
+ * 比べる単位（最初の版の TalismanPurchase が持っていた種類・Recombobulated・コスト）
+ */
+struct ComparedPurchase
+{
+  uint8_t kind;
+  long long cost;
+
+  bool operator==(const ComparedPurchase &) const = default;
+};
+
+// 最初の版で種類が UNKNOWN になった購入
+constexpr uint8_t kUnknownKind = 0xFF;
+
+std::vector<ComparedPurchase> FromLegacy(const std::vector<legacy::TalismanPurchase> &purchases)
+{
+  std::vector<ComparedPurchase> compared;
+  for (const auto &purchase : purchases)
+  {
+    uint8_t kind = purchase.type == legacy::JerryType::UNKNOWN
+                       ? kUnknownKind
+                       : PurchaseKind(static_cast<size_t>(purchase.type), purchase.recombobulated);
+    compared.push_back({kind, purchase.cost});
+  }
+  return compared;
+}
+
+std::vector<ComparedPurchase> FromColumns(const PurchaseColumns &purchases)
+{
+  std::vector<ComparedPurchase> compared;
+  for (size_t i = 0; i < purchases.Size(); i++)
+  {
+    compared.push_back({purchases.Kinds()[i], purchases.Costs()[i]});
+  }
+  return compared;
+}
+
+std::string DescribePurchase(const std::vector<ComparedPurchase> &purchases, size_t index)
+{
+  if (index >= purchases.size())
+  {
+    return "nothing";
+  }
+  const ComparedPurchase &purchase = purchases[index];
+  if (purchase.kind == kUnknownKind)
+  {
+    return "an unknown item for " + std::to_string(purchase.cost) + " coins";
+  }
+  const ItemCatalog &catalog = ItemCatalog::Jerry();
+  std::string text;
+  for (const auto &family : catalog.Families())
+  {
+    size_t tier = purchase.kind / 2;
+    if (tier >= family.firstTier && tier < family.firstTier + family.tiers.size())
+    {
+      text = family.tiers[tier - family.firstTier].itemNames.front();
+    }
+  }
+  if (purchase.kind % 2)
+  {
+    text += " (recombobulated)";
+  }
+  return text + " for " + std::to_string(purchase.cost) + " coins";
+}
+
+bool ComparePurchases(const std::vector<ComparedPurchase> &expected, const std::vector<ComparedPurchase> &actual,
+                      std::string_view source, std::string &difference)
+{
+  size_t count = std::max(expected.size(), actual.size());
+  for (size_t i = 0; i < count; i++)
+  {
+    if (i < expected.size() && i < actual.size() && expected[i] == actual[i])
+    {
+      continue;
+    }
+    difference = std::string(source) + " purchase #" + std::to_string(i + 1) + ": expected " +
+                 DescribePurchase(expected, i) + ", got " + DescribePurchase(actual, i);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * 最初の版には無い時刻（日付をまたいだ回数を含む）を、一度に走査した結果と比べる関数
+ */
+bool CompareTimes(const PurchaseColumns &expected, const PurchaseColumns &actual, std::string_view source,
+                  std::string &difference)
+{
+  if (expected.DayRollovers() != actual.DayRollovers())
+  {
+    difference = std::string(source) + ": expected " + std::to_string(expected.DayRollovers()) +
+                 " day rollovers, got " + std::to_string(actual.DayRollovers());
+    return false;
+  }
+  auto mismatch = std::mismatch(expected.Times().begin(), expected.Times().end(), actual.Times().begin(),
+                                actual.Times().end());
+  if (mismatch.first != expected.Times().end() || mismatch.second != actual.Times().end())
+  {
+    size_t i = mismatch.first - expected.Times().begin();
+    difference = std::string(source) + " purchase #" + std::to_string(i + 1) + ": expected the time " +
+                 (i < expected.Size() ? std::to_string(expected.Times()[i]) : "nothing") + ", got " +
+                 (i < actual.Size() ? std::to_string(actual.Times()[i]) : "nothing");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * data を gzip 形式に圧縮する関数（split の位置で2つのメンバーに分ける）
+ */
+std::string Gzip(std::string_view data, size_t split)
+{
+  std::string out;
+  std::string_view members[] = {data.substr(0, split), data.substr(split)};
+  for (std::string_view member : members)
+  {
+    z_stream stream{};
+    deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    std::vector<unsigned char> buffer(deflateBound(&stream, static_cast<uLong>(member.size())));
+    stream.next_in = reinterpret_cast<unsigned char *>(const_cast<char *>(member.data()));
+    stream.avail_in = static_cast<unsigned>(member.size());
+    stream.next_out = buffer.data();
+    stream.avail_out = static_cast<unsigned>(buffer.size());
+    deflate(&stream, Z_FINISH);
+    out.append(reinterpret_cast<const char *>(buffer.data()), stream.total_out);
+    deflateEnd(&stream);
+  }
+  return out;
+}
+
+bool HasLongLine(std::string_view content)
+{
+  size_t lineBegin = 0;
+  for (size_t i = 0; i <= content.size(); i++)
+  {
+    if (i == content.size() || IsLineTerminator(content[i]))
+    {
+      if (i - lineBegin > kMaxLineLength)
+      {
+        return true;
+      }
+      lineBegin = i + 1;
+    }
+  }
+  return false;
+}
+
+/**
+ * 最初の版の ExtractJerryPurchases（読めない数値を std::cerr に書く）を、出力を捨てて呼ぶ関数
+ */
+std::vector<ComparedPurchase> LegacyPurchases(const std::string &content)
+{
+  std::streambuf *stderrBuffer = std::cerr.rdbuf(nullptr);
+  std::vector<legacy::TalismanPurchase> purchases = legacy::ExtractJerryPurchases(content);
+  std::cerr.rdbuf(stderrBuffer);
+  return FromLegacy(purchases);
+}
+
+/**
+ * 照合した入力の数
+ */
+struct CheckCounts
+{
+  size_t inputs = 0;
+  // 意図した変更が結果に関わらず、最初の版の結果とそのまま比べた入力
+  size_t legacyInputs = 0;
+  size_t purchases = 0;
+};
+
+/**
+ * content を走査器のすべての読み方で読み、意図した変更を加えた最初の版の結果と比べる関数
+ * どちらの変更も結果に関わらない入力は、最初の版の結果ともそのまま比べる
+ *   scan    ScanPurchases で一度に
+ *   stream  PurchaseStreamScanner に乱数で決めた長さのチャンクで（Feed と WritePointer / Commit を交互に）
+ *   gzip    2つのメンバーに分けて圧縮し、zlib のバックエンドで展開しながら
+ * stream と gzip は、購入の時刻と日付をまたいだ回数も scan の結果と比べる
+ * 同じ seed なら同じ切り方になる。食い違いがあれば最初の1件を difference に書いて false を返す
+ */
+bool CheckContent(const std::string &content, uint64_t seed, CheckCounts &counts, std::string &difference)
+{
+  const ItemCatalog &catalog = ItemCatalog::Jerry();
+  bool legacyEquivalent;
+  std::vector<ComparedPurchase> expected = FromLegacy(legacy::ExtractIntendedPurchases(content, legacyEquivalent));
+  counts.inputs++;
+  counts.purchases += expected.size();
+
+  PurchaseColumns scannedColumns = ExtractPurchases(content, catalog);
+  std::vector<ComparedPurchase> scanned = FromColumns(scannedColumns);
+  if (!ComparePurchases(expected, scanned, "scan", difference))
+  {
+    return false;
+  }
+  if (legacyEquivalent)
+  {
+    counts.legacyInputs++;
+    if (!ComparePurchases(LegacyPurchases(content), scanned, "legacy", difference))
+    {
+      return false;
+    }
+  }
+
+  // 持ち越しとバッファの拡張も通るよう、バッファは小さめから選び、チャンクは短いものを多めにする
+  std::mt19937_64 random(seed);
+  PurchaseStreamScanner scanner(size_t{64} << (random() % 12));
+  std::string_view rest = content;
+  while (!rest.empty())
+  {
+    size_t limit = random() % 4 == 0 ? 65536 : 64;
+    size_t size = std::min<size_t>(rest.size(), 1 + random() % limit);
+    if (random() % 2 == 0 || scanner.WritableSize() == 0)
+    {
+      scanner.Feed(rest.substr(0, size));
+    }
+    else
+    {
+      size = std::min(size, scanner.WritableSize());
+      std::memcpy(scanner.WritePointer(), rest.data(), size);
+      scanner.Commit(size);
+    }
+    rest.remove_prefix(size);
+  }
+  scanner.Finish();
+  if (!ComparePurchases(expected, FromColumns(scanner.Purchases()), "stream", difference) ||
+      !CompareTimes(scannedColumns, scanner.Purchases(), "stream", difference))
+  {
+    return false;
+  }
+
+  static const std::unique_ptr<GzipDecoder> decoder = CreateGzipDecoder(InflateBackend::ZLIB);
+  std::string compressed = Gzip(content, content.empty() ? 0 : random() % content.size());
+  PurchaseColumns inflated;
+  ExtractPurchasesFromData(compressed, *decoder, catalog, inflated);
+  return ComparePurchases(expected, FromColumns(inflated), "gzip", difference) &&
+         CompareTimes(scannedColumns, inflated, "gzip", difference);
+}
+
+} // namespace
+
+#ifdef JERRYPARSER_LIBFUZZER
+
+/**
+ * libFuzzer の入口（入力をそのまま1つのログとして照合し、食い違えば abort する）
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  std::string content(reinterpret_cast<const char *>(data), size);
+  if (HasLongLine(content))
+  {
+    return 0;
+  }
+  CheckCounts counts;
+  std::string difference;
+  if (!CheckContent(content, XxHash64(data, size), counts, difference))
+  {
+    std::cerr << difference << std::endl;
+    std::abort();
+  }
+  return 0;
+}
+
+#else
+
+namespace
+{
+
+// 変異で差し込む断片（購入メッセージの部品と、その境目になりやすい文字）
+constexpr std::string_view kFragments[] = {
+    "You purchased ", "\xC2\xA7", "\xC2\xA7" "6", "\xC2\xA7" "9", "\xC2\xA7" "5", "\xC2\xA7" "d",
+    "Green Jerry Talisman ", "Blue Jerry Artifact ", "Purple Jerry Talisman ", "PurPle", "Golden Jerry ",
+    " for ", "for ", " coins", " coins!", "1,234", "0", "7", ",", ".", "k", "m", "B", "\n", "\r", "\r\n",
+    "[12:34:56] ", "[99:00:00] ", " x1 "};
+
+/**
+ * content を乱数で少しだけ壊す関数（1バイトの書き換え・断片の挿入・削除・一部の複製・切り詰めのどれか）
+ */
+void Mutate(std::string &content, std::mt19937_64 &random)
+{
+  auto pick = [&](size_t n) { return n == 0 ? 0 : static_cast<size_t>(random() % n); };
+  size_t pos = pick(content.size() + 1);
+  switch (random() % 5)
+  {
+  case 0:
+    if (pos < content.size())
+    {
+      content[pos] = static_cast<char>(random());
+    }
+    break;
+  case 1:
+    content.insert(pos, kFragments[pick(std::size(kFragments))]);
+    break;
+  case 2:
+    content.erase(pos, 1 + pick(64));
+    break;
+  case 3: {
+    std::string copy = content.substr(pick(content.size() + 1), 1 + pick(256));
+    content.insert(pos, copy);
+    break;
+  }
+  case 4:
+    content.resize(pos + (content.size() - pos) / 2);
+    break;
+  }
+}
+
+/**
+ * seed から照合する入力を1つ作る関数
+ * 合成ログ（崩した購入メッセージを混ぜることもある）に、いくつか変異を加える
+ * 3回に1回は Purple を Golden に置き換え、最初の版の結果とそのまま比べられる入力を多めにする
+ */
+std::string GenerateInput(uint64_t seed)
+{
+  std::mt19937_64 random(seed);
+  LogGeneratorOptions options;
+  options.size = 256 + random() % (32 * 1024);
+  options.purchaseDensity = 0.02 + static_cast<double>(random() % 300) / 1000.0;
+  options.colorCodes = random() % 2 == 0;
+  options.adversarial = random() % 2 == 0;
+  options.seed = seed;
+  std::string content = GenerateSyntheticLog(options);
+
+  if (random() % 3 == 0)
+  {
+    for (size_t pos = 0; (pos = content.find("Purple", pos)) != std::string::npos;)
+    {
+      content.replace(pos, 6, "Golden");
+    }
+  }
+  size_t mutations = random() % 6;
+  for (size_t i = 0; i < mutations; i++)
+  {
+    Mutate(content, random);
+  }
+  return content;
+}
+
+template <typename T> bool ParseValue(std::string_view text, T &value)
+{
+  auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  return ec == std::errc{} && ptr == text.data() + text.size();
+}
+
+void PrintUsage()
+{
+  std::cout << "Usage: JerryParserFuzz [options] [file...]\n"
+               "  --iterations N    number of generated and mutated logs to check (default: 200)\n"
+               "  --seed N          seed of the first generated log (default: 1)\n"
+               "Files given on the command line are checked as they are, in addition to the generated logs.\n";
+}
+
+} // namespace
+
+/**
+ * 走査器と最初の版の正規表現による抽出を照合するテスト
+ * 合成・変異させたログと、指定されたファイルを CheckContent で照合し、食い違いがあれば終了コード 1 で終わる
+ */
+int main(int argc, char *argv[])
+{
+  size_t iterations = 200;
+  uint64_t firstSeed = 1;
+  std::vector<std::string> files;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string_view arg = argv[i];
+    bool hasNext = i + 1 < argc;
+
+    if (arg == "--iterations" && hasNext)
+    {
+      if (!ParseValue(argv[++i], iterations))
+      {
+        std::cerr << "Invalid iteration count: " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (arg == "--seed" && hasNext)
+    {
+      if (!ParseValue(argv[++i], firstSeed))
+      {
+        std::cerr << "Invalid seed: " << argv[i] << std::endl;
+        return 1;
+      }
+    }
+    else if (arg == "--help" || arg == "-h")
+    {
+      PrintUsage();
+      return 0;
+    }
+    else if (arg.starts_with("-"))
+    {
+      PrintUsage();
+      return 1;
+    }
+    else
+    {
+      files.push_back(std::string(arg));
+    }
+  }
+
+  CheckCounts counts;
+  size_t mismatches = 0;
+  for (const auto &filePath : files)
+  {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file)
+    {
+      std::cerr << "could not open: " << filePath << std::endl;
+      return 1;
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::string difference;
+    if (HasLongLine(content))
+    {
+      std::cout << "Skipped " << filePath << ": a line is longer than " << kMaxLineLength << " bytes" << std::endl;
+    }
+    else if (!CheckContent(content, XxHash64(filePath.data(), filePath.size()), counts, difference))
+    {
+      mismatches++;
+      std::cout << "Mismatch in " << filePath << ": " << difference << std::endl;
+    }
+  }
+
+  for (uint64_t seed = firstSeed; seed < firstSeed + iterations; seed++)
+  {
+    std::string content = GenerateInput(seed);
+    std::string difference;
+    if (!HasLongLine(content) && !CheckContent(content, seed, counts, difference))
+    {
+      mismatches++;
+      std::cout << "Mismatch in the log of seed " << seed << " (rerun with --seed " << seed
+                << " --iterations 1): " << difference << std::endl;
+    }
+  }
+
+  std::cout << "Checked " << counts.inputs << " logs with " << counts.purchases << " purchases ("
+            << counts.legacyInputs << " also against the legacy parser as is): " << mismatches << " mismatched"
+            << std::endl;
+  // 最初の版とそのまま比べた入力が無ければ、意図した変更の一覧が正しいかを確かめられていない
+  if (iterations > 0 && counts.legacyInputs == 0)
+  {
+    std::cout << "No log could be compared with the legacy parser as is" << std::endl;
+    return 1;
+  }
+  return mismatches > 0 ? 1 : 0;
+}
+
+#endif
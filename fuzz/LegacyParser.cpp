@@ -0,0 +1,229 @@
+#include "LegacyParser.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <regex>
+#include <stdexcept>
+
+namespace legacy
+{
+
+namespace
+{
+
+// §カラーコードの記号（UTF-8）
+constexpr std::string_view kSectionSign = "\xC2\xA7";
+
+bool IsCostChar(char c)
+{
+  return (c >= '0' && c <= '9') || c == ',' || c == '.';
+}
+
+/**
+ * pattern の from を to に置き換える関数（from が無ければ、最初の版の正規表現が変わったとして例外を投げる）
+ */
+std::string ReplacePattern(std::string pattern, std::string_view from, std::string_view to)
+{
+  size_t pos = pattern.find(from);
+  if (pos == std::string::npos)
+  {
+    throw std::logic_error("the legacy purchase pattern no longer contains " + std::string(from));
+  }
+  pattern.replace(pos, from.size(), to);
+  return pattern;
+}
+
+const std::regex &IntendedPattern()
+{
+  static const std::regex pattern(ReplacePattern(ReplacePattern(std::string(kPurchasePattern), "PurPle", "Purple"),
+                                                 "for .+?([0-9,]+) coins", "for (.+?)([0-9,.]+[kKmMbB]?) coins"));
+  return pattern;
+}
+
+/**
+ * 変更 2 の規則で数値を読む関数（読めなければ false）
+ * 走査器の ParseCost とは別に、単位を外した残りを正規表現で整数部と小数部に分けて std::stoll で読む
+ */
+bool ParseIntendedCost(std::string text, long long &cost)
+{
+  long long unit = 1;
+  int unitDigits = 0;
+  if (!text.empty())
+  {
+    switch (text.back())
+    {
+    case 'k':
+    case 'K':
+      unit = 1000LL;
+      unitDigits = 3;
+      break;
+    case 'm':
+    case 'M':
+      unit = 1000000LL;
+      unitDigits = 6;
+      break;
+    case 'b':
+    case 'B':
+      unit = 1000000000LL;
+      unitDigits = 9;
+      break;
+    }
+  }
+  if (unit > 1)
+  {
+    text.pop_back();
+  }
+
+  static const std::regex withFraction(R"(([0-9,]*)(?:\.([0-9]*))?)");
+  static const std::regex integerOnly(R"(([0-9,]*))");
+  std::smatch match;
+  if (!std::regex_match(text, match, unit > 1 ? withFraction : integerOnly))
+  {
+    return false;
+  }
+  std::string integerDigits = match[1].str();
+  integerDigits.erase(std::remove(integerDigits.begin(), integerDigits.end(), ','), integerDigits.end());
+  std::string fractionDigits = match.size() > 2 ? match[2].str() : "";
+  if (integerDigits.empty() && fractionDigits.empty())
+  {
+    return false;
+  }
+
+  long long integer = 0;
+  long long fraction = 0;
+  try
+  {
+    integer = integerDigits.empty() ? 0 : std::stoll(integerDigits);
+    // 単位より細かい桁は1コイン未満なので切り捨てる
+    fractionDigits.resize(unitDigits, '0');
+    fraction = fractionDigits.empty() ? 0 : std::stoll(fractionDigits);
+  }
+  catch (const std::exception &)
+  {
+    return false;
+  }
+  if (integer > (std::numeric_limits<long long>::max() - fraction) / unit)
+  {
+    return false;
+  }
+  cost = integer * unit + fraction;
+  return true;
+}
+
+} // namespace
+
+/**
+ * Jerry Talismanの購入ログを抽出する関数
+ */
+std::vector<TalismanPurchase> ExtractJerryPurchases(const std::string &logContent)
+{
+  std::vector<TalismanPurchase> purchases;
+
+  // Chat history regex
+  std::regex logPattarn{std::string(kPurchasePattern)};
+
+  std::sregex_iterator it(logContent.begin(), logContent.end(), logPattarn);
+  std::sregex_iterator end;
+
+  for (; it != end; ++it)
+  {
+    std::smatch match = *it;
+    if (match.size() >= 5)
+    {
+      std::string rarity = match[1].str();
+      std::string color = match[2].str();
+      std::string costStr = match[4].str();
+
+      // コストのカンマを除去して数値化
+      costStr.erase(std::remove(costStr.begin(), costStr.end(), ','), costStr.end());
+      costStr.erase(0, 1);
+      long long cost;
+      try
+      {
+        cost = std::stoll(costStr);
+      }
+      catch (const std::exception &e)
+      {
+        std::cerr << "Error processing row " << costStr << ": " << e.what() << std::endl;
+        cost = 0;
+      }
+
+      // タリスマンの種類判定
+      JerryType type = JerryType::UNKNOWN;
+      if (color == "Green")
+        type = JerryType::GREEN;
+      else if (color == "Blue")
+        type = JerryType::BLUE;
+      else if (color == "Purple")
+        type = JerryType::PURPLE;
+      else if (color == "Golden")
+        type = JerryType::GOLDEN;
+
+      // Recombobulatedしてるかを判定
+      bool recombobulated = (type == JerryType::GREEN && rarity == "9") ||  // 9=RARE
+                            (type == JerryType::BLUE && rarity == "5") ||   // 5=EPIC
+                            (type == JerryType::PURPLE && rarity == "6") || // 6=LEGENDARY
+                            (type == JerryType::GOLDEN && rarity == "d");   // d=MYTHIC
+
+      purchases.push_back({type, recombobulated, cost});
+    }
+  }
+
+  return purchases;
+}
+
+std::vector<TalismanPurchase> ExtractIntendedPurchases(const std::string &logContent, bool &legacyEquivalent)
+{
+  // Purple と PurPle がどこにも無ければ、変更 1 は結果に関わらない
+  legacyEquivalent = logContent.find("Purple") == std::string::npos && logContent.find("PurPle") == std::string::npos;
+
+  std::vector<TalismanPurchase> purchases;
+  std::sregex_iterator it(logContent.begin(), logContent.end(), IntendedPattern());
+  std::sregex_iterator end;
+  for (; it != end; ++it)
+  {
+    const std::smatch &match = *it;
+    std::string rarity = match[1].str();
+    std::string color = match[2].str();
+    std::string filler = match[4].str();
+    std::string costStr = match[5].str();
+
+    // カラーコードの後ろの、カンマで始まらない [0-9,]+ の数値なら、変更 2 は結果に関わらない
+    legacyEquivalent = legacyEquivalent && filler.ends_with(kSectionSign) && costStr.front() != ',' &&
+                       costStr.find_first_not_of("0123456789,") == std::string::npos;
+
+    if (filler.size() == 1 && IsCostChar(filler[0]))
+    {
+      costStr.insert(0, filler);
+    }
+    else if (filler.ends_with(kSectionSign))
+    {
+      costStr.erase(0, 1);
+    }
+    long long cost = 0;
+    ParseIntendedCost(costStr, cost);
+
+    // 種類と Recombobulated の判定は ExtractJerryPurchases と同じ
+    JerryType type = JerryType::UNKNOWN;
+    if (color == "Green")
+      type = JerryType::GREEN;
+    else if (color == "Blue")
+      type = JerryType::BLUE;
+    else if (color == "Purple")
+      type = JerryType::PURPLE;
+    else if (color == "Golden")
+      type = JerryType::GOLDEN;
+
+    bool recombobulated = (type == JerryType::GREEN && rarity == "9") ||  // 9=RARE
+                          (type == JerryType::BLUE && rarity == "5") ||   // 5=EPIC
+                          (type == JerryType::PURPLE && rarity == "6") || // 6=LEGENDARY
+                          (type == JerryType::GOLDEN && rarity == "d");   // d=MYTHIC
+
+    purchases.push_back({type, recombobulated, cost});
+  }
+  return purchases;
+}
+
+} // namespace legacy
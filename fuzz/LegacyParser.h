@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * 最初の版の JerryParser が使っていた購入ログの抽出（main.cpp の ExtractJerryPurchases）をそのまま残したもの
+ * 今の走査器（ScanPurchases）の結果を確かめる基準で、ライブラリには含めない
+ */
+namespace legacy
+{
+
+/**
+ * 最初の版の正規表現（手を加えないこと）
+ */
+constexpr std::string_view kPurchasePattern =
+    R"(You purchased .+(.)(Green|Blue|PurPle|Golden) Jerry (Talisman|Artifact) .+for .+?([0-9,]+) coins)";
+
+/**
+ * Talismanの種類
+ */
+enum class JerryType
+{
+  GREEN,
+  BLUE,
+  PURPLE,
+  GOLDEN,
+  UNKNOWN
+};
+
+/**
+ * 購入データ
+ */
+struct TalismanPurchase
+{
+  JerryType type;
+  // Recombobulated?
+  bool recombobulated;
+  // 購入コスト
+  long long cost;
+
+  bool operator==(const TalismanPurchase &) const = default;
+};
+
+/**
+ * Jerry Talismanの購入ログを抽出する関数（最初の版と同じもの。読めない数値は std::cerr に書いて 0 コインとする）
+ */
+std::vector<TalismanPurchase> ExtractJerryPurchases(const std::string &logContent);
+
+/**
+ * ExtractJerryPurchases に、その後に意図して変えた点だけを加えた抽出
+ * 正規表現は kPurchasePattern の該当部分を置き換えて作り、置き換える部分が見つからなければ例外を投げる
+ *
+ *   1. Purple の綴り
+ *      正規表現の "PurPle" を "Purple" にする。種類の判定は最初から "Purple" と比べていたので、Purple の購入を数える
+ *   2. 数値の読み方
+ *      "for .+?([0-9,]+) coins" を "for (.+?)([0-9,.]+[kKmMbB]?) coins" にし、数値の先頭の扱いを変える
+ *      - "1.25m" や "500k" の省略形を単位倍し、単位より細かい桁は切り捨てる
+ *      - .+? が数字などの1文字だけなら、それは数値の先頭の桁（以前はこの桁と次の桁が落ちていた）
+ *      - .+? が "§" で終わるときだけ、数値の先頭の1文字をカラーコードとして捨てる（以前は常に捨てていた）
+ *      - 読めない数値と桁あふれは 0 コイン
+ *
+ * legacyEquivalent には、どちらの変更も結果に関わらない入力か（ExtractJerryPurchases と同じ結果になるはず）を書く
+ */
+std::vector<TalismanPurchase> ExtractIntendedPurchases(const std::string &logContent, bool &legacyEquivalent);
+
+} // namespace legacy
@@ -1,264 +1,614 @@
 ﻿#include <algorithm>
-#include <cmath>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
-#include <fstream>
-#include <iomanip>
+#include <functional>
 #include <iostream>
 #include <map>
-#include <regex>
-#include <sstream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
 #include <vector>
-#include <windows.h>
 
-#include <zlib.h>
+#include "DirectoryWatcher.h"
+#include "FileSample.h"
+#include "Format.h"
+#include "GzipDecoder.h"
+#include "ItemCatalog.h"
+#include "LogFile.h"
+#include "Pipeline.h"
+#include "Platform.h"
+#include "PriceDistribution.h"
+#include "Purchase.h"
+#include "PurchaseCache.h"
+#include "PurchaseDedup.h"
+#include "PurchaseExport.h"
+#include "PurchaseScanner.h"
+#include "PurchaseServer.h"
+#include "Stats.h"
+#include "TailState.h"
+#include "TimeSeries.h"
+#include "WorkStealing.h"
+#include "XxHash.h"
 
 /**
- * Talismanの種類
+ * 処理に掛かる時間の目安（展開が必要な分 .gz は重く見積もる）
+ * 並べ替えに使うだけなので、ファイルを開かずに名前で判定する
  */
-enum class JerryType
+uintmax_t EstimateFileCost(const std::string &filePath, uintmax_t size)
 {
-  GREEN,
-  BLUE,
-  PURPLE,
-  GOLDEN,
-  UNKNOWN
-};
+  // ログの圧縮率はおよそ1/8
+  return filePath.ends_with(".gz") ? size * 8 : size;
+}
 
 /**
- * 購入データ
+ * コマンドラインオプション
  */
-struct TalismanPurchase
+struct Options
 {
-  JerryType type;
-  // Recombobulated?
-  bool recombobulated;
-  // 購入コスト
-  long long cost;
+  // 0ならハードウェアのスレッド数
+  unsigned threads = 0;
+  // 読み込み・展開・走査をパイプラインで処理するか
+  bool pipeline = false;
+  // gzip展開のバックエンド
+  InflateBackend inflate = InflateBackend::ZLIB;
+  // 前回の抽出結果のキャッシュを使うか
+  bool cache = true;
+  // ディレクトリをサブディレクトリまでたどるか
+  bool recursive = false;
+  // 複数のログに含まれる同じ購入を一度だけ数えるか
+  bool dedup = false;
+  // この日付（1970-01-01 からの日数）より前のログを読まない
+  std::optional<int32_t> since;
+  // 月ごとに層別して無作為に選ぶファイルの数（0ならすべて読む）
+  size_t sample = 0;
+  // latest.log を前回の続きから読むか
+  bool incremental = false;
+  // latest.log への追記を待ち続けるか
+  bool follow = false;
+  // 段階ごとの時間とスループットを表示するか
+  bool stats = false;
+  // Chrome のトレース形式で書き出すファイル（空なら書き出さない）
+  std::string tracePath;
+  // 日ごと・時間ごとの価格の推移を表示するか
+  SeriesInterval series = SeriesInterval::NONE;
+  // 最初の段階1個あたりの価格の分位数とヒストグラムを表示するか
+  bool distribution = false;
+  // 購入データを書き出すファイル（空なら書き出さない）
+  std::string exportPath;
+  // 集計する品目の表（空なら既定の Jerry Talisman の表）
+  std::string itemsPath;
+  // アップロードを受け付けるサーバーとして動くか
+  bool serve = false;
+  // --serve で待ち受けるアドレス（空ならすべて）とポート
+  std::string serveHost;
+  uint16_t servePort = 0;
+  // Recombobulatorの価格（指定されていなければ入力してもらう）
+  std::optional<long long> recombobulatorPrice;
+  // 処理するファイル・ディレクトリ・ワイルドカード（空ならダイアログで選ぶ）
+  std::vector<std::string> inputs;
+  bool help = false;
 };
 
 /**
- * 数値にカンマ付けする関数（千単位区切り）
+ * 使い方を表示する関数
  */
-std::string FormatNumber(long long num)
+void PrintUsage()
 {
-  std::stringstream ss;
-  ss.imbue(std::locale(""));
-  ss << std::fixed << num;
-  return ss.str();
+  std::cout << "Usage: JerryParser [options] [file | directory | glob]...\n"
+               "Without inputs a file dialog is shown.\n"
+               "\n"
+               "  --recomb-price N      Recombobulator 3000 price (skips the prompt)\n"
+               "  -j, --threads N       number of worker threads\n"
+               "  -r, --recursive       also search subdirectories of directory inputs\n"
+               "  --pipeline            read, inflate and scan in a three-stage pipeline\n"
+               "  --inflate BACKEND     gzip backend: zlib, libdeflate, parallel\n"
+               "  --no-cache            do not use JerryParser.cache\n"
+               "  --dedup               count purchases found in several copies of a log only once\n"
+               "  --since YYYY-MM-DD    skip logs dated before this day without opening them\n"
+               "  --sample N            read N files stratified by month and estimate the price\n"
+               "  --incremental         read latest.log from where the last run stopped\n"
+               "  --follow              like --incremental, then keep watching latest.log\n"
+               "  --stats               print per-file and total timings for each stage\n"
+               "  --trace FILE          like --stats, and write a Chrome trace JSON (Perfetto)\n"
+               "  --items FILE          item table to track instead of the Jerry Talismans\n"
+               "  --series day|hour     print the average price for each day or hour\n"
+               "  --distribution        print percentiles and a histogram of the price per base item\n"
+               "  --export FILE         write every purchase to a compact binary columnar file\n"
+               "  --serve [HOST:]PORT   run an HTTP server that aggregates uploaded logs in memory\n"
+               "  -h, --help            show this help\n";
 }
 
 /**
- * コインを "1.3m" のような形式にフォーマットする
- * 1,000,000,000以上は "1.3B", 1,000,000以上は "1.3M", 1,000以上は "1.3K, それ以下はそのままの数値を返す
+ * カンマ入りの整数を読み取る関数
  */
-std::string FormatCoins(long long coins)
+bool ParseInteger(std::string_view text, long long &value)
 {
-  if (coins >= 1000000000)
-  {
-    double coin_unit_billions = coins / 1000000000.0;
-    std::stringstream ss;
-    ss << std::fixed << std::setprecision(1) << coin_unit_billions << "B";
-    return ss.str();
-  }
-  else if (coins >= 1000000)
-  {
-    double coin_unit_millions = coins / 1000000.0;
-    std::stringstream ss;
-    ss << std::fixed << std::setprecision(1) << coin_unit_millions << "M";
-    return ss.str();
-  }
-  else if (coins >= 1000)
-  {
-    double coin_unit_thousands = coins / 1000.0;
-    std::stringstream ss;
-    ss << std::fixed << std::setprecision(1) << coin_unit_thousands << "K";
-    return ss.str();
-  }
-  else
-  {
-    return std::to_string(coins);
-  }
+  std::string digits(text);
+  digits.erase(std::remove(digits.begin(), digits.end(), ','), digits.end());
+  auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+  return ec == std::errc{} && ptr == digits.data() + digits.size();
 }
 
 /**
- * .log.gzファイルを読み込む関数
+ * コマンドラインオプションを解析する関数
  */
-std::string ReadGzFile(const std::string &filePath)
+bool ParseOptions(int argc, char *argv[], Options &options)
 {
-  gzFile file = gzopen(filePath.c_str(), "rb");
-  if (!file)
+  for (int i = 1; i < argc; i++)
   {
-    std::cerr << "could not open a .gz file: " << filePath << std::endl;
-    return "";
-  }
+    std::string_view arg = argv[i];
 
-  std::string content;
-  char buffer[4096];
-  int readBytes;
+    // 値を取るオプション（"--name value" と "--name=value" のどちらも受け付ける）
+    std::string_view value;
+    bool hasValue = false;
+    auto takeValue = [&](std::string_view name, std::string_view shortName = {}) {
+      if (arg == name || (!shortName.empty() && arg == shortName))
+      {
+        if (i + 1 >= argc)
+        {
+          std::cerr << "Missing value for " << arg << std::endl;
+          return false;
+        }
+        value = argv[++i];
+        hasValue = true;
+        return true;
+      }
+      if (arg.size() > name.size() && arg.starts_with(name) && arg[name.size()] == '=')
+      {
+        value = arg.substr(name.size() + 1);
+        hasValue = true;
+        return true;
+      }
+      return false;
+    };
 
-  while ((readBytes = gzread(file, buffer, sizeof(buffer))) > 0)
-  {
-    content.append(buffer, readBytes);
+    if (arg == "-h" || arg == "--help")
+    {
+      options.help = true;
+    }
+    else if (arg == "--pipeline")
+    {
+      options.pipeline = true;
+    }
+    else if (arg == "-r" || arg == "--recursive")
+    {
+      options.recursive = true;
+    }
+    else if (arg == "--dedup")
+    {
+      options.dedup = true;
+    }
+    else if (arg == "--no-cache")
+    {
+      options.cache = false;
+    }
+    else if (arg == "--incremental")
+    {
+      options.incremental = true;
+    }
+    else if (arg == "--follow")
+    {
+      options.incremental = true;
+      options.follow = true;
+    }
+    else if (arg == "--stats")
+    {
+      options.stats = true;
+    }
+    else if (arg == "--distribution")
+    {
+      options.distribution = true;
+    }
+    else if (takeValue("--trace"))
+    {
+      options.stats = true;
+      options.tracePath = value;
+    }
+    else if (takeValue("--export"))
+    {
+      options.exportPath = value;
+    }
+    else if (takeValue("--items"))
+    {
+      options.itemsPath = value;
+    }
+    else if (takeValue("--serve"))
+    {
+      size_t colon = value.rfind(':');
+      std::string_view port = colon == std::string_view::npos ? value : value.substr(colon + 1);
+      auto [ptr, ec] = std::from_chars(port.data(), port.data() + port.size(), options.servePort);
+      if (ec != std::errc{} || ptr != port.data() + port.size() || options.servePort == 0)
+      {
+        std::cerr << "Invalid server port: " << value << std::endl;
+        return false;
+      }
+      options.serve = true;
+      options.serveHost = colon == std::string_view::npos ? std::string() : std::string(value.substr(0, colon));
+    }
+    else if (takeValue("--series"))
+    {
+      if (value == "day")
+        options.series = SeriesInterval::DAY;
+      else if (value == "hour")
+        options.series = SeriesInterval::HOUR;
+      else
+      {
+        std::cerr << "Unknown series interval: " << value << " (day, hour)" << std::endl;
+        return false;
+      }
+    }
+    else if (takeValue("--inflate"))
+    {
+      if (value == "zlib")
+        options.inflate = InflateBackend::ZLIB;
+      else if (value == "libdeflate")
+        options.inflate = InflateBackend::LIBDEFLATE;
+      else if (value == "parallel")
+        options.inflate = InflateBackend::PARALLEL;
+      else
+      {
+        std::cerr << "Unknown inflate backend: " << value << " (zlib, libdeflate, parallel)" << std::endl;
+        return false;
+      }
+    }
+    else if (takeValue("--threads", "-j"))
+    {
+      auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), options.threads);
+      if (ec != std::errc{} || ptr != value.data() + value.size())
+      {
+        std::cerr << "Invalid thread count: " << value << std::endl;
+        return false;
+      }
+    }
+    else if (takeValue("--since"))
+    {
+      int32_t day;
+      if (!ParseDay(value, day))
+      {
+        std::cerr << "Invalid date: " << value << " (YYYY-MM-DD)" << std::endl;
+        return false;
+      }
+      options.since = day;
+    }
+    else if (takeValue("--sample"))
+    {
+      auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), options.sample);
+      if (ec != std::errc{} || ptr != value.data() + value.size() || options.sample == 0)
+      {
+        std::cerr << "Invalid sample size: " << value << std::endl;
+        return false;
+      }
+    }
+    else if (takeValue("--recomb-price"))
+    {
+      long long price;
+      if (!ParseInteger(value, price))
+      {
+        std::cerr << "Invalid Recombobulator3000 price: " << value << std::endl;
+        return false;
+      }
+      options.recombobulatorPrice = price;
+    }
+    else if (!hasValue && arg.size() > 1 && arg.starts_with("-"))
+    {
+      std::cerr << "Unknown option: " << arg << std::endl;
+      return false;
+    }
+    else
+    {
+      options.inputs.emplace_back(arg);
+    }
   }
-
-  gzclose(file);
-  return content;
+  return true;
 }
 
 /**
- * .logファイルを読み込む関数
+ * * と ? のワイルドカードで照合する関数
  */
-std::string ReadLogFile(const std::string &filePath)
+bool MatchWildcard(std::string_view pattern, std::string_view name)
 {
-  std::ifstream file(filePath);
-  if (!file)
+  size_t p = 0;
+  size_t n = 0;
+  size_t starPattern = std::string_view::npos;
+  size_t starName = 0;
+  while (n < name.size())
   {
-    std::cerr << "could not open a .log file: " << filePath << std::endl;
-    return "";
+    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n]))
+    {
+      p++;
+      n++;
+    }
+    else if (p < pattern.size() && pattern[p] == '*')
+    {
+      starPattern = p++;
+      starName = n;
+    }
+    else if (starPattern != std::string_view::npos)
+    {
+      p = starPattern + 1;
+      n = ++starName;
+    }
+    else
+    {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*')
+  {
+    p++;
   }
+  return p == pattern.size();
+}
+
+bool HasWildcard(std::string_view text)
+{
+  return text.find_first_of("*?") != std::string_view::npos;
+}
 
-  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-  return content;
+bool IsLogFileName(const std::filesystem::path &path)
+{
+  std::string name = path.filename().string();
+  return name.ends_with(".log") || name.ends_with(".log.gz");
 }
 
 /**
- * GZip圧縮かどうかをマジックナンバーで判定する関数
+ * コマンドラインで指定されたパスをファイルの一覧に展開する関数
+ * ディレクトリならその中（recursive ならサブディレクトリも）の *.log と *.log.gz、
+ * ワイルドカードを含むなら一致するパスすべてを追加する
  */
-bool IsGzCompressed(const std::string &filePath)
+void ExpandInputPath(const std::string &input, bool recursive, std::vector<std::string> &files)
 {
-  std::ifstream file(filePath, std::ios::binary);
-  if (!file)
+  std::filesystem::path pattern(input);
+  std::vector<std::filesystem::path> matches = {pattern.root_path()};
+
+  if (HasWildcard(input))
   {
-    return false;
+    // ワイルドカードはディレクトリ部分にも使える（例: instances/*/logs/*.log.gz）
+    for (const auto &component : pattern.relative_path())
+    {
+      std::vector<std::filesystem::path> next;
+      std::string componentText = component.string();
+      for (const auto &base : matches)
+      {
+        if (!HasWildcard(componentText))
+        {
+          next.push_back(base / component);
+          continue;
+        }
+
+        std::error_code ec;
+        std::vector<std::filesystem::path> found;
+        for (const auto &entry : std::filesystem::directory_iterator(base.empty() ? "." : base, ec))
+        {
+          if (MatchWildcard(componentText, entry.path().filename().string()))
+          {
+            found.push_back(base / entry.path().filename());
+          }
+        }
+        std::sort(found.begin(), found.end());
+        next.insert(next.end(), found.begin(), found.end());
+      }
+      matches = std::move(next);
+    }
+  }
+  else
+  {
+    matches = {pattern};
   }
 
-  unsigned char header[2];
-  file.read(reinterpret_cast<char *>(header), 2);
+  size_t before = files.size();
+  for (const auto &match : matches)
+  {
+    std::error_code ec;
+    if (std::filesystem::is_directory(match, ec))
+    {
+      std::vector<std::string> found;
+      auto addEntry = [&](const std::filesystem::directory_entry &entry) {
+        if (entry.is_regular_file(ec) && IsLogFileName(entry.path()))
+        {
+          found.push_back(entry.path().string());
+        }
+      };
+      if (recursive)
+      {
+        // 読めないディレクトリ（他のユーザーのインスタンスなど）は飛ばして続ける
+        constexpr auto kDirectoryOptions = std::filesystem::directory_options::skip_permission_denied;
+        for (const auto &entry : std::filesystem::recursive_directory_iterator(match, kDirectoryOptions, ec))
+        {
+          addEntry(entry);
+        }
+      }
+      else
+      {
+        for (const auto &entry : std::filesystem::directory_iterator(match, ec))
+        {
+          addEntry(entry);
+        }
+      }
+      std::sort(found.begin(), found.end());
+      files.insert(files.end(), found.begin(), found.end());
+    }
+    else if (!HasWildcard(input) || std::filesystem::is_regular_file(match, ec))
+    {
+      files.push_back(match.string());
+    }
+  }
 
-  // GZIPのマジックナンバー: {0x1F, 0x8B}
-  return (file.gcount() == 2 && header[0] == 0x1F && header[1] == 0x8B);
+  if (files.size() == before)
+  {
+    std::cerr << "No log files found for: " << input << std::endl;
+  }
 }
 
 /**
- * ファイルを読み込む関数
+ * コストが読めず 0 コインとして数えた購入があれば知らせる関数（count はそのファイルで見つかった件数）
  */
-std::string ReadFile(const std::string &filePath)
+void ReportInvalidCosts(const std::string &filePath, size_t count)
 {
-  if (IsGzCompressed(filePath))
+  if (count > 0)
   {
-    return ReadGzFile(filePath);
-  }
-  else
-  {
-    return ReadLogFile(filePath);
+    std::cerr << "Error processing " << filePath << ": " << count << (count == 1 ? " row" : " rows")
+              << " with an invalid cost (counted as 0 coins)" << std::endl;
   }
 }
 
 /**
- * Jerry Talismanの購入ログを抽出する関数
+ * 集計結果を表示する関数
+ * 系統ごとに段階別の件数と、最初の段階に換算した個数・平均価格を表示する
  */
-std::vector<TalismanPurchase> ExtractJerryPurchases(const std::string &logContent)
+void PrintReport(const PurchaseSummary &summary, const ItemCatalog &catalog, long long recombobulatorPrice)
 {
-  std::vector<TalismanPurchase> purchases;
-
-  // Chat history regex
-  std::regex logPattarn(
-      R"(You purchased .+(.)(Green|Blue|PurPle|Golden) Jerry (Talisman|Artifact) .+for .+?([0-9,]+) coins)");
+  long long totalCost = summary.TotalCost();
 
-  std::sregex_iterator it(logContent.begin(), logContent.end(), logPattarn);
-  std::sregex_iterator end;
-
-  for (; it != end; ++it)
+  // 結果表示
+  std::cout << "\n=========== Jerry Talisman Parser ===========" << std::endl;
+  std::cout << "All: " << FormatCoins(totalCost) << " (" << FormatNumber(totalCost) << " coins)" << std::endl;
+  for (const auto &family : catalog.Families())
   {
-    std::smatch match = *it;
-    if (match.size() >= 5)
+    std::cout << "-------------------------------------------" << std::endl;
+    if (catalog.Families().size() > 1)
     {
-      std::string rarity = match[1].str();
-      std::string color = match[2].str();
-      std::string costStr = match[4].str();
-
-      // コストのカンマを除去して数値化
-      costStr.erase(std::remove(costStr.begin(), costStr.end(), ','), costStr.end());
-      costStr.erase(0, 1);
-      long long cost;
-      try
-      {
-        cost = std::stoll(costStr);
-      }
-      catch (const std::exception &e)
+      long long familyCost = family.TotalCost(summary);
+      std::cout << family.name << ": " << FormatCoins(familyCost) << " (" << FormatNumber(familyCost) << " coins)"
+                << std::endl;
+    }
+    for (size_t tier = 0; tier < family.tiers.size(); tier++)
+    {
+      long long count = family.Count(summary, tier, false);
+      long long recomCount = family.Count(summary, tier, true);
+      // 最初の段階は常に、それ以外は購入がある場合だけ表示する
+      if (tier == 0 || count > 0 || recomCount > 0)
       {
-        std::cerr << "Error processing row " << costStr << ": " << e.what() << std::endl;
-        cost = 0;
+        std::cout << family.tiers[tier].name << ": " << count << std::endl;
+        std::cout << "Recombobulated " << family.tiers[tier].name << ": " << recomCount << std::endl;
       }
+    }
 
-      // タリスマンの種類判定
-      JerryType type = JerryType::UNKNOWN;
-      if (color == "Green")
-        type = JerryType::GREEN;
-      else if (color == "Blue")
-        type = JerryType::BLUE;
-      else if (color == "Purple")
-        type = JerryType::PURPLE;
-      else if (color == "Golden")
-        type = JerryType::GOLDEN;
+    // 上位の段階を最初の段階に変換する際の処理
+    long long baseEquivalent = family.BaseEquivalent(summary);
 
-      // Recombobulatedしてるかを判定
-      bool recombobulated = (type == JerryType::GREEN && rarity == "9") ||  // 9=RARE
-                            (type == JerryType::BLUE && rarity == "5") ||   // 5=EPIC
-                            (type == JerryType::PURPLE && rarity == "6") || // 6=LEGENDARY
-                            (type == JerryType::GOLDEN && rarity == "d");   // d=MYTHIC
+    // Recombobulatorの価格を調整
+    long long adjustedCost = family.CostWithoutRecombobulators(summary, recombobulatorPrice);
 
-      purchases.push_back({type, recombobulated, cost});
-    }
-  }
+    // 平均価格の算出（最初の段階換算）
+    long long avgPricePerBase = family.PricePerBase(summary, recombobulatorPrice);
 
-  return purchases;
+    std::cout << "-------------------------------------------" << std::endl;
+    std::cout << family.BaseItemName() << " Conversion: " << baseEquivalent << std::endl;
+    std::cout << "Total Price Without Recombobulator: " << FormatCoins(adjustedCost) << " ("
+              << FormatNumber(adjustedCost) << " coins)" << std::endl;
+    std::cout << "Per " << family.BaseItemName() << ": " << FormatCoins(avgPricePerBase) << " ("
+              << FormatNumber(avgPricePerBase) << " coins)" << std::endl;
+  }
+  std::cout << "=============================================" << std::endl;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
-  OPENFILENAMEA ofn;
-  char fileNames[8192] = {0};
-
-  ZeroMemory(&ofn, sizeof(ofn));
-  ofn.lStructSize = sizeof(ofn);
-  ofn.hwndOwner = NULL;
-  ofn.lpstrFile = fileNames;
-  ofn.nMaxFile = sizeof(fileNames);
-  ofn.lpstrFilter = "Log Files (*.log;*.log.gz)\0*.log;*.log.gz\0All Files (*.*)\0*.*\0";
-  ofn.nFilterIndex = 1;
-  ofn.lpstrFileTitle = NULL;
-  ofn.nMaxFileTitle = 0;
-  ofn.lpstrInitialDir = NULL;
-  ofn.Flags = OFN_ALLOWMULTISELECT | OFN_EXPLORER;
-
-  std::vector<std::string> selectedFiles;
+  Options options;
+  if (!ParseOptions(argc, argv, options))
+  {
+    PrintUsage();
+    return 1;
+  }
+  if (options.help)
+  {
+    PrintUsage();
+    return 0;
+  }
 
-  if (GetOpenFileNameA(&ofn))
+  // 品目の表は走査を始める前に読み込み、以降はすべての走査で共有する
+  ItemCatalog loadedCatalog;
+  std::string catalogError;
+  if (!options.itemsPath.empty() && !loadedCatalog.Load(options.itemsPath, catalogError))
   {
-    char *p = fileNames;
-    std::string directory = p;
-    p += directory.size() + 1;
+    std::cerr << catalogError << std::endl;
+    return 1;
+  }
+  const ItemCatalog &catalog = options.itemsPath.empty() ? ItemCatalog::Jerry() : loadedCatalog;
 
-    if (*p)
-    { // 複数ファイル
-      while (*p)
+  // サーバーとして動く場合はダイアログもファイルの指定も使わない
+  if (options.serve)
+  {
+    PurchaseAggregates aggregates;
+    PurchaseServerEvents events;
+    events.onListening = [](const std::string &host, uint16_t port) {
+      std::cout << "Listening on " << (host.empty() ? "*" : host) << ":" << port << std::endl;
+    };
+    events.onUpload = [](const UploadReport &report) {
+      std::string_view user = report.user.empty() ? "(anonymous)" : report.user;
+      if (!report.error.empty())
       {
-        std::string filePath = directory + "\\" + p;
-        selectedFiles.push_back(filePath);
-        p += strlen(p) + 1;
+        std::cout << "Rejected: " << user << ", " << report.error << ", " << report.bytes << " bytes" << std::endl;
+        return;
       }
+      std::cout << (report.duplicate ? "Duplicate: " : "Uploaded: ") << user << ", " << report.purchases
+                << " purchases, " << report.bytes << " bytes" << std::endl;
+    };
+    if (!RunPurchaseServer(options.serveHost, options.servePort, catalog, options.recombobulatorPrice.value_or(0),
+                           aggregates, events))
+    {
+      std::cerr << "could not listen on port " << options.servePort << std::endl;
+      return 1;
     }
-    else
-    { // 単一ファイル
-      selectedFiles.push_back(directory);
+    return 0;
+  }
+
+  size_t threadCount = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+  std::unique_ptr<GzipDecoder> decoder = CreateGzipDecoder(options.inflate, threadCount);
+  if (!decoder)
+  {
+    std::cerr << "This build does not include the requested inflate backend." << std::endl;
+    return 1;
+  }
+
+  // コマンドラインでファイルを指定した場合は、ダイアログも入力待ちも出さない
+  bool interactive = options.inputs.empty();
+  std::vector<std::string> selectedFiles;
+
+  if (interactive)
+  {
+    std::vector<std::string> chosen;
+    if (!SelectFilesWithDialog(chosen))
+    {
+      std::cerr << "No file chosen." << std::endl;
+      return 1;
+    }
+    // コンソールで入力された場合はディレクトリやワイルドカードもあるので、コマンドラインと同じく展開する
+    for (const auto &input : chosen)
+    {
+      ExpandInputPath(input, options.recursive, selectedFiles);
     }
   }
   else
   {
-    std::cerr << "No file chosen." << std::endl;
-    return 1;
+    for (const auto &input : options.inputs)
+    {
+      ExpandInputPath(input, options.recursive, selectedFiles);
+    }
+  }
+
+  // 重なった指定（ダイアログで選んだファイルとそのディレクトリなど）で同じファイルを二重に数えないようにする
+  std::unordered_set<std::string> seen;
+  std::erase_if(selectedFiles, [&](const std::string &filePath) { return !seen.insert(filePath).second; });
+
+  // --since より前の日付のログは開かずに除く（日付の分からないファイルは残す）
+  if (options.since)
+  {
+    size_t before = selectedFiles.size();
+    std::erase_if(selectedFiles, [&](const std::string &filePath) {
+      int32_t day;
+      return LogFileDay(filePath, day) && day < *options.since;
+    });
+    std::cout << "Skipped " << before - selectedFiles.size() << " files dated before " << FormatDay(*options.since)
+              << std::endl;
   }
 
   if (selectedFiles.empty())
@@ -267,153 +617,544 @@ int main()
     return 1;
   }
 
-  // Recombobulatorの価格をユーザーに入力してもらう
   long long recombobulatorPrice = 0;
-  std::cout << "Send Recombobulator3000 price: ";
-  std::string recomPriceStr;
-  std::getline(std::cin, recomPriceStr);
-  // カンマがあれば削除
-  recomPriceStr.erase(std::remove(recomPriceStr.begin(), recomPriceStr.end(), ','), recomPriceStr.end());
-
-  auto [ptr, ec] =
-      std::from_chars(recomPriceStr.data(), recomPriceStr.data() + recomPriceStr.size(), recombobulatorPrice);
-  if (ec == std::errc{})
+  if (options.recombobulatorPrice)
   {
+    recombobulatorPrice = *options.recombobulatorPrice;
     std::cout << "\033[32m\033[1m●\033[0m Set Recombobulator3000 price -> " << recombobulatorPrice << std::endl;
   }
-  else
+  else if (interactive)
   {
-    std::cout << "\033[31m\033[1m●\033[0m Invalid Input! ";
-    std::cout << "autoset Recombobulator3000 price to 0" << std::endl;
+    // Recombobulatorの価格をユーザーに入力してもらう
+    std::cout << "Send Recombobulator3000 price: ";
+    std::string recomPriceStr;
+    std::getline(std::cin, recomPriceStr);
+    // カンマがあれば削除
+    recomPriceStr.erase(std::remove(recomPriceStr.begin(), recomPriceStr.end(), ','), recomPriceStr.end());
+
+    auto [ptr, ec] =
+        std::from_chars(recomPriceStr.data(), recomPriceStr.data() + recomPriceStr.size(), recombobulatorPrice);
+    if (ec == std::errc{})
+    {
+      std::cout << "\033[32m\033[1m●\033[0m Set Recombobulator3000 price -> " << recombobulatorPrice << std::endl;
+    }
+    else
+    {
+      std::cout << "\033[31m\033[1m●\033[0m Invalid Input! ";
+      std::cout << "autoset Recombobulator3000 price to 0" << std::endl;
+    }
   }
 
-  // すべてのファイルからJerry Talisman購入情報を抽出
-  std::vector<TalismanPurchase> allPurchases;
+  // 前回から変わっていないファイルはキャッシュの結果を使う
+  PurchaseCache cache;
+  std::filesystem::path cachePath = GetExecutableDirectory() / "JerryParser.cache";
+  if (options.cache)
+  {
+    cache.Load(cachePath, catalog.Hash());
+  }
 
-  for (const auto &filePath : selectedFiles)
+  // latest.log は前回の続きからだけ読む
+  TailStateStore tailStore;
+  std::filesystem::path tailStatePath = GetExecutableDirectory() / "JerryParser.tail";
+  std::vector<std::string> tailFiles;
+  std::vector<std::string> batchFiles;
+  if (options.incremental)
   {
-    std::cout << "Processing: " << filePath << std::endl;
-    try
+    tailStore.Load(tailStatePath, catalog.Hash());
+    for (const auto &filePath : selectedFiles)
     {
+      (IsTailTarget(filePath) ? tailFiles : batchFiles).push_back(filePath);
+    }
+  }
+  else
+  {
+    batchFiles = selectedFiles;
+  }
 
-      std::string content = ReadFile(filePath);
-      if (!content.empty())
+  // --sample では月ごとに層別して選んだファイルだけを読み、全体の平均価格を推定する
+  std::optional<FileSample> sample;
+  if (options.sample > 0)
+  {
+    sample.emplace(batchFiles, options.sample);
+    batchFiles = sample->Chosen();
+  }
+
+  // --dedup では重複のうちパスの小さいものを残すので、番号の順をパスの順にしておく
+  if (options.dedup)
+  {
+    std::sort(batchFiles.begin(), batchFiles.end());
+  }
+
+  auto updateTails = [&](bool verbose) {
+    bool anyChanged = false;
+    for (const auto &filePath : tailFiles)
+    {
+      TailState &state = tailStore.Get(filePath);
+      if (verbose)
+      {
+        std::cout << "Processing: " << filePath << " (from byte " << state.offset << ")" << std::endl;
+      }
+      bool changed;
+      if (!ScanAppended(filePath, catalog, state, changed))
       {
-        auto purchases = ExtractJerryPurchases(content);
-        allPurchases.insert(allPurchases.end(), purchases.begin(), purchases.end());
+        std::cerr << "could not open a .log file: " << filePath << std::endl;
       }
+      ReportInvalidCosts(filePath, state.newInvalidCosts);
+      anyChanged = anyChanged || changed;
     }
-    catch (const std::exception &e)
+    return anyChanged;
+  };
+  auto tailSummary = [&] {
+    PurchaseSummary tail;
+    for (const auto &filePath : tailFiles)
     {
-      std::cerr << "Error processing file " << filePath << ": " << e.what() << std::endl;
-      continue;
+      tail.Add(TailPurchases(tailStore.Get(filePath), catalog));
     }
-  }
+    return tail;
+  };
 
-  // 集計処理
-  long long totalCost = 0;
-  int greenCount = 0;
-  int recomGreenCount = 0;
-  int blueCount = 0;
-  int recomBlueCount = 0;
-  int purpleCount = 0;
-  int recomPurpleCount = 0;
-  int goldenCount = 0;
-  int recomGoldenCount = 0;
+  // すべてのファイルから品目の購入情報を抽出
+  PurchaseSummary summary;
+  std::mutex consoleMutex;
 
-  for (const auto &purchase : allPurchases)
+  // --series の時系列（ファイルの日付と行頭の時刻で振り分ける）
+  PurchaseTimeSeries series;
+  auto addToSeries = [&](PurchaseTimeSeries &target, const std::string &filePath, const PurchaseColumns &purchases) {
+    if (options.series == SeriesInterval::NONE)
+    {
+      return;
+    }
+    int32_t day;
+    if (LogFileDay(filePath, day))
+    {
+      target.AddFile(purchases, day);
+    }
+    else
+    {
+      target.AddUntimed(purchases);
+    }
+  };
+
+  // --distribution の価格の分布（ワーカーごとに集計して最後にまとめる）
+  PriceDistribution distribution(catalog, recombobulatorPrice);
+  auto addToDistribution = [&](PriceDistribution &target, const PurchaseColumns &purchases) {
+    if (options.distribution)
+    {
+      target.Add(purchases);
+    }
+  };
+
+  // --export で書き出す購入データ
+  PurchaseExportWriter exporter(catalog);
+  auto addToExport = [&](const std::string &filePath, const PurchaseColumns &purchases) {
+    if (options.exportPath.empty())
+    {
+      return;
+    }
+    int32_t day;
+    exporter.AddFile(filePath, LogFileDay(filePath, day) ? day : kExportNoDay, purchases);
+  };
+
+  // ワーカーごとに使い回す購入データの入れ物
+  // ファイルごとに Clear するだけなので、確保し直すのはそれまでより購入の多いファイルが来たときだけになる
+  struct WorkerBuffers
   {
-    totalCost += purchase.cost;
+    PurchaseColumns purchases;
+  };
 
-    switch (purchase.type)
+  // ファイル1つ分の購入データを集計・時系列・書き出しに加える
+  auto countPurchases = [&](PurchaseSummary &targetSummary, PurchaseTimeSeries &targetSeries,
+                            PriceDistribution &targetDistribution, const std::string &filePath,
+                            const PurchaseColumns &purchases) {
+    if (sample)
     {
-    case JerryType::GREEN:
-      if (purchase.recombobulated)
-        recomGreenCount++;
-      else
-        greenCount++;
-      break;
-    case JerryType::BLUE:
-      if (purchase.recombobulated)
-        recomBlueCount++;
-      else
-        blueCount++;
-      break;
-    case JerryType::PURPLE:
-      if (purchase.recombobulated)
-        recomPurpleCount++;
-      else
-        purpleCount++;
-      break;
-    case JerryType::GOLDEN:
-      if (purchase.recombobulated)
-        recomGoldenCount++;
-      else
-        goldenCount++;
-      break;
-    default:
-      break;
+      PurchaseSummary fileSummary;
+      fileSummary.Add(purchases);
+      sample->AddFile(filePath, fileSummary);
+      targetSummary.Merge(fileSummary);
+    }
+    else
+    {
+      targetSummary.Add(purchases);
+    }
+    addToSeries(targetSeries, filePath, purchases);
+    addToDistribution(targetDistribution, purchases);
+    addToExport(filePath, purchases);
+  };
+
+  // --dedup で他のログと重なる購入をどのファイルの分として数えるかは、加えた順で決まる
+  // ワーカーの終わった順にすると実行ごとに時系列や書き出しの内容が変わるので、日付の分かるファイルの購入は
+  // 走査が全て終わってからパスの順（batchFiles の順）に重複を除いて加える
+  PurchaseDeduplicator deduplicator;
+  std::vector<std::optional<PurchaseColumns>> pendingDedup(options.dedup ? batchFiles.size() : 0);
+  auto addPurchases = [&](PurchaseSummary &targetSummary, PurchaseTimeSeries &targetSeries,
+                          PriceDistribution &targetDistribution, size_t index, const PurchaseColumns &purchases) {
+    const std::string &filePath = batchFiles[index];
+    int32_t day;
+    if (options.dedup && LogFileDay(filePath, day))
+    {
+      pendingDedup[index] = purchases;
+      return;
+    }
+    countPurchases(targetSummary, targetSeries, targetDistribution, filePath, purchases);
+  };
+
+  // --stats の計測結果
+  TraceRecorder trace;
+  std::vector<FileStats> fileStats;
+  auto newStats = [&](const std::string &filePath) {
+    FileStats stats;
+    stats.path = filePath;
+    stats.trace = options.tracePath.empty() ? nullptr : &trace;
+    return stats;
+  };
+  auto processingBegin = std::chrono::steady_clock::now();
+
+  updateTails(true);
+
+  // 各ファイルは一度だけ開いてメモリマップし、フィンガープリント・キャッシュの照合・走査のすべてに同じマップを使う
+  // 開く前に分かるのはサイズだけなので、並べ替えと --dedup で比べる相手の絞り込みはサイズで行う
+  size_t workerCount = std::max<size_t>(1, std::min(threadCount, batchFiles.size()));
+  std::vector<PurchaseSummary> workerSummaries(workerCount);
+  std::vector<PurchaseTimeSeries> workerSeries(workerCount);
+  std::vector<PriceDistribution> workerDistributions(workerCount, distribution);
+  std::vector<WorkerBuffers> workerBuffers(workerCount);
+  if (options.stats)
+  {
+    for (const auto &filePath : batchFiles)
+    {
+      fileStats.push_back(newStats(filePath));
     }
   }
 
-  // 上位のJerry TalismanをGreen Jerry Talismanに変換する際の処理
-  int totalGreenEquivalent = greenCount + recomGreenCount;
+  std::vector<uintmax_t> fileSizes(batchFiles.size());
+  std::vector<size_t> probeOrder(batchFiles.size());
+  std::iota(probeOrder.begin(), probeOrder.end(), size_t{0});
+  RunWorkStealing(workerCount, probeOrder, [&](size_t, size_t index) {
+    std::error_code ec;
+    fileSizes[index] = std::filesystem::file_size(batchFiles[index], ec);
+    fileSizes[index] = ec ? 0 : fileSizes[index];
+  });
+
+  // マップした内容から、走査せずに済むファイル（重複・キャッシュにあるもの）を除く（走査が要らなければ false）
+  // キャッシュにあったファイルは worker の入れ物でその場で集計する
+  std::vector<FileFingerprint> fingerprints(batchFiles.size());
+  std::vector<char> cacheable(batchFiles.size());
+  std::map<uintmax_t, size_t> filesOfSize;
+  if (options.dedup)
+  {
+    for (uintmax_t size : fileSizes)
+    {
+      filesOfSize[size]++;
+    }
+  }
+  std::map<std::pair<uint64_t, uint64_t>, size_t> firstCopies;
+  std::mutex firstCopiesMutex;
+  auto needsScan = [&](size_t worker, size_t index, std::string_view data) {
+    const std::string &filePath = batchFiles[index];
+    FileStats *stats = options.stats ? &fileStats[index] : nullptr;
+
+    // --dedup では、内容全体が同じファイル（バックアップなど）を展開する前に除く
+    // 内容全体のハッシュは、同じサイズのファイルが他にもある場合だけ求める
+    if (options.dedup && filesOfSize.at(fileSizes[index]) > 1)
+    {
+      uint64_t contentHash;
+      {
+        StageTimer hashTimer(stats, Stage::READ);
+        contentHash = XxHash64(data.data(), data.size());
+      }
+      size_t first;
+      {
+        std::lock_guard<std::mutex> lock(firstCopiesMutex);
+        first = firstCopies.emplace(std::pair(uint64_t{data.size()}, contentHash), index).first->second;
+      }
+      if (first != index)
+      {
+        {
+          std::lock_guard<std::mutex> lock(consoleMutex);
+          std::cout << "Duplicate: " << filePath << " (same as " << batchFiles[first] << ")" << std::endl;
+        }
+        if (stats)
+        {
+          stats->end = std::chrono::steady_clock::now();
+        }
+        return false;
+      }
+    }
+
+    bool fingerprinted = false;
+    if (options.cache)
+    {
+      StageTimer fingerprintTimer(stats, Stage::READ);
+      fingerprinted = ComputeFileFingerprint(filePath, data, fingerprints[index]);
+    }
+    cacheable[index] = fingerprinted;
+    PurchaseColumns &purchases = workerBuffers[worker].purchases;
+    if (cacheable[index] && cache.Find(fingerprints[index], purchases))
+    {
+      {
+        std::lock_guard<std::mutex> lock(consoleMutex);
+        std::cout << "Cached: " << filePath << std::endl;
+      }
+      StageTimer aggregateTimer(stats, Stage::AGGREGATE);
+      addPurchases(workerSummaries[worker], workerSeries[worker], workerDistributions[worker], index, purchases);
+      aggregateTimer.Stop();
+      if (stats)
+      {
+        stats->cached = true;
+        stats->matches = purchases.Size();
+        stats->end = std::chrono::steady_clock::now();
+      }
+      return false;
+    }
+    return true;
+  };
 
-  totalGreenEquivalent += blueCount * 5;
-  totalGreenEquivalent += recomBlueCount * 5;
+  if (options.pipeline)
+  {
+    // パイプラインはファイルを順に読むので、重複のうち番号の小さいものが常に残る
+    // キャッシュにあったファイルは読み込みの段のスレッドで 0 番の入れ物に、走査したファイルは走査の段で summary に集計する
+    PipelineCallbacks callbacks;
+    callbacks.shouldScan = [&](size_t file, std::string_view data) { return needsScan(0, file, data); };
+    callbacks.onFileStart = [&](size_t file) {
+      std::lock_guard<std::mutex> lock(consoleMutex);
+      std::cout << "Processing: " << batchFiles[file] << std::endl;
+    };
+    callbacks.onFileDone = [&](size_t file, const PurchaseColumns &purchases) {
+      {
+        std::lock_guard<std::mutex> lock(consoleMutex);
+        ReportInvalidCosts(batchFiles[file], purchases.InvalidCostCount());
+      }
+      StageTimer aggregateTimer(options.stats ? &fileStats[file] : nullptr, Stage::AGGREGATE);
+      addPurchases(summary, series, distribution, file, purchases);
+      aggregateTimer.Stop();
+      if (cacheable[file])
+      {
+        cache.Store(fingerprints[file], purchases);
+      }
+    };
+    callbacks.onOpenFailed = [&](size_t file) {
+      std::lock_guard<std::mutex> lock(consoleMutex);
+      std::cerr << "could not open a log file: " << batchFiles[file] << std::endl;
+    };
+    RunPipeline(batchFiles, catalog, options.stats ? &fileStats : nullptr, callbacks);
+  }
+  else
+  {
+    // --dedup では同じサイズのファイルを1つのタスクにまとめて番号順に処理し、重複のうち番号の小さいものを残す
+    std::vector<std::vector<size_t>> tasks;
+    std::map<uintmax_t, size_t> taskOfSize;
+    for (size_t index = 0; index < batchFiles.size(); index++)
+    {
+      if (!options.dedup)
+      {
+        tasks.push_back({index});
+        continue;
+      }
+      auto [it, inserted] = taskOfSize.emplace(fileSizes[index], tasks.size());
+      if (inserted)
+      {
+        tasks.emplace_back();
+      }
+      tasks[it->second].push_back(index);
+    }
 
-  totalGreenEquivalent += purpleCount * 25;
-  totalGreenEquivalent += recomPurpleCount * 25;
+    // 大きいものから順に配り、最後に1つの大きなファイルだけが残らないようにする
+    std::vector<uintmax_t> taskCosts(tasks.size());
+    for (size_t task = 0; task < tasks.size(); task++)
+    {
+      for (size_t index : tasks[task])
+      {
+        taskCosts[task] += EstimateFileCost(batchFiles[index], fileSizes[index]);
+      }
+    }
+    std::vector<size_t> order(tasks.size());
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return taskCosts[a] > taskCosts[b]; });
+
+    RunWorkStealing(workerCount, order, [&](size_t worker, size_t task) {
+      for (size_t index : tasks[task])
+      {
+        const std::string &filePath = batchFiles[index];
+        FileStats *stats = options.stats ? &fileStats[index] : nullptr;
+        if (stats)
+        {
+          stats->begin = std::chrono::steady_clock::now();
+        }
+        try
+        {
+          StageTimer openTimer(stats, Stage::OPEN);
+          MappedFile file(filePath);
+          openTimer.Stop();
+          if (!file.IsOpen())
+          {
+            std::lock_guard<std::mutex> lock(consoleMutex);
+            std::cerr << "could not open a log file: " << filePath << std::endl;
+          }
+          else if (needsScan(worker, index, file.View()))
+          {
+            {
+              std::lock_guard<std::mutex> lock(consoleMutex);
+              std::cout << "Processing: " << filePath << std::endl;
+            }
 
-  totalGreenEquivalent += goldenCount * 125;
-  totalGreenEquivalent += recomGoldenCount * 125;
+            PurchaseColumns &purchases = workerBuffers[worker].purchases;
+            ExtractPurchasesFromData(file.View(), *decoder, catalog, purchases, stats);
+            {
+              std::lock_guard<std::mutex> lock(consoleMutex);
+              ReportInvalidCosts(filePath, purchases.InvalidCostCount());
+            }
+            if (cacheable[index])
+            {
+              cache.Store(fingerprints[index], purchases);
+            }
 
-  // Recombobulatorの価格を調整
-  long long adjustedCost =
-      totalCost - (recomGreenCount + recomBlueCount + recomPurpleCount + recomGoldenCount) * recombobulatorPrice;
+            StageTimer aggregateTimer(stats, Stage::AGGREGATE);
+            addPurchases(workerSummaries[worker], workerSeries[worker], workerDistributions[worker], index,
+                         purchases);
+          }
+        }
+        catch (const std::exception &e)
+        {
+          std::lock_guard<std::mutex> lock(consoleMutex);
+          std::cerr << "Error processing file " << filePath << ": " << e.what() << std::endl;
+        }
+        if (stats)
+        {
+          stats->end = std::chrono::steady_clock::now();
+        }
+      }
+    });
+  }
 
-  // 平均価格の算出（Green Jerry Talisman換算）
-  long long avgPricePerGreen = 0;
-  if (totalGreenEquivalent > 0)
+  // 集計処理
+  for (size_t worker = 0; worker < workerCount; worker++)
   {
-    avgPricePerGreen = static_cast<long long>(static_cast<double>(adjustedCost) / totalGreenEquivalent);
+    summary.Merge(workerSummaries[worker]);
+    series.Merge(workerSeries[worker]);
+    distribution.Merge(workerDistributions[worker]);
+  }
+  PurchaseColumns unique;
+  for (size_t index = 0; index < pendingDedup.size(); index++)
+  {
+    if (pendingDedup[index])
+    {
+      const std::string &filePath = batchFiles[index];
+      int32_t day;
+      LogFileDay(filePath, day);
+      deduplicator.Filter(LogInstanceName(filePath), day, *pendingDedup[index], unique);
+      pendingDedup[index].reset();
+      countPurchases(summary, series, distribution, filePath, unique);
+    }
   }
 
-  // 結果表示
-  std::cout << "\n=========== Jerry Talisman Parser ===========" << std::endl;
-  std::cout << "All: " << FormatCoins(totalCost) << " (" << FormatNumber(totalCost) << " coins)" << std::endl;
-  std::cout << "-------------------------------------------" << std::endl;
-  std::cout << "Green: " << greenCount << std::endl;
-  std::cout << "Recombobulated Green: " << recomGreenCount << std::endl;
+  auto processingEnd = std::chrono::steady_clock::now();
+  if (options.dedup)
+  {
+    std::cout << "Skipped " << deduplicator.DuplicateCount() << " purchases already counted in another log"
+              << std::endl;
+  }
 
-  if (blueCount > 0 || recomBlueCount > 0)
+  if (options.cache && cache.IsDirty() && !cache.Save(cachePath, catalog.Hash()))
+  {
+    std::cerr << "could not write the cache file: " << cachePath.string() << std::endl;
+  }
+  if (options.incremental && !tailFiles.empty() && !tailStore.Save(tailStatePath, catalog.Hash()))
   {
-    std::cout << "Blue: " << blueCount << std::endl;
-    std::cout << "Recombobulated Blue: " << recomBlueCount << std::endl;
+    std::cerr << "could not write the tail state file: " << tailStatePath.string() << std::endl;
+  }
+  if (!options.exportPath.empty())
+  {
+    for (const auto &filePath : tailFiles)
+    {
+      addToExport(filePath, TailPurchases(tailStore.Get(filePath), catalog));
+    }
+    if (!exporter.Write(options.exportPath))
+    {
+      std::cerr << "could not write the export file: " << options.exportPath << std::endl;
+    }
+    else if (!exporter.Verify(options.exportPath))
+    {
+      std::cerr << "the export file does not read back as written: " << options.exportPath << std::endl;
+    }
   }
 
-  if (purpleCount > 0 || recomPurpleCount > 0)
+  // 結果表示（latest.log の分は追記のたびに集計し直す）
+  auto currentSummary = [&] {
+    PurchaseSummary total = summary;
+    total.Merge(tailSummary());
+    return total;
+  };
+  auto printSeries = [&] {
+    if (options.series == SeriesInterval::NONE)
+    {
+      return;
+    }
+    PurchaseTimeSeries total = series;
+    for (const auto &filePath : tailFiles)
+    {
+      addToSeries(total, filePath, TailPurchases(tailStore.Get(filePath), catalog));
+    }
+    PrintTimeSeries(std::cout, total, options.series, catalog, recombobulatorPrice);
+  };
+  auto printDistribution = [&] {
+    if (!options.distribution)
+    {
+      return;
+    }
+    PriceDistribution total = distribution;
+    for (const auto &filePath : tailFiles)
+    {
+      total.Add(TailPurchases(tailStore.Get(filePath), catalog));
+    }
+    PrintPriceDistribution(std::cout, total, catalog);
+  };
+  auto reportBegin = std::chrono::steady_clock::now();
+  PrintReport(currentSummary(), catalog, recombobulatorPrice);
+  printSeries();
+  printDistribution();
+  if (sample)
   {
-    std::cout << "Purple: " << purpleCount << std::endl;
-    std::cout << "Recombobulated Purple: " << recomPurpleCount << std::endl;
+    PrintSampleEstimate(std::cout, *sample, catalog, recombobulatorPrice);
   }
 
-  if (goldenCount > 0 || recomGoldenCount > 0)
+  if (options.stats)
   {
-    std::cout << "Golden: " << goldenCount << std::endl;
-    std::cout << "Recombobulated Golden: " << recomGoldenCount << std::endl;
+    PrintStats(std::cout, fileStats, processingEnd - processingBegin, std::chrono::steady_clock::now() - reportBegin);
+    if (!options.tracePath.empty() && !trace.Write(options.tracePath))
+    {
+      std::cerr << "could not write the trace file: " << options.tracePath << std::endl;
+    }
   }
 
-  std::cout << "-------------------------------------------" << std::endl;
-  std::cout << "Green Jerry Talisman Conversion: " << totalGreenEquivalent << std::endl;
-  std::cout << "Total Price Without Recombobulator: " << FormatCoins(adjustedCost) << " (" << FormatNumber(adjustedCost)
-            << " coins)" << std::endl;
-  std::cout << "Per Green Jerry Talisman: " << FormatCoins(avgPricePerGreen) << " (" << FormatNumber(avgPricePerGreen)
-            << " coins)" << std::endl;
-  std::cout << "=============================================" << std::endl;
+  if (options.follow && !tailFiles.empty())
+  {
+    std::vector<std::filesystem::path> directories;
+    for (const auto &filePath : tailFiles)
+    {
+      directories.push_back(std::filesystem::absolute(filePath).parent_path());
+    }
+    DirectoryWatcher watcher(directories);
+    std::cout << "\nWatching latest.log for new purchases (Ctrl+C to stop)..." << std::endl;
 
-  std::cout << "\nPress Enter to exit...";
-  std::cin.get();
+    while (true)
+    {
+      watcher.Wait(std::chrono::seconds(5));
+      if (updateTails(false))
+      {
+        PrintReport(currentSummary(), catalog, recombobulatorPrice);
+        printSeries();
+        printDistribution();
+        tailStore.Save(tailStatePath, catalog.Hash());
+      }
+    }
+  }
+
+  if (interactive)
+  {
+    std::cout << "\nPress Enter to exit...";
+    std::cin.get();
+  }
 
   return 0;
 }
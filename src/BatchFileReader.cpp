@@ -0,0 +1,342 @@
+#include "BatchFileReader.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <atomic>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+// ファイルを開く・読む io_uring の操作は Linux 5.6 から（それより古いヘッダーでは要求をその場で実行する）
+#if defined(__linux__) && defined(IORING_FEAT_CUR_PERSONALITY) && defined(__NR_io_uring_setup)
+#define JERRYPARSER_IO_URING
+#endif
+
+namespace
+{
+
+#ifdef _WIN32
+static_assert(sizeof(OVERLAPPED) <= 32, "Request::overlapped is too small for OVERLAPPED");
+#endif
+
+#ifdef JERRYPARSER_IO_URING
+
+int IoUringSetup(unsigned entries, io_uring_params &params)
+{
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+}
+
+int IoUringEnter(int ring, unsigned submit, unsigned wait)
+{
+  return static_cast<int>(
+      syscall(__NR_io_uring_enter, ring, submit, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0));
+}
+
+/**
+ * カーネルがファイルを開く・読む操作に対応しているか（io_uring の操作はカーネルの版ごとに増えている）
+ */
+bool SupportsOpenAndRead(int ring)
+{
+  constexpr unsigned kProbeOps = 256;
+  std::vector<uint64_t> memory((sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op)) / sizeof(uint64_t));
+  auto *probe = reinterpret_cast<io_uring_probe *>(memory.data());
+  if (syscall(__NR_io_uring_register, ring, IORING_REGISTER_PROBE, probe, kProbeOps) < 0)
+  {
+    return false;
+  }
+  auto supported = [&](unsigned op) { return op <= probe->last_op && (probe->ops[op].flags & IO_URING_OP_SUPPORTED); };
+  return supported(IORING_OP_OPENAT) && supported(IORING_OP_READ);
+}
+
+#endif
+
+} // namespace
+
+BatchFileReader::BatchFileReader(unsigned depth) : requests_(std::max(depth, 1u))
+{
+  for (unsigned request = static_cast<unsigned>(requests_.size()); request-- > 0;)
+  {
+    freeRequests_.push_back(request);
+  }
+
+#if defined(_WIN32)
+  port_ = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+#elif defined(JERRYPARSER_IO_URING)
+  io_uring_params params{};
+  ring_ = IoUringSetup(static_cast<unsigned>(requests_.size()), params);
+  if (ring_ < 0)
+  {
+    return;
+  }
+
+  // 投入側と完了側のリングは、カーネルが対応していれば1つのマップにまとめられる
+  ringMemorySize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  completionMemorySize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMap)
+  {
+    ringMemorySize_ = completionMemorySize_ = std::max(ringMemorySize_, completionMemorySize_);
+  }
+  entriesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+
+  auto map = [&](size_t size, off_t offset) {
+    void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, offset);
+    return memory == MAP_FAILED ? nullptr : memory;
+  };
+  ringMemory_ = map(ringMemorySize_, IORING_OFF_SQ_RING);
+  completionMemory_ = singleMap ? ringMemory_ : map(completionMemorySize_, IORING_OFF_CQ_RING);
+  entries_ = map(entriesSize_, IORING_OFF_SQES);
+  if (!ringMemory_ || !completionMemory_ || !entries_ || !SupportsOpenAndRead(ring_))
+  {
+    ReleaseRing();
+    return;
+  }
+
+  char *submitRing = static_cast<char *>(ringMemory_);
+  submitTail_ = reinterpret_cast<unsigned *>(submitRing + params.sq_off.tail);
+  submitMask_ = *reinterpret_cast<unsigned *>(submitRing + params.sq_off.ring_mask);
+  submitArray_ = reinterpret_cast<unsigned *>(submitRing + params.sq_off.array);
+  char *completionRing = static_cast<char *>(completionMemory_);
+  completeHead_ = reinterpret_cast<unsigned *>(completionRing + params.cq_off.head);
+  completeTail_ = reinterpret_cast<unsigned *>(completionRing + params.cq_off.tail);
+  completeMask_ = *reinterpret_cast<unsigned *>(completionRing + params.cq_off.ring_mask);
+  completions_ = completionRing + params.cq_off.cqes;
+#endif
+}
+
+BatchFileReader::~BatchFileReader()
+{
+#ifdef _WIN32
+  if (port_)
+  {
+    CloseHandle(port_);
+  }
+#else
+  ReleaseRing();
+#endif
+}
+
+#ifndef _WIN32
+void BatchFileReader::ReleaseRing()
+{
+#ifdef JERRYPARSER_IO_URING
+  if (entries_)
+  {
+    munmap(entries_, entriesSize_);
+  }
+  if (completionMemory_ && completionMemory_ != ringMemory_)
+  {
+    munmap(completionMemory_, completionMemorySize_);
+  }
+  if (ringMemory_)
+  {
+    munmap(ringMemory_, ringMemorySize_);
+  }
+  entries_ = completionMemory_ = ringMemory_ = nullptr;
+  if (ring_ >= 0)
+  {
+    close(ring_);
+  }
+  ring_ = -1;
+#endif
+}
+
+void *BatchFileReader::NextEntry(unsigned request)
+{
+#ifdef JERRYPARSER_IO_URING
+  // 出しておく要求は requests_ の数までなので、投入側のリングがあふれることはない
+  unsigned tail = *submitTail_;
+  unsigned index = tail & submitMask_;
+  io_uring_sqe *entry = static_cast<io_uring_sqe *>(entries_) + index;
+  *entry = {};
+  entry->user_data = request;
+  submitArray_[index] = index;
+  std::atomic_ref<unsigned>(*submitTail_).store(tail + 1, std::memory_order_release);
+  unsubmitted_++;
+  return entry;
+#else
+  (void)request;
+  return nullptr;
+#endif
+}
+#endif
+
+unsigned BatchFileReader::Acquire(uint64_t tag, bool open)
+{
+  unsigned request = freeRequests_.back();
+  freeRequests_.pop_back();
+  requests_[request].tag = tag;
+  requests_[request].open = open;
+  return request;
+}
+
+void BatchFileReader::Open(const char *filePath, uint64_t tag)
+{
+  pending_++;
+#ifdef _WIN32
+  // 開くのは同期（CreateFile にオーバーラップ I/O は無い）で、読み込みだけを完了ポートで待つ
+  HANDLE file = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN | (port_ ? FILE_FLAG_OVERLAPPED : 0), NULL);
+  if (file != INVALID_HANDLE_VALUE && port_ && !CreateIoCompletionPort(file, port_, 0, 0))
+  {
+    CloseHandle(file);
+    file = INVALID_HANDLE_VALUE;
+  }
+  bool ok = file != INVALID_HANDLE_VALUE;
+  ready_.push_back({tag, ok, ok ? reinterpret_cast<BatchFile>(file) : kNoBatchFile, 0});
+#else
+#ifdef JERRYPARSER_IO_URING
+  if (ring_ >= 0)
+  {
+    auto *entry = static_cast<io_uring_sqe *>(NextEntry(Acquire(tag, true)));
+    entry->opcode = IORING_OP_OPENAT;
+    entry->fd = AT_FDCWD;
+    entry->addr = reinterpret_cast<uintptr_t>(filePath);
+    entry->open_flags = O_RDONLY | O_CLOEXEC;
+    return;
+  }
+#endif
+  int fd = open(filePath, O_RDONLY | O_CLOEXEC);
+  ready_.push_back({tag, fd >= 0, fd >= 0 ? fd : kNoBatchFile, 0});
+#endif
+}
+
+void BatchFileReader::Read(BatchFile file, uint64_t offset, char *buffer, size_t size, uint64_t tag)
+{
+  pending_++;
+#ifdef _WIN32
+  unsigned request = Acquire(tag, false);
+  auto *overlapped = reinterpret_cast<OVERLAPPED *>(requests_[request].overlapped);
+  *overlapped = {};
+  overlapped->Offset = static_cast<DWORD>(offset);
+  overlapped->OffsetHigh = static_cast<DWORD>(offset >> 32);
+  DWORD readBytes = 0;
+  BOOL done = ReadFile(reinterpret_cast<HANDLE>(file), buffer, static_cast<DWORD>(size), port_ ? NULL : &readBytes,
+                       overlapped);
+  // 完了ポートに結び付けたハンドルでは、すぐ終わった読み込みも完了ポートに通知される
+  DWORD error = done ? ERROR_SUCCESS : GetLastError();
+  if (port_ && (done || error == ERROR_IO_PENDING))
+  {
+    return;
+  }
+  freeRequests_.push_back(request);
+  // ファイルの終わりから読もうとしたときは 0 バイト読めたことにする
+  bool ok = done || error == ERROR_HANDLE_EOF;
+  ready_.push_back({tag, ok, kNoBatchFile, ok ? static_cast<size_t>(readBytes) : 0});
+#else
+#ifdef JERRYPARSER_IO_URING
+  if (ring_ >= 0)
+  {
+    auto *entry = static_cast<io_uring_sqe *>(NextEntry(Acquire(tag, false)));
+    entry->opcode = IORING_OP_READ;
+    entry->fd = static_cast<int>(file);
+    entry->off = offset;
+    entry->addr = reinterpret_cast<uintptr_t>(buffer);
+    entry->len = static_cast<unsigned>(size);
+    return;
+  }
+#endif
+  ssize_t readBytes;
+  do
+  {
+    readBytes = pread(static_cast<int>(file), buffer, size, static_cast<off_t>(offset));
+  } while (readBytes < 0 && errno == EINTR);
+  ready_.push_back({tag, readBytes >= 0, kNoBatchFile, readBytes >= 0 ? static_cast<size_t>(readBytes) : 0});
+#endif
+}
+
+bool BatchFileReader::Size(BatchFile file, uint64_t &size) const
+{
+#ifdef _WIN32
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(reinterpret_cast<HANDLE>(file), &fileSize))
+  {
+    return false;
+  }
+  size = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+  struct stat st;
+  if (fstat(static_cast<int>(file), &st) != 0)
+  {
+    return false;
+  }
+  size = static_cast<uint64_t>(st.st_size);
+#endif
+  return true;
+}
+
+void BatchFileReader::Close(BatchFile file)
+{
+#ifdef _WIN32
+  CloseHandle(reinterpret_cast<HANDLE>(file));
+#else
+  close(static_cast<int>(file));
+#endif
+}
+
+BatchCompletion BatchFileReader::Wait()
+{
+  pending_--;
+  if (!ready_.empty())
+  {
+    BatchCompletion completion = ready_.front();
+    ready_.pop_front();
+    return completion;
+  }
+
+#if defined(_WIN32)
+  DWORD readBytes = 0;
+  ULONG_PTR key;
+  OVERLAPPED *overlapped = nullptr;
+  BOOL ok = GetQueuedCompletionStatus(port_, &readBytes, &key, &overlapped, INFINITE);
+  // 失敗した読み込みも OVERLAPPED 付きで通知される（ファイルの終わりから読んだときは 0 バイト）
+  ok = ok || GetLastError() == ERROR_HANDLE_EOF;
+  unsigned request = static_cast<unsigned>(reinterpret_cast<Request *>(overlapped) - requests_.data());
+  freeRequests_.push_back(request);
+  return {requests_[request].tag, ok != FALSE, kNoBatchFile, ok ? static_cast<size_t>(readBytes) : 0};
+#elif defined(JERRYPARSER_IO_URING)
+  while (true)
+  {
+    unsigned head = *completeHead_;
+    if (head != std::atomic_ref<unsigned>(*completeTail_).load(std::memory_order_acquire))
+    {
+      const io_uring_cqe &entry = static_cast<const io_uring_cqe *>(completions_)[head & completeMask_];
+      unsigned request = static_cast<unsigned>(entry.user_data);
+      int result = entry.res;
+      std::atomic_ref<unsigned>(*completeHead_).store(head + 1, std::memory_order_release);
+
+      freeRequests_.push_back(request);
+      const Request &done = requests_[request];
+      if (done.open)
+      {
+        return {done.tag, result >= 0, result >= 0 ? result : kNoBatchFile, 0};
+      }
+      return {done.tag, result >= 0, kNoBatchFile, result >= 0 ? static_cast<size_t>(result) : 0};
+    }
+
+    // まだ渡していない要求を渡しながら、1つ終わるまで待つ
+    // シグナルなどで失敗しても要求はリングに残っているので、そのまま渡し直す
+    int submitted = IoUringEnter(ring_, unsubmitted_, 1);
+    if (submitted > 0)
+    {
+      unsubmitted_ -= static_cast<unsigned>(submitted);
+    }
+  }
+#else
+  // 要求はすべてその場で終わっているので、ここには来ない
+  return {0, false, kNoBatchFile, 0};
+#endif
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string_view>
+#include <vector>
+
+/**
+ * 開いたファイル（POSIX ではファイルディスクリプタ、Windows では HANDLE）
+ */
+using BatchFile = intptr_t;
+
+constexpr BatchFile kNoBatchFile = -1;
+
+/**
+ * 終わった要求
+ */
+struct BatchCompletion
+{
+  // 要求を出したときに渡した値
+  uint64_t tag;
+  bool ok;
+  // Open なら開いたファイル
+  BatchFile file;
+  // Read なら読んだバイト数（ファイルの終わりより後ろは読まない）
+  size_t size;
+};
+
+/**
+ * 多数のファイルを開く・読む要求をまとめて OS に渡し、終わったものから受け取るクラス
+ * 小さなファイルを1つずつ開いて読むと、ディスクには常に1つの要求しか届かず、待ち時間がそのまま積み重なる
+ * Linux は io_uring（システムコールを直接呼ぶので liburing は要らない）を使う
+ * Windows は I/O 完了ポートに結び付けたハンドルに、オーバーラップ I/O の ReadFile で読み込みを出す
+ * io_uring が使えない環境（古いカーネルや、コンテナで禁止されている場合）と他の OS では、要求をその場で1つずつ実行する
+ * 1つのスレッドから使い、同時に出しておける要求は depth 個まで
+ */
+class BatchFileReader
+{
+public:
+  explicit BatchFileReader(unsigned depth);
+  ~BatchFileReader();
+
+  BatchFileReader(const BatchFileReader &) = delete;
+  BatchFileReader &operator=(const BatchFileReader &) = delete;
+
+  /**
+   * filePath を読み取り専用で開く要求を出す（filePath は終わるまで有効なこと）
+   */
+  void Open(const char *filePath, uint64_t tag);
+
+  /**
+   * 開いたファイルの offset から size バイトを buffer に読む要求を出す（buffer は終わるまで有効なこと）
+   */
+  void Read(BatchFile file, uint64_t offset, char *buffer, size_t size, uint64_t tag);
+
+  /**
+   * 開いたファイルの大きさ（読めなければ false）
+   */
+  bool Size(BatchFile file, uint64_t &size) const;
+
+  /**
+   * 開いたファイルを閉じる（そのファイルへの要求が全部終わってから呼ぶ）
+   */
+  void Close(BatchFile file);
+
+  /**
+   * 出した要求を OS に渡し、どれか1つが終わるまで待つ（Pending が 0 なら呼ばない）
+   */
+  BatchCompletion Wait();
+
+  /**
+   * まだ Wait で受け取っていない要求の数
+   */
+  size_t Pending() const
+  {
+    return pending_;
+  }
+
+private:
+  /**
+   * 出した要求の中身（完了を待つ間、番号で引けるようにしておく）
+   */
+  struct Request
+  {
+#ifdef _WIN32
+    // OVERLAPPED の置き場（windows.h をヘッダーに持ち込まないよう大きさだけ確保する）
+    // 先頭に置くので、完了通知の OVERLAPPED* からそのまま Request が分かる
+    alignas(8) unsigned char overlapped[32];
+#endif
+    uint64_t tag;
+    bool open;
+  };
+
+  // 空いている Request の番号を取る
+  unsigned Acquire(uint64_t tag, bool open);
+#ifndef _WIN32
+  // io_uring のリングに次の要求を書く場所（中身は io_uring_sqe）
+  void *NextEntry(unsigned request);
+  // io_uring のリングを片付ける
+  void ReleaseRing();
+#endif
+
+  size_t pending_ = 0;
+  std::vector<Request> requests_;
+  std::vector<unsigned> freeRequests_;
+  // その場で終わった要求（OS の完了通知より先に Wait で返す）
+  std::deque<BatchCompletion> ready_;
+
+#ifdef _WIN32
+  // I/O 完了ポート（作れなければ nullptr で、読み込みはその場で終わる）
+  void *port_ = nullptr;
+#else
+  // io_uring のリング（使えなければ -1 で、要求はその場で実行する）
+  int ring_ = -1;
+  void *ringMemory_ = nullptr;
+  size_t ringMemorySize_ = 0;
+  void *completionMemory_ = nullptr;
+  size_t completionMemorySize_ = 0;
+  void *entries_ = nullptr;
+  size_t entriesSize_ = 0;
+  // リングの中の位置（カーネルと共有する）
+  unsigned *submitTail_ = nullptr;
+  unsigned submitMask_ = 0;
+  unsigned *submitArray_ = nullptr;
+  unsigned *completeHead_ = nullptr;
+  unsigned *completeTail_ = nullptr;
+  unsigned completeMask_ = 0;
+  void *completions_ = nullptr;
+  // リングに書いたが、まだカーネルに渡していない要求の数
+  unsigned unsubmitted_ = 0;
+#endif
+};
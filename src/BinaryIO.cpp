@@ -0,0 +1,71 @@
+#include "BinaryIO.h"
+
+#include <fstream>
+
+void AppendPurchases(std::string &out, const PurchaseColumns &purchases)
+{
+  AppendValue(out, static_cast<uint32_t>(purchases.Size()));
+  AppendValue(out, purchases.DayRollovers());
+  for (size_t i = 0; i < purchases.Size(); i++)
+  {
+    AppendValue(out, static_cast<uint8_t>(purchases.Kinds()[i] / 2));
+    AppendValue(out, static_cast<uint8_t>(purchases.Kinds()[i] & 1));
+    AppendValue(out, purchases.Costs()[i]);
+    AppendValue(out, purchases.Times()[i]);
+  }
+}
+
+bool ReadPurchases(std::string_view &in, PurchaseColumns &purchases)
+{
+  uint32_t count;
+  int32_t dayRollovers;
+  if (!ReadValue(in, count) || !ReadValue(in, dayRollovers) || in.size() / 14 < count)
+  {
+    return false;
+  }
+
+  purchases.Clear();
+  purchases.Reserve(count);
+  purchases.SetDayRollovers(dayRollovers);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    uint8_t tier;
+    uint8_t recombobulated;
+    int64_t cost;
+    int32_t time;
+    if (!ReadValue(in, tier) || !ReadValue(in, recombobulated) || !ReadValue(in, cost) || !ReadValue(in, time) ||
+        tier >= kMaxItemTiers)
+    {
+      return false;
+    }
+    purchases.Add(PurchaseKind(tier, recombobulated != 0), cost, time);
+  }
+  return true;
+}
+
+bool ReadBinaryFile(const std::filesystem::path &path, std::string &data)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+  {
+    return false;
+  }
+  data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return true;
+}
+
+bool WriteBinaryFileAtomically(const std::filesystem::path &path, std::string_view data)
+{
+  std::filesystem::path tempPath = path;
+  tempPath += ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.write(data.data(), data.size()))
+    {
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tempPath, path, ec);
+  return !ec;
+}
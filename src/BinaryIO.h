@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+#include "Purchase.h"
+
+/**
+ * 値をそのままのバイト列で追加する関数（保存ファイル用）
+ */
+template <typename T> void AppendValue(std::string &out, T value)
+{
+  char bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  out.append(bytes, sizeof(T));
+}
+
+/**
+ * AppendValue で書いた値を読み出す関数（足りなければ false）
+ */
+template <typename T> bool ReadValue(std::string_view &in, T &value)
+{
+  if (in.size() < sizeof(T))
+  {
+    return false;
+  }
+  std::memcpy(&value, in.data(), sizeof(T));
+  in.remove_prefix(sizeof(T));
+  return true;
+}
+
+/**
+ * 符号なし整数を LEB128 の可変長（7ビットずつ、小さい値ほど短い）で追加する関数
+ */
+inline void AppendVarint(std::string &out, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    out += static_cast<char>((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  out += static_cast<char>(value);
+}
+
+/**
+ * AppendVarint で書いた値を読み出す関数（途中で終わっていれば false）
+ */
+inline bool ReadVarint(std::string_view &in, uint64_t &value)
+{
+  value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7)
+  {
+    if (in.empty())
+    {
+      return false;
+    }
+    uint8_t byte = static_cast<uint8_t>(in.front());
+    in.remove_prefix(1);
+    value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (byte < 0x80)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * 符号付き整数を 0, -1, 1, -2, ... の順の符号なし整数にする（ZigZag、絶対値が小さいほど短くなる）
+ */
+constexpr uint64_t ZigZagEncode(int64_t value)
+{
+  return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+constexpr int64_t ZigZagDecode(uint64_t value)
+{
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+/**
+ * 購入データの列を 件数 u32 | 日付をまたいだ回数 i32 | (段階 u8 | Recomb u8 | コスト i64 | 時刻 i32) * 件数 で書き出す関数
+ */
+void AppendPurchases(std::string &out, const PurchaseColumns &purchases);
+
+bool ReadPurchases(std::string_view &in, PurchaseColumns &purchases);
+
+/**
+ * ファイル全体を読み込む関数（保存ファイル用）
+ */
+bool ReadBinaryFile(const std::filesystem::path &path, std::string &data);
+
+/**
+ * 一時ファイルに書いてから置き換える関数（途中で失敗しても元のファイルは壊れない）
+ */
+bool WriteBinaryFileAtomically(const std::filesystem::path &path, std::string_view data);
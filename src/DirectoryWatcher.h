@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+/**
+ * ディレクトリ内の変更を待つクラス
+ * Windows は FindFirstChangeNotification、Linux は inotify を使い、それ以外は一定間隔で確認する
+ */
+class DirectoryWatcher
+{
+public:
+  explicit DirectoryWatcher(const std::vector<std::filesystem::path> &directories);
+  ~DirectoryWatcher();
+
+  DirectoryWatcher(const DirectoryWatcher &) = delete;
+  DirectoryWatcher &operator=(const DirectoryWatcher &) = delete;
+
+  /**
+   * 変更があるか timeout が過ぎるまで待つ
+   */
+  void Wait(std::chrono::milliseconds timeout);
+
+private:
+#if defined(_WIN32)
+  // windows.h をヘッダーに持ち込まないよう、HANDLE は void* で持つ
+  std::vector<void *> handles_;
+#elif defined(__linux__)
+  int fd_ = -1;
+#endif
+};
@@ -0,0 +1,288 @@
+#include "FileSample.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+
+#include "Format.h"
+#include "TimeSeries.h"
+
+namespace
+{
+
+// 抽出の乱数の種
+constexpr uint64_t kSampleSeed = 0x4A65727279ULL;
+
+// 各月から少なくとも選ぶファイルの数（月ごとのばらつきを求めるには2個要る）
+constexpr size_t kMinPerStratum = 2;
+
+// 95% 信頼区間の標準正規分布の分位点
+constexpr double kZ95 = 1.959963984540054;
+
+// 日付の分からないファイルの月
+constexpr int32_t kUnknownMonth = INT32_MIN;
+
+/**
+ * ファイルの月（年 * 12 + 月 - 1、分からなければ kUnknownMonth）
+ */
+int32_t LogFileMonth(const std::string &filePath)
+{
+  int32_t day;
+  if (!LogFileDay(filePath, day))
+  {
+    return kUnknownMonth;
+  }
+  std::chrono::year_month_day ymd{std::chrono::sys_days(std::chrono::days(day))};
+  return static_cast<int>(ymd.year()) * 12 + static_cast<int>(static_cast<unsigned>(ymd.month())) - 1;
+}
+
+/**
+ * 層ごとに選ぶファイルの数を決める関数（合計はちょうど sampleSize）
+ * 各層にまず kMinPerStratum 個ずつ割り当て、残りをファイル数に比例して配り、端数は大きい順に1個ずつ足す
+ */
+std::vector<size_t> AllocateSample(const std::vector<size_t> &fileCounts, size_t totalFiles, size_t sampleSize)
+{
+  if (sampleSize >= totalFiles)
+  {
+    return fileCounts;
+  }
+
+  std::vector<size_t> take(fileCounts.size());
+  size_t taken = 0;
+  for (size_t stratum = 0; stratum < fileCounts.size(); stratum++)
+  {
+    take[stratum] = std::min({kMinPerStratum, fileCounts[stratum], sampleSize - taken});
+    taken += take[stratum];
+  }
+
+  size_t rest = sampleSize - taken;
+  std::vector<double> remainders(fileCounts.size());
+  for (size_t stratum = 0; stratum < fileCounts.size(); stratum++)
+  {
+    double exact = static_cast<double>(rest) * static_cast<double>(fileCounts[stratum]) / totalFiles;
+    size_t share = std::min(static_cast<size_t>(exact), fileCounts[stratum] - take[stratum]);
+    take[stratum] += share;
+    remainders[stratum] = exact - static_cast<double>(share);
+    taken += share;
+  }
+
+  std::vector<size_t> order(fileCounts.size());
+  for (size_t stratum = 0; stratum < order.size(); stratum++)
+  {
+    order[stratum] = stratum;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return remainders[a] > remainders[b]; });
+  bool grew = true;
+  while (taken < sampleSize && grew)
+  {
+    grew = false;
+    for (size_t stratum : order)
+    {
+      if (taken < sampleSize && take[stratum] < fileCounts[stratum])
+      {
+        take[stratum]++;
+        taken++;
+        grew = true;
+      }
+    }
+  }
+  return take;
+}
+
+} // namespace
+
+FileSample::FileSample(const std::vector<std::string> &files, size_t sampleSize) : stratumOfFile_(files.size())
+{
+  std::vector<int32_t> months(files.size());
+  std::map<int32_t, size_t> monthFiles;
+  for (size_t file = 0; file < files.size(); file++)
+  {
+    months[file] = LogFileMonth(files[file]);
+    monthFiles[months[file]]++;
+  }
+  monthCount_ = monthFiles.size();
+
+  // 月ごとの最少数だけで sampleSize を超えるなら、隣り合う月を sampleSize / 2 個以下の層にまとめる
+  // 層の境目は、それまでのファイル数で決めるので、各層のファイル数はほぼ等しくなる
+  size_t minimumTotal = 0;
+  for (const auto &[month, count] : monthFiles)
+  {
+    minimumTotal += std::min(kMinPerStratum, count);
+  }
+  bool merge = minimumTotal > sampleSize && sampleSize < files.size();
+  size_t groupCount = std::max<size_t>(1, sampleSize / kMinPerStratum);
+  std::map<int32_t, size_t> strata;
+  size_t filesBefore = 0;
+  size_t lastGroup = SIZE_MAX;
+  for (const auto &[month, count] : monthFiles)
+  {
+    size_t group = merge ? filesBefore * groupCount / files.size() : strata.size();
+    if (group != lastGroup)
+    {
+      strata_.emplace_back();
+      lastGroup = group;
+    }
+    strata.emplace(month, strata_.size() - 1);
+    filesBefore += count;
+  }
+
+  std::vector<std::vector<size_t>> members(strata_.size());
+  for (size_t file = 0; file < files.size(); file++)
+  {
+    stratumOfFile_[file] = strata[months[file]];
+    members[stratumOfFile_[file]].push_back(file);
+  }
+  std::vector<size_t> fileCounts(strata_.size());
+  for (size_t stratum = 0; stratum < strata_.size(); stratum++)
+  {
+    strata_[stratum].fileCount = members[stratum].size();
+    fileCounts[stratum] = members[stratum].size();
+  }
+
+  // 月ごとに、先頭から take 個を無作為に並べ替えて選ぶ
+  std::vector<size_t> take = AllocateSample(fileCounts, files.size(), sampleSize);
+  std::mt19937_64 random(kSampleSeed);
+  std::vector<char> picked(files.size());
+  for (size_t stratum = 0; stratum < strata_.size(); stratum++)
+  {
+    std::vector<size_t> &candidates = members[stratum];
+    for (size_t i = 0; i < take[stratum]; i++)
+    {
+      std::uniform_int_distribution<size_t> pick(i, candidates.size() - 1);
+      std::swap(candidates[i], candidates[pick(random)]);
+      picked[candidates[i]] = 1;
+    }
+  }
+
+  for (size_t file = 0; file < files.size(); file++)
+  {
+    if (picked[file])
+    {
+      strata_[stratumOfFile_[file]].chosen.push_back(chosen_.size());
+      chosenIndex_.emplace(files[file], chosen_.size());
+      chosen_.push_back(files[file]);
+    }
+  }
+  summaries_.resize(chosen_.size());
+  added_.resize(chosen_.size());
+}
+
+void FileSample::AddFile(const std::string &filePath, const PurchaseSummary &summary)
+{
+  auto it = chosenIndex_.find(filePath);
+  if (it == chosenIndex_.end())
+  {
+    return;
+  }
+  summaries_[it->second] = summary;
+  added_[it->second] = 1;
+}
+
+bool FileSample::Estimate(const ItemFamily &family, long long recombobulatorPrice, double &price,
+                          double &margin) const
+{
+  // 各ファイルのコストと最初の段階換算の個数を、月のファイル数 / 集計できたファイル数 倍して全体の合計を推定する
+  struct Totals
+  {
+    std::vector<double> costs;
+    std::vector<double> bases;
+  };
+  std::vector<Totals> strata(strata_.size());
+  double cost = 0;
+  double base = 0;
+  for (size_t stratum = 0; stratum < strata_.size(); stratum++)
+  {
+    Totals &totals = strata[stratum];
+    for (size_t chosen : strata_[stratum].chosen)
+    {
+      if (added_[chosen])
+      {
+        totals.costs.push_back(
+            static_cast<double>(family.CostWithoutRecombobulators(summaries_[chosen], recombobulatorPrice)));
+        totals.bases.push_back(static_cast<double>(family.BaseEquivalent(summaries_[chosen])));
+      }
+    }
+    if (totals.costs.empty())
+    {
+      continue;
+    }
+    double weight = static_cast<double>(strata_[stratum].fileCount) / static_cast<double>(totals.costs.size());
+    for (size_t i = 0; i < totals.costs.size(); i++)
+    {
+      cost += weight * totals.costs[i];
+      base += weight * totals.bases[i];
+    }
+  }
+  if (base <= 0)
+  {
+    return false;
+  }
+  price = cost / base;
+
+  // 比推定の分散は、各ファイルの残差 cost - price * base の月ごとの分散から求める（有限母集団修正つき）
+  double variance = 0;
+  for (size_t stratum = 0; stratum < strata_.size(); stratum++)
+  {
+    const Totals &totals = strata[stratum];
+    size_t n = totals.costs.size();
+    if (n < 2)
+    {
+      continue;
+    }
+    double mean = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+      mean += totals.costs[i] - price * totals.bases[i];
+    }
+    mean /= static_cast<double>(n);
+    double squares = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+      double residual = totals.costs[i] - price * totals.bases[i] - mean;
+      squares += residual * residual;
+    }
+    double fileCount = static_cast<double>(strata_[stratum].fileCount);
+    variance += fileCount * fileCount * (1 - static_cast<double>(n) / fileCount) * (squares / (n - 1)) / n;
+  }
+  margin = kZ95 * std::sqrt(variance) / base;
+  return true;
+}
+
+void PrintSampleEstimate(std::ostream &out, const FileSample &sample, const ItemCatalog &catalog,
+                         long long recombobulatorPrice)
+{
+  out << "\n========= Sample Estimate =========\n";
+  out << "Sampled " << sample.Chosen().size() << " of " << sample.FileCount() << " files from "
+      << sample.MonthCount() << " months";
+  if (sample.StratumCount() < sample.MonthCount())
+  {
+    out << " (grouped into " << sample.StratumCount() << (sample.StratumCount() == 1 ? " run" : " runs")
+        << " of adjacent months to keep the sample size)";
+  }
+  out << '\n';
+  for (const auto &family : catalog.Families())
+  {
+    out << "-------------------------------------------\n";
+    double price;
+    double margin;
+    if (!sample.Estimate(family, recombobulatorPrice, price, margin))
+    {
+      out << "Per " << family.BaseItemName() << ": no purchases in the sampled files\n";
+      continue;
+    }
+    long long estimate = std::llround(price);
+    long long low = std::llround(price - margin);
+    long long high = std::llround(price + margin);
+    char percent[32];
+    std::snprintf(percent, sizeof(percent), "%.1f%%", price != 0 ? 100 * margin / std::abs(price) : 0.0);
+    out << "Per " << family.BaseItemName() << ": " << FormatCoins(estimate) << " (" << FormatNumber(estimate)
+        << " coins) +/- " << percent << "\n";
+    out << "95% CI: " << FormatCoins(low) << " - " << FormatCoins(high) << " (" << FormatNumber(low) << " - "
+        << FormatNumber(high) << " coins)\n";
+  }
+  out << "=============================================" << std::endl;
+}
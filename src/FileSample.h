@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ItemCatalog.h"
+#include "Purchase.h"
+
+/**
+ * ログファイルを月ごとに層別して無作為に選び、選んだファイルの集計から全体の平均価格を推定するクラス
+ * 月は LogFileDay の日付の月で、日付の分からないファイルは1つの月としてまとめる
+ * 各月から2個（月のファイルが1個ならその1個）と、残りをファイル数に比例した数だけ選び、合計はちょうど sampleSize にする
+ * 月ごとの2個だけで sampleSize を超える場合は、隣り合う月をまとめた層を月の代わりに使う
+ * 乱数の種は固定なので、同じファイルの集まりからは毎回同じファイルが選ばれ、2回目からはキャッシュが効く
+ * 推定は層別の比推定で、最初の段階1個あたりの価格とその 95% 信頼区間を求める
+ */
+class FileSample
+{
+public:
+  FileSample(const std::vector<std::string> &files, size_t sampleSize);
+
+  /**
+   * 選んだファイル（files の順）
+   */
+  const std::vector<std::string> &Chosen() const
+  {
+    return chosen_;
+  }
+
+  size_t FileCount() const
+  {
+    return stratumOfFile_.size();
+  }
+
+  size_t MonthCount() const
+  {
+    return monthCount_;
+  }
+
+  /**
+   * 層の数（隣り合う月をまとめていなければ MonthCount と同じ）
+   */
+  size_t StratumCount() const
+  {
+    return strata_.size();
+  }
+
+  /**
+   * 選んだファイル1つ分の集計を加える（ファイルごとに別の場所に書くので、別々のスレッドから呼んでよい）
+   * 開けなかったファイルは加えなくてよく、そのファイルは選ばなかったものとして推定する
+   */
+  void AddFile(const std::string &filePath, const PurchaseSummary &summary);
+
+  /**
+   * 系統の最初の段階1個あたりの価格の推定値と、95% 信頼区間の半分の幅（推定できなければ false）
+   */
+  bool Estimate(const ItemFamily &family, long long recombobulatorPrice, double &price, double &margin) const;
+
+private:
+  struct Stratum
+  {
+    // 層に含まれるファイルの数
+    size_t fileCount = 0;
+    // 選んだファイルの chosen_ での番号
+    std::vector<size_t> chosen;
+  };
+
+  std::vector<Stratum> strata_;
+  size_t monthCount_ = 0;
+  // files の各ファイルの層の番号
+  std::vector<size_t> stratumOfFile_;
+  std::vector<std::string> chosen_;
+  std::unordered_map<std::string, size_t> chosenIndex_;
+  std::vector<PurchaseSummary> summaries_;
+  std::vector<char> added_;
+};
+
+/**
+ * 抽出したファイル数と、系統ごとの最初の段階1個あたりの価格の推定値・95% 信頼区間を表示する関数
+ */
+void PrintSampleEstimate(std::ostream &out, const FileSample &sample, const ItemCatalog &catalog,
+                         long long recombobulatorPrice);
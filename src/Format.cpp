@@ -0,0 +1,157 @@
+#include "Format.h"
+
+#include <charconv>
+#include <climits>
+#include <cstdio>
+#include <locale>
+#include <stdexcept>
+
+namespace
+{
+
+/**
+ * ユーザーのロケールの桁区切り
+ */
+struct DigitGrouping
+{
+  char separator = ',';
+  // std::numpunct::grouping と同じ形式（右から順に各グループの桁数、最後の値を繰り返す）
+  std::string grouping;
+};
+
+const DigitGrouping &UserDigitGrouping()
+{
+  static const DigitGrouping grouping = [] {
+    DigitGrouping result;
+    try
+    {
+      std::locale user("");
+      const auto &punct = std::use_facet<std::numpunct<char>>(user);
+      result.separator = punct.thousands_sep();
+      result.grouping = punct.grouping();
+    }
+    catch (const std::runtime_error &)
+    {
+      // ロケールの環境変数が壊れていれば、区切らない "C" ロケールと同じにする
+    }
+    return result;
+  }();
+  return grouping;
+}
+
+// K/M/B の単位（大きい順）
+struct CoinUnit
+{
+  long long scale;
+  double divisor;
+  char suffix;
+};
+constexpr CoinUnit kCoinUnits[] = {{1000000000, 1000000000.0, 'B'}, {1000000, 1000000.0, 'M'}, {1000, 1000.0, 'K'}};
+
+// 2^53 未満のコインを割った double の誤差は、丸めの境目までの距離（余りの2倍と単位の差）で 20 未満に収まる
+constexpr long long kTieMargin = 20;
+
+} // namespace
+
+std::string FormatNumber(long long num)
+{
+  FormatBuffer buffer;
+  return std::string(FormatNumber(num, buffer));
+}
+
+std::string_view FormatNumber(long long num, FormatBuffer &buffer)
+{
+  char digits[24];
+  unsigned long long magnitude = num < 0 ? 0ULL - static_cast<unsigned long long>(num) : num;
+  const char *digit = std::to_chars(digits, digits + sizeof(digits), magnitude).ptr;
+
+  // 下の桁から区切りを入れながら、buffer の後ろから詰めていく
+  const DigitGrouping &grouping = UserDigitGrouping();
+  char *out = buffer.data() + buffer.size();
+  size_t group = 0;
+  int groupSize = grouping.grouping.empty() ? 0 : grouping.grouping[0];
+  int inGroup = 0;
+  while (digit != digits)
+  {
+    if (groupSize > 0 && groupSize != CHAR_MAX && inGroup == groupSize)
+    {
+      *--out = grouping.separator;
+      inGroup = 0;
+      if (group + 1 < grouping.grouping.size())
+      {
+        groupSize = grouping.grouping[++group];
+      }
+    }
+    *--out = *--digit;
+    inGroup++;
+  }
+  if (num < 0)
+  {
+    *--out = '-';
+  }
+  return std::string_view(out, buffer.data() + buffer.size() - out);
+}
+
+std::string FormatCoins(long long coins)
+{
+  FormatBuffer buffer;
+  return std::string(FormatCoins(coins, buffer));
+}
+
+std::string_view FormatCoins(long long coins, FormatBuffer &buffer)
+{
+  char *begin = buffer.data();
+  char *end = buffer.data() + buffer.size();
+  for (const CoinUnit &unit : kCoinUnits)
+  {
+    if (coins < unit.scale)
+    {
+      continue;
+    }
+
+    // std::fixed と std::setprecision(1) で double を出力した場合と同じく、小数点以下1桁に丸める
+    // 割った値が double で十分正確で、丸めの境目から離れていれば、整数の計算だけで同じ結果になる
+    if (coins < (1LL << 53))
+    {
+      long long tenths = coins * 10 / unit.scale;
+      long long twiceRemainder = coins * 10 % unit.scale * 2;
+      if (twiceRemainder < unit.scale - kTieMargin || twiceRemainder > unit.scale + kTieMargin)
+      {
+        tenths += twiceRemainder > unit.scale;
+        char *last = std::to_chars(begin, end, tenths / 10).ptr;
+        *last++ = '.';
+        *last++ = static_cast<char>('0' + tenths % 10);
+        *last++ = unit.suffix;
+        return std::string_view(begin, last - begin);
+      }
+    }
+    char *last = std::to_chars(begin, end - 1, coins / unit.divisor, std::chars_format::fixed, 1).ptr;
+    *last++ = unit.suffix;
+    return std::string_view(begin, last - begin);
+  }
+  return std::string_view(begin, std::to_chars(begin, end, coins).ptr - begin);
+}
+
+void AppendJsonString(std::string &out, std::string_view text)
+{
+  out += '"';
+  for (char c : text)
+  {
+    if (c == '"' || c == '\\')
+    {
+      out += '\\';
+      out += c;
+    }
+    else if (static_cast<unsigned char>(c) < 0x20)
+    {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out += escaped;
+    }
+    else
+    {
+      out += c;
+    }
+  }
+  out += '"';
+}
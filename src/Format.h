@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+
+/**
+ * FormatNumber / FormatCoins の書き込み先（どちらの結果も必ず収まる大きさ）
+ */
+using FormatBuffer = std::array<char, 64>;
+
+/**
+ * 数値にカンマ付けする関数（千単位区切り）
+ * 区切り文字と桁の区切り方はユーザーのロケール（std::locale("")）に従う
+ */
+std::string FormatNumber(long long num);
+
+/**
+ * FormatNumber と同じ内容を buffer に書き込み、書き込んだ部分を返す
+ * ロケールの区切り方は最初の呼び出しで一度だけ調べるので、大量に呼んでも確保は起きない
+ */
+std::string_view FormatNumber(long long num, FormatBuffer &buffer);
+
+/**
+ * コインを "1.3m" のような形式にフォーマットする
+ * 1,000,000,000以上は "1.3B", 1,000,000以上は "1.3M", 1,000以上は "1.3K, それ以下はそのままの数値を返す
+ */
+std::string FormatCoins(long long coins);
+
+/**
+ * FormatCoins と同じ内容を buffer に書き込み、書き込んだ部分を返す
+ */
+std::string_view FormatCoins(long long coins, FormatBuffer &buffer);
+
+/**
+ * text を JSON の文字列リテラルとして out に追加する（" と \ と制御文字をエスケープする）
+ */
+void AppendJsonString(std::string &out, std::string_view text);
@@ -0,0 +1,298 @@
+#include "GzipDecoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <thread>
+
+#include <zlib.h>
+
+#ifdef JERRYPARSER_WITH_LIBDEFLATE
+#include <libdeflate.h>
+#endif
+
+#include "LogFile.h"
+#include "ParallelInflate.h"
+
+namespace
+{
+
+/**
+ * zlib の inflate で少しずつ展開するバックエンド
+ * 展開後のサイズに関係なく、使用するメモリは走査器のバッファ1つ分で済む
+ * zlib-ng を互換モードでビルドしたものにリンクすれば、そのまま zlib-ng で展開される
+ */
+class ZlibGzipDecoder : public GzipDecoder
+{
+public:
+  void Decode(std::string_view data, PurchaseStreamScanner &scanner, FileStats *stats) const override
+  {
+    // zlib の作業領域と 32KB の窓をファイルごとに確保し直さないよう、スレッドごとの展開器を使い回す
+    thread_local GzipReader reader;
+    reader.Reset(data);
+
+    // マップしたページの読み込みも含むので、まとめて展開の時間として数える
+    auto inflateChunk = [&] {
+      StageTimer timer(stats, Stage::INFLATE);
+      return reader.Read(scanner.WritePointer(), scanner.WritableSize());
+    };
+    size_t readBytes;
+    while ((readBytes = inflateChunk()) > 0)
+    {
+      scanner.Commit(readBytes);
+    }
+  }
+};
+
+#ifdef JERRYPARSER_WITH_LIBDEFLATE
+/**
+ * gzipメンバーの末尾にある展開後のサイズ（ISIZE）
+ */
+uint32_t GzipMemberSize(std::string_view member)
+{
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(member.data() + member.size() - 4);
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+/**
+ * libdeflate でメンバーごとに一括展開するバックエンド
+ * zlib より高速だが、メンバー1つ分の展開後のサイズのメモリを使う
+ */
+class LibdeflateGzipDecoder : public GzipDecoder
+{
+public:
+  void Decode(std::string_view data, PurchaseStreamScanner &scanner, FileStats *stats) const override
+  {
+    // 展開器の確保はファイルごとに行わず、スレッドごとに1つを使い回す
+    thread_local std::unique_ptr<libdeflate_decompressor, decltype(&libdeflate_free_decompressor)> decompressor(
+        libdeflate_alloc_decompressor(), &libdeflate_free_decompressor);
+    if (!decompressor)
+    {
+      throw std::bad_alloc();
+    }
+
+    std::string_view input = data;
+    // 展開先もスレッドごとに使い回し、一番大きかったメンバーの分だけを持ち続ける
+    thread_local std::vector<char> output;
+    // 後ろにゴミが付いていれば、gzread と同じく無視する
+    while (input.size() >= 18 && HasGzipMagic(input))
+    {
+      size_t capacity = std::max<size_t>(GzipMemberSize(input), input.size());
+      size_t inputUsed = 0;
+      size_t outputUsed = 0;
+      libdeflate_result result;
+      StageTimer inflateTimer(stats, Stage::INFLATE);
+      while (true)
+      {
+        output.resize(capacity);
+        result = libdeflate_gzip_decompress_ex(decompressor.get(), input.data(), input.size(), output.data(),
+                                               output.size(), &inputUsed, &outputUsed);
+        if (result != LIBDEFLATE_INSUFFICIENT_SPACE)
+        {
+          break;
+        }
+        capacity *= 2;
+      }
+      inflateTimer.Stop();
+      if (result != LIBDEFLATE_SUCCESS)
+      {
+        break;
+      }
+
+      scanner.Feed(std::string_view(output.data(), outputUsed));
+      input.remove_prefix(inputUsed);
+    }
+  }
+};
+#endif
+
+/**
+ * 1つのメンバーだけの大きな gzip を、ParallelInflater で複数のスレッドに分けて展開するバックエンド
+ * 区切りが1つにしかならない小さなファイルと、1つ目のメンバーの後ろに続くメンバーは zlib で展開する
+ */
+class ParallelGzipDecoder : public GzipDecoder
+{
+public:
+  explicit ParallelGzipDecoder(size_t threads) : inflater_(threads)
+  {
+  }
+
+  void Decode(std::string_view data, PurchaseStreamScanner &scanner, FileStats *stats) const override
+  {
+    ParallelInflater::FileScope scope(inflater_);
+    if (!inflater_.IsWorthSplitting(data))
+    {
+      zlib_.Decode(data, scanner, stats);
+      return;
+    }
+
+    // 展開したデータを走査している間も他のスレッドは展開しているので、走査に渡している時間を除いて展開の時間とする
+    auto begin = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration scanning{};
+    ParallelInflateResult result = inflater_.Inflate(data, [&](std::string_view part) {
+      auto scanBegin = std::chrono::steady_clock::now();
+      scanner.Feed(part);
+      scanning += std::chrono::steady_clock::now() - scanBegin;
+    });
+    if (stats)
+    {
+      stats->stageTime[static_cast<size_t>(Stage::INFLATE)] += std::chrono::steady_clock::now() - begin - scanning;
+    }
+
+    // 後ろにゴミが付いていれば、gzread と同じく無視する
+    std::string_view rest = data.substr(result.consumed);
+    if (result.complete && HasGzipMagic(rest))
+    {
+      zlib_.Decode(rest, scanner, stats);
+    }
+  }
+
+private:
+  ParallelInflater inflater_;
+  ZlibGzipDecoder zlib_;
+};
+
+/**
+ * 見つかった件数を数えながら sink へ渡す Sink
+ */
+class CountingSink : public PurchaseSink
+{
+public:
+  explicit CountingSink(PurchaseSink &sink) : sink_(sink)
+  {
+  }
+
+  void OnPurchase(const TalismanPurchase &purchase) override
+  {
+    count_++;
+    sink_.OnPurchase(purchase);
+  }
+
+  void OnInvalidCost(std::string_view cost) override
+  {
+    sink_.OnInvalidCost(cost);
+  }
+
+  void OnDayRollover() override
+  {
+    sink_.OnDayRollover();
+  }
+
+  size_t Count() const
+  {
+    return count_;
+  }
+
+private:
+  PurchaseSink &sink_;
+  size_t count_ = 0;
+};
+
+/**
+ * メモリマップした .log.gz を展開しながら走査する関数
+ */
+void ScanGzData(std::string_view data, const GzipDecoder &decoder, const ItemCatalog &catalog, PurchaseSink &sink,
+                FileStats *stats)
+{
+  // 256KB のバッファをファイルごとに確保し直さないよう、スレッドごとの走査器を使い回す
+  thread_local PurchaseStreamScanner scanner;
+  scanner.Reset(&sink);
+  scanner.SetStats(stats);
+  scanner.SetCatalog(catalog);
+  decoder.Decode(data, scanner, stats);
+  scanner.Finish();
+}
+
+} // namespace
+
+std::unique_ptr<GzipDecoder> CreateGzipDecoder(InflateBackend backend, size_t threads)
+{
+  switch (backend)
+  {
+  case InflateBackend::ZLIB:
+    return std::make_unique<ZlibGzipDecoder>();
+  case InflateBackend::LIBDEFLATE:
+#ifdef JERRYPARSER_WITH_LIBDEFLATE
+    return std::make_unique<LibdeflateGzipDecoder>();
+#else
+    return nullptr;
+#endif
+  case InflateBackend::PARALLEL:
+    return std::make_unique<ParallelGzipDecoder>(threads > 0 ? threads
+                                                             : std::max(std::thread::hardware_concurrency(), 1u));
+  }
+  return nullptr;
+}
+
+bool ScanPurchasesFromFile(const std::string &filePath, const GzipDecoder &decoder, const ItemCatalog &catalog,
+                           PurchaseSink &sink, FileStats *stats)
+{
+  // 圧縮の有無にかかわらず一度だけ開いてメモリマップし、マップした先頭で判定する
+  StageTimer openTimer(stats, Stage::OPEN);
+  MappedFile file(filePath);
+  if (!file.IsOpen())
+  {
+    return false;
+  }
+  openTimer.Stop();
+
+  ScanPurchasesFromData(file.View(), decoder, catalog, sink, stats);
+  return true;
+}
+
+void ScanPurchasesFromData(std::string_view data, const GzipDecoder &decoder, const ItemCatalog &catalog,
+                           PurchaseSink &sink, FileStats *stats)
+{
+  CountingSink counter(sink);
+  if (stats)
+  {
+    stats->bytesIn = data.size();
+  }
+
+  if (HasGzipMagic(data))
+  {
+    ScanGzData(data, decoder, catalog, counter, stats);
+  }
+  else
+  {
+    // 非圧縮のログはコピーせずに走査する（ページの読み込みは走査の時間に含まれる）
+    {
+      StageTimer timer(stats, Stage::SCAN);
+      ScanPurchases(data, catalog, counter);
+    }
+    if (stats)
+    {
+      stats->bytesOut = data.size();
+      stats->lines = CountLines(data);
+    }
+  }
+
+  if (stats)
+  {
+    stats->matches = counter.Count();
+  }
+}
+
+PurchaseColumns ExtractPurchasesFromFile(const std::string &filePath, const GzipDecoder &decoder,
+                                         const ItemCatalog &catalog, FileStats *stats)
+{
+  PurchaseColumns purchases;
+  ExtractPurchasesFromFile(filePath, decoder, catalog, purchases, stats);
+  return purchases;
+}
+
+bool ExtractPurchasesFromFile(const std::string &filePath, const GzipDecoder &decoder, const ItemCatalog &catalog,
+                              PurchaseColumns &purchases, FileStats *stats)
+{
+  purchases.Clear();
+  PurchaseColumnsSink sink(purchases);
+  return ScanPurchasesFromFile(filePath, decoder, catalog, sink, stats);
+}
+
+void ExtractPurchasesFromData(std::string_view data, const GzipDecoder &decoder, const ItemCatalog &catalog,
+                              PurchaseColumns &purchases, FileStats *stats)
+{
+  purchases.Clear();
+  PurchaseColumnsSink sink(purchases);
+  ScanPurchasesFromData(data, decoder, catalog, sink, stats);
+}
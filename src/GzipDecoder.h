@@ -0,0 +1,77 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "PurchaseScanner.h"
+#include "Stats.h"
+
+/**
+ * gzipを展開して走査器へ渡すバックエンド
+ */
+class GzipDecoder
+{
+public:
+  virtual ~GzipDecoder() = default;
+
+  /**
+   * gzip ファイル全体 data を展開し、展開したデータを順に scanner へ渡す（Finish は呼び出し側で行う）
+   * data は呼び出し側でメモリマップしたもので、ファイルを開き直すことはない
+   * stats が nullptr でなければ、展開の時間を加える
+   */
+  virtual void Decode(std::string_view data, PurchaseStreamScanner &scanner, FileStats *stats) const = 0;
+};
+
+/**
+ * gzip展開のバックエンドの種類
+ */
+enum class InflateBackend
+{
+  ZLIB,
+  LIBDEFLATE,
+  // 1つの大きなメンバーを区切って複数のスレッドで展開する（小さなファイルは zlib）
+  PARALLEL
+};
+
+/**
+ * バックエンドを生成する関数（ビルドに含まれていなければ nullptr）
+ * threads は PARALLEL が1つのファイルに使うスレッドの最大数（0 なら CPU の数）
+ */
+std::unique_ptr<GzipDecoder> CreateGzipDecoder(InflateBackend backend, size_t threads = 0);
+
+/**
+ * ファイルから catalog の品目の購入ログを走査し、見つかった順に sink へ渡す関数（開けなければ false）
+ * ファイルは一度だけ開いてメモリマップし、先頭のマジックナンバーが gzip なら decoder で展開しながら、
+ * そうでなければマップした内容をそのまま走査する
+ * stats が nullptr でなければ、各段階の時間・バイト数・行数・件数を加える
+ */
+bool ScanPurchasesFromFile(const std::string &filePath, const GzipDecoder &decoder, const ItemCatalog &catalog,
+                           PurchaseSink &sink, FileStats *stats = nullptr);
+
+/**
+ * 呼び出し側でメモリマップしたファイルの内容 data を走査する版
+ * フィンガープリントを求めるなど、同じマップを走査の前にも使う場合はこれを使えば開き直さずに済む
+ */
+void ScanPurchasesFromData(std::string_view data, const GzipDecoder &decoder, const ItemCatalog &catalog,
+                           PurchaseSink &sink, FileStats *stats = nullptr);
+
+/**
+ * ファイルから catalog の品目の購入ログを抽出する関数
+ * stats が nullptr でなければ、各段階の時間・バイト数・行数・件数を加える
+ */
+PurchaseColumns ExtractPurchasesFromFile(const std::string &filePath, const GzipDecoder &decoder,
+                                         const ItemCatalog &catalog, FileStats *stats = nullptr);
+
+/**
+ * purchases を空にしてから抽出結果を書き込む版（開けなければ false）
+ * ワーカーごとの入れ物を使い回せば、確保し直すのはそれまでのファイルより購入が多かったときだけになる
+ */
+bool ExtractPurchasesFromFile(const std::string &filePath, const GzipDecoder &decoder, const ItemCatalog &catalog,
+                              PurchaseColumns &purchases, FileStats *stats = nullptr);
+
+/**
+ * メモリマップしたファイルの内容 data から、purchases を空にしてから抽出結果を書き込む版
+ */
+void ExtractPurchasesFromData(std::string_view data, const GzipDecoder &decoder, const ItemCatalog &catalog,
+                              PurchaseColumns &purchases, FileStats *stats = nullptr);
@@ -0,0 +1,360 @@
+#include "ItemCatalog.h"
+
+#include <charconv>
+#include <deque>
+#include <unordered_set>
+
+#include "BinaryIO.h"
+#include "TextUtil.h"
+#include "XxHash.h"
+
+namespace
+{
+
+/**
+ * 既定の表
+ * Recombobulated の品目はレアリティが1つ上がる（Green: a→9, Blue: 9→5, Purple: 5→6, Golden: 6→d）
+ */
+constexpr std::string_view kJerryItemTable =
+    "Jerry Talisman | Green  | 1   | 9 | Green Jerry Talisman  | Green Jerry Artifact\n"
+    "Jerry Talisman | Blue   | 5   | 5 | Blue Jerry Talisman   | Blue Jerry Artifact\n"
+    "Jerry Talisman | Purple | 25  | 6 | Purple Jerry Talisman | Purple Jerry Artifact\n"
+    "Jerry Talisman | Golden | 125 | d | Golden Jerry Talisman | Golden Jerry Artifact\n";
+
+// その状態で終わる品目名が無いことを表す ItemCatalog::outputs_ の値
+constexpr uint32_t kNoPattern = UINT32_MAX;
+
+} // namespace
+
+long long ItemFamily::PurchaseCount(const PurchaseSummary &summary) const
+{
+  long long count = 0;
+  for (size_t tier = 0; tier < tiers.size(); tier++)
+  {
+    count += Count(summary, tier, false) + Count(summary, tier, true);
+  }
+  return count;
+}
+
+long long ItemFamily::TotalCost(const PurchaseSummary &summary) const
+{
+  long long cost = 0;
+  for (size_t tier = 0; tier < tiers.size(); tier++)
+  {
+    cost += summary.costs[PurchaseKind(firstTier + tier, false)] + summary.costs[PurchaseKind(firstTier + tier, true)];
+  }
+  return cost;
+}
+
+long long ItemFamily::RecombobulatedCount(const PurchaseSummary &summary) const
+{
+  long long count = 0;
+  for (size_t tier = 0; tier < tiers.size(); tier++)
+  {
+    count += Count(summary, tier, true);
+  }
+  return count;
+}
+
+long long ItemFamily::BaseEquivalent(const PurchaseSummary &summary) const
+{
+  long long count = 0;
+  for (size_t tier = 0; tier < tiers.size(); tier++)
+  {
+    count += (Count(summary, tier, false) + Count(summary, tier, true)) * tiers[tier].multiplier;
+  }
+  return count;
+}
+
+long long ItemFamily::CostWithoutRecombobulators(const PurchaseSummary &summary, long long recombobulatorPrice) const
+{
+  return TotalCost(summary) - RecombobulatedCount(summary) * recombobulatorPrice;
+}
+
+long long ItemFamily::PricePerBase(const PurchaseSummary &summary, long long recombobulatorPrice) const
+{
+  long long baseEquivalent = BaseEquivalent(summary);
+  if (baseEquivalent <= 0)
+  {
+    return 0;
+  }
+  return static_cast<long long>(static_cast<double>(CostWithoutRecombobulators(summary, recombobulatorPrice)) /
+                                baseEquivalent);
+}
+
+const ItemCatalog &ItemCatalog::Jerry()
+{
+  static const ItemCatalog catalog = [] {
+    ItemCatalog jerry;
+    std::string error;
+    jerry.Parse(kJerryItemTable, "built-in item table", error);
+    return jerry;
+  }();
+  return catalog;
+}
+
+bool ItemCatalog::Parse(std::string_view text, const std::string &source, std::string &error)
+{
+  std::vector<ItemFamily> families;
+  std::unordered_set<std::string_view> itemNames;
+  size_t tierCount = 0;
+  size_t lineNumber = 0;
+  auto fail = [&](std::string_view message, std::string_view detail = {}) {
+    error = source + ":" + std::to_string(lineNumber) + ": " + std::string(message) + std::string(detail);
+    return false;
+  };
+
+  while (!text.empty())
+  {
+    size_t lineEnd = text.find('\n');
+    std::string_view line = Trim(text.substr(0, lineEnd));
+    text.remove_prefix(lineEnd == std::string_view::npos ? text.size() : lineEnd + 1);
+    lineNumber++;
+    if (line.empty() || line.front() == '#')
+    {
+      continue;
+    }
+
+    std::vector<std::string_view> fields;
+    while (true)
+    {
+      size_t separator = line.find('|');
+      fields.push_back(Trim(line.substr(0, separator)));
+      if (separator == std::string_view::npos)
+      {
+        break;
+      }
+      line.remove_prefix(separator + 1);
+    }
+    if (fields.size() < 5)
+    {
+      return fail("expected family | tier | multiplier | recombobulated rarity | item name...");
+    }
+    if (fields[0].empty() || fields[1].empty())
+    {
+      return fail("empty family or tier name");
+    }
+
+    ItemTier tier;
+    tier.name = fields[1];
+    auto [ptr, ec] = std::from_chars(fields[2].data(), fields[2].data() + fields[2].size(), tier.multiplier);
+    if (ec != std::errc{} || ptr != fields[2].data() + fields[2].size() || tier.multiplier <= 0)
+    {
+      return fail("invalid multiplier: ", fields[2]);
+    }
+    if (fields[3].size() != 1)
+    {
+      return fail("recombobulated rarity must be one color code character or -: ", fields[3]);
+    }
+    tier.recombobulatedRarity = fields[3] == "-" ? 0 : fields[3][0];
+    for (size_t i = 4; i < fields.size(); i++)
+    {
+      if (fields[i].empty())
+      {
+        return fail("empty item name");
+      }
+      if (!itemNames.insert(fields[i]).second)
+      {
+        return fail("duplicate item name: ", fields[i]);
+      }
+      tier.itemNames.emplace_back(fields[i]);
+    }
+
+    if (families.empty() || families.back().name != fields[0])
+    {
+      for (const auto &family : families)
+      {
+        if (family.name == fields[0])
+        {
+          return fail("tiers of a family must be on consecutive lines: ", fields[0]);
+        }
+      }
+      families.push_back({std::string(fields[0]), tierCount, {}});
+    }
+    for (const auto &other : families.back().tiers)
+    {
+      if (other.name == tier.name)
+      {
+        return fail("duplicate tier: ", fields[1]);
+      }
+    }
+    if (tierCount == kMaxItemTiers)
+    {
+      return fail("too many tiers (at most 32)");
+    }
+    families.back().tiers.push_back(std::move(tier));
+    tierCount++;
+  }
+
+  if (tierCount == 0)
+  {
+    error = source + ": no items";
+    return false;
+  }
+  families_ = std::move(families);
+  Build();
+  return true;
+}
+
+bool ItemCatalog::Load(const std::filesystem::path &path, std::string &error)
+{
+  std::string text;
+  if (!ReadBinaryFile(path, text))
+  {
+    error = "could not open the item table: " + path.string();
+    return false;
+  }
+  return Parse(text, path.string(), error);
+}
+
+bool ItemCatalog::FindLastItem(std::string_view text, size_t minBegin, ItemMatch &match) const
+{
+  uint32_t foundPattern = kNoPattern;
+  uint32_t row = 0;
+  for (size_t i = 0; i < text.size(); i++)
+  {
+    row = transitions_[row + byteClasses_[static_cast<unsigned char>(text[i])]];
+    // 同じ位置で終わる品目名は、最も短いものが最も後ろから始まる
+    uint32_t pattern = outputs_[row >> classShift_];
+    if (pattern == kNoPattern)
+    {
+      continue;
+    }
+    size_t begin = i + 1 - patterns_[pattern].size;
+    if (begin >= minBegin && (foundPattern == kNoPattern || begin > match.begin ||
+                              (begin == match.begin && pattern < foundPattern)))
+    {
+      match = {patterns_[pattern].tier, begin};
+      foundPattern = pattern;
+    }
+  }
+  return foundPattern != kNoPattern;
+}
+
+void ItemCatalog::Build()
+{
+  // キャッシュの照合用に、表の内容を決まった形に並べてハッシュする
+  std::string canonical;
+  recombobulatedRarities_.clear();
+  for (const auto &family : families_)
+  {
+    canonical += family.name;
+    canonical += '\n';
+    for (const auto &tier : family.tiers)
+    {
+      canonical += tier.name;
+      canonical += '\t';
+      AppendValue(canonical, tier.multiplier);
+      canonical += tier.recombobulatedRarity;
+      for (const auto &itemName : tier.itemNames)
+      {
+        canonical += '\t';
+        canonical += itemName;
+      }
+      canonical += '\n';
+      recombobulatedRarities_.push_back(tier.recombobulatedRarity);
+    }
+  }
+  hash_ = XxHash64(canonical.data(), canonical.size());
+
+  // 照合するのは「品目名 + 空白」（表の順に番号を振る）
+  std::vector<std::string> patternTexts;
+  patterns_.clear();
+  for (const auto &family : families_)
+  {
+    for (size_t tier = 0; tier < family.tiers.size(); tier++)
+    {
+      for (const auto &itemName : family.tiers[tier].itemNames)
+      {
+        patternTexts.push_back(itemName + ' ');
+        patterns_.push_back(
+            {static_cast<uint32_t>(family.firstTier + tier), static_cast<uint32_t>(patternTexts.back().size())});
+      }
+    }
+  }
+
+  // 品目名に現れる文字だけに種類を振り、遷移表の列を少なくする
+  byteClasses_.fill(0);
+  classCount_ = 1;
+  for (const auto &pattern : patternTexts)
+  {
+    for (char c : pattern)
+    {
+      uint8_t &byteClass = byteClasses_[static_cast<unsigned char>(c)];
+      if (byteClass == 0)
+      {
+        byteClass = static_cast<uint8_t>(classCount_++);
+      }
+    }
+  }
+
+  // トライ木（0 は根で、子が無いことも表す）
+  transitions_.assign(classCount_, 0);
+  outputs_.assign(1, kNoPattern);
+  for (uint32_t pattern = 0; pattern < patternTexts.size(); pattern++)
+  {
+    uint32_t state = 0;
+    for (char c : patternTexts[pattern])
+    {
+      uint32_t &next = transitions_[state * classCount_ + byteClasses_[static_cast<unsigned char>(c)]];
+      if (next == 0)
+      {
+        next = static_cast<uint32_t>(outputs_.size());
+        outputs_.push_back(kNoPattern);
+        transitions_.resize(transitions_.size() + classCount_, 0);
+      }
+      // resize で参照が無効になるので、添字で引き直す
+      state = transitions_[state * classCount_ + byteClasses_[static_cast<unsigned char>(c)]];
+    }
+    outputs_[state] = pattern;
+  }
+
+  // 幅優先に失敗遷移をたどり、子の無い遷移を失敗先の遷移で埋めて決定性オートマトンにする
+  std::vector<uint32_t> failure(outputs_.size(), 0);
+  std::deque<uint32_t> queue;
+  for (size_t byteClass = 0; byteClass < classCount_; byteClass++)
+  {
+    if (uint32_t child = transitions_[byteClass]; child != 0)
+    {
+      queue.push_back(child);
+    }
+  }
+  while (!queue.empty())
+  {
+    uint32_t state = queue.front();
+    queue.pop_front();
+    for (size_t byteClass = 0; byteClass < classCount_; byteClass++)
+    {
+      uint32_t &next = transitions_[state * classCount_ + byteClass];
+      uint32_t fallback = transitions_[failure[state] * classCount_ + byteClass];
+      if (next == 0)
+      {
+        next = fallback;
+        continue;
+      }
+      failure[next] = fallback;
+      // 失敗先で終わる品目名はこの状態で終わる品目名の接尾辞なので、より短い
+      if (outputs_[fallback] != kNoPattern)
+      {
+        outputs_[next] = outputs_[fallback];
+      }
+      queue.push_back(next);
+    }
+  }
+
+  // 照合では次の状態の行の位置をそのまま引けるよう、列の数を2のべき乗にして遷移先を行の位置に置き換える
+  classShift_ = 0;
+  while ((size_t{1} << classShift_) < classCount_)
+  {
+    classShift_++;
+  }
+  std::vector<uint32_t> rows(outputs_.size() << classShift_, 0);
+  for (size_t state = 0; state < outputs_.size(); state++)
+  {
+    for (size_t byteClass = 0; byteClass < classCount_; byteClass++)
+    {
+      rows[(state << classShift_) + byteClass] = transitions_[state * classCount_ + byteClass] << classShift_;
+    }
+  }
+  transitions_ = std::move(rows);
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Purchase.h"
+
+/**
+ * 品目の段階（Green Jerry Talisman など）
+ */
+struct ItemTier
+{
+  // 表示名（"Green"）
+  std::string name;
+  // 系統の最初の段階何個分か
+  long long multiplier = 1;
+  // Recombobulated の場合に品目名の直前に来るレアリティのカラーコード（0 なら Recombobulate できない）
+  char recombobulatedRarity = 0;
+  // ログに出る品目名（"Green Jerry Talisman" と "Green Jerry Artifact" など）
+  std::vector<std::string> itemNames;
+};
+
+/**
+ * アップグレードで段階が上がる品目の系統（Jerry Talisman など）
+ * 段階の番号は firstTier から連続していて、購入データの PurchaseKind になる
+ * 平均価格は最初の段階1個あたりで求める
+ */
+struct ItemFamily
+{
+  std::string name;
+  size_t firstTier = 0;
+  std::vector<ItemTier> tiers;
+
+  /**
+   * 最初の段階の品目名（"Green Jerry Talisman"）
+   */
+  const std::string &BaseItemName() const
+  {
+    return tiers.front().itemNames.front();
+  }
+
+  /**
+   * この系統の tier 番目（系統の中の番号）の段階の購入件数
+   */
+  long long Count(const PurchaseSummary &summary, size_t tier, bool recombobulated) const
+  {
+    return summary.Count(firstTier + tier, recombobulated);
+  }
+
+  long long PurchaseCount(const PurchaseSummary &summary) const;
+
+  long long TotalCost(const PurchaseSummary &summary) const;
+
+  long long RecombobulatedCount(const PurchaseSummary &summary) const;
+
+  /**
+   * 購入したすべての品目を最初の段階に換算した個数
+   */
+  long long BaseEquivalent(const PurchaseSummary &summary) const;
+
+  /**
+   * Recombobulator の価格を除いた合計コスト
+   */
+  long long CostWithoutRecombobulators(const PurchaseSummary &summary, long long recombobulatorPrice) const;
+
+  /**
+   * 最初の段階1個あたりの平均価格（購入が無ければ 0）
+   */
+  long long PricePerBase(const PurchaseSummary &summary, long long recombobulatorPrice) const;
+};
+
+/**
+ * 品目名の照合結果
+ */
+struct ItemMatch
+{
+  // 品目表の段階の番号
+  size_t tier;
+  // 品目名の先頭の位置
+  size_t begin;
+};
+
+/**
+ * 集計する品目の表と、ログの行から品目名を探す照合器
+ *
+ * 表は1行に1段階で、| で区切って
+ *   系統 | 段階 | 倍率 | Recombobulated のレアリティ | 品目名 [| 品目名...]
+ * と書く（# で始まる行と空行は読み飛ばす、既定の表は ItemCatalog.cpp の kJerryItemTable）
+ * 同じ系統の段階は書いた順に並び、倍率は系統の最初の段階何個分か、レアリティは - なら Recombobulate できない
+ *
+ * 品目名は1つの Aho-Corasick オートマトンにまとめ、遷移は文字の種類ごとの表に展開しておくので、
+ * 品目がいくつあっても1行を1回なめるだけで照合できる
+ */
+class ItemCatalog
+{
+public:
+  /**
+   * 既定の表（Jerry Talisman の4段階）
+   */
+  static const ItemCatalog &Jerry();
+
+  /**
+   * 表の内容を解析する（書式が正しくなければ、source と行番号を付けた理由を error に書いて false）
+   */
+  bool Parse(std::string_view text, const std::string &source, std::string &error);
+
+  /**
+   * 表のファイルを読み込む（開けない・書式が正しくなければ、理由を error に書いて false）
+   */
+  bool Load(const std::filesystem::path &path, std::string &error);
+
+  const std::vector<ItemFamily> &Families() const
+  {
+    return families_;
+  }
+
+  size_t TierCount() const
+  {
+    return recombobulatedRarities_.size();
+  }
+
+  /**
+   * tier 番目の段階の Recombobulated のレアリティ（0 なら Recombobulate できない）
+   */
+  char RecombobulatedRarity(size_t tier) const
+  {
+    return recombobulatedRarities_[tier];
+  }
+
+  /**
+   * 表の内容の XXH64（キャッシュに保存した段階の番号が同じ表のものかの判定用）
+   */
+  uint64_t Hash() const
+  {
+    return hash_;
+  }
+
+  /**
+   * text に含まれる「品目名 + 空白」のうち、minBegin 以降から始まる最も後ろのものを探す
+   * 同じ位置から始まる品目名が複数あれば、表の先に書いたものを選ぶ
+   */
+  bool FindLastItem(std::string_view text, size_t minBegin, ItemMatch &match) const;
+
+private:
+  void Build();
+
+  struct Pattern
+  {
+    uint32_t tier;
+    uint32_t size;
+  };
+
+  std::vector<ItemFamily> families_;
+  std::vector<char> recombobulatedRarities_;
+  uint64_t hash_ = 0;
+
+  // 品目名に現れる文字ごとの種類（0 は品目名に現れない文字）
+  std::array<uint8_t, 256> byteClasses_{};
+  size_t classCount_ = 1;
+  // 状態の行の位置（状態 << classShift_）+ 文字の種類 → 次の状態の行の位置
+  std::vector<uint32_t> transitions_;
+  unsigned classShift_ = 0;
+  // 状態で終わる品目名のうち最も短いもの（無ければ kNoPattern）
+  std::vector<uint32_t> outputs_;
+  std::vector<Pattern> patterns_;
+};
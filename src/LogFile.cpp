@@ -0,0 +1,265 @@
+#include "LogFile.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+std::optional<std::string> ReadGzFile(const std::string &filePath)
+{
+  gzFile file = gzopen(filePath.c_str(), "rb");
+  if (!file)
+  {
+    return std::nullopt;
+  }
+
+  std::string content;
+  char buffer[4096];
+  int readBytes;
+
+  while ((readBytes = gzread(file, buffer, sizeof(buffer))) > 0)
+  {
+    content.append(buffer, readBytes);
+  }
+
+  gzclose(file);
+  return content;
+}
+
+std::optional<std::string> ReadLogFile(const std::string &filePath)
+{
+  std::ifstream file(filePath);
+  if (!file)
+  {
+    return std::nullopt;
+  }
+
+  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  return content;
+}
+
+MappedFile::MappedFile(const std::string &filePath)
+{
+#ifdef _WIN32
+  HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                            NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    return;
+  }
+  file_ = file;
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file_, &fileSize))
+  {
+    return;
+  }
+  size_ = static_cast<size_t>(fileSize.QuadPart);
+
+  if (size_ > 0)
+  {
+    mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping_)
+    {
+      return;
+    }
+    data_ = static_cast<const char *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_)
+    {
+      return;
+    }
+  }
+#else
+  fd_ = open(filePath.c_str(), O_RDONLY);
+  if (fd_ < 0)
+  {
+    return;
+  }
+
+  struct stat st;
+  if (fstat(fd_, &st) != 0)
+  {
+    return;
+  }
+  size_ = static_cast<size_t>(st.st_size);
+
+  if (size_ > 0)
+  {
+    void *data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (data == MAP_FAILED)
+    {
+      return;
+    }
+    madvise(data, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char *>(data);
+  }
+#endif
+  open_ = true;
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+  if (data_)
+    UnmapViewOfFile(data_);
+  if (mapping_)
+    CloseHandle(mapping_);
+  if (file_)
+    CloseHandle(file_);
+#else
+  if (data_)
+    munmap(const_cast<char *>(data_), size_);
+  if (fd_ >= 0)
+    close(fd_);
+#endif
+}
+
+bool IsGzCompressed(const std::string &filePath)
+{
+  std::ifstream file(filePath, std::ios::binary);
+  if (!file)
+  {
+    return false;
+  }
+
+  char header[2];
+  file.read(header, 2);
+  return HasGzipMagic(std::string_view(header, static_cast<size_t>(file.gcount())));
+}
+
+bool HasGzipMagic(std::string_view data)
+{
+  // GZIPのマジックナンバー: {0x1F, 0x8B}
+  return data.size() >= 2 && static_cast<unsigned char>(data[0]) == 0x1F && static_cast<unsigned char>(data[1]) == 0x8B;
+}
+
+std::optional<std::string> ReadFile(const std::string &filePath)
+{
+  MappedFile file(filePath);
+  if (!file.IsOpen())
+  {
+    return std::nullopt;
+  }
+
+  std::string_view data = file.View();
+  if (!HasGzipMagic(data))
+  {
+    return std::string(data);
+  }
+
+  std::string content;
+  GzipReader reader(data);
+  char buffer[65536];
+  size_t readBytes;
+  while ((readBytes = reader.Read(buffer, sizeof(buffer))) > 0)
+  {
+    content.append(buffer, readBytes);
+  }
+  return content;
+}
+
+GzipReader::GzipReader(std::string_view data) : input_(data)
+{
+  initialized_ = inflateInit2(&stream_, 15 + 16) == Z_OK;
+  finished_ = failed_ = !initialized_;
+}
+
+GzipReader::~GzipReader()
+{
+  if (initialized_)
+  {
+    inflateEnd(&stream_);
+  }
+}
+
+void GzipReader::Reset(std::string_view data)
+{
+  input_ = data;
+  stream_.next_in = nullptr;
+  stream_.avail_in = 0;
+  memberEnded_ = heldMagic_ = false;
+  finished_ = failed_ = !initialized_ || inflateReset(&stream_) != Z_OK;
+}
+
+size_t GzipReader::Read(char *output, size_t size)
+{
+  size_t produced = 0;
+  while (produced == 0 && !finished_)
+  {
+    // avail_in は32ビットなので、大きなファイルは分けて渡す
+    if (stream_.avail_in == 0 && !input_.empty())
+    {
+      size_t chunk = std::min<size_t>(input_.size(), std::numeric_limits<unsigned>::max());
+      stream_.next_in = reinterpret_cast<unsigned char *>(const_cast<char *>(input_.data()));
+      stream_.avail_in = static_cast<unsigned>(chunk);
+      input_.remove_prefix(chunk);
+    }
+    if (stream_.avail_in == 0)
+    {
+      // 続きは Feed で渡される（渡されなければここで終わり）
+      break;
+    }
+
+    stream_.next_out = reinterpret_cast<unsigned char *>(output);
+    stream_.avail_out = static_cast<unsigned>(std::min<size_t>(size, std::numeric_limits<unsigned>::max()));
+
+    if (memberEnded_)
+    {
+      // 次のメンバーのマジックナンバーが続かなければ末尾のゴミとして無視する（gzread と同じ）
+      // 入力の区切りで2バイトが分かれたときは、1バイト目を取っておいて続きを待つ
+      bool held = heldMagic_;
+      bool magic = held ? stream_.next_in[0] == 0x8B
+                        : stream_.next_in[0] == 0x1F && (stream_.avail_in < 2 || stream_.next_in[1] == 0x8B);
+      if (!magic)
+      {
+        finished_ = true;
+        break;
+      }
+      if (!held && stream_.avail_in < 2)
+      {
+        heldMagic_ = true;
+        stream_.next_in++;
+        stream_.avail_in--;
+        continue;
+      }
+      inflateReset(&stream_);
+      memberEnded_ = false;
+      heldMagic_ = false;
+      if (held)
+      {
+        // 取っておいた1バイト目を先に渡す（ヘッダーの途中なので何も出力されない）
+        unsigned char magic = 0x1F;
+        unsigned char *nextIn = stream_.next_in;
+        unsigned availIn = stream_.avail_in;
+        stream_.next_in = &magic;
+        stream_.avail_in = 1;
+        inflate(&stream_, Z_NO_FLUSH);
+        stream_.next_in = nextIn;
+        stream_.avail_in = availIn;
+      }
+    }
+
+    unsigned availOut = stream_.avail_out;
+    int ret = inflate(&stream_, Z_NO_FLUSH);
+    produced = availOut - stream_.avail_out;
+
+    if (ret == Z_STREAM_END)
+    {
+      memberEnded_ = true;
+    }
+    else if (ret != Z_OK)
+    {
+      // 壊れたデータ以降は展開しない（途中で切れたデータは Complete で分かる）
+      finished_ = failed_ = true;
+    }
+  }
+  return produced;
+}
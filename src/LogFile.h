@@ -0,0 +1,134 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <zlib.h>
+
+/**
+ * .log.gzファイルを読み込む関数（開けなければ std::nullopt）
+ */
+std::optional<std::string> ReadGzFile(const std::string &filePath);
+
+/**
+ * .logファイルを読み込む関数（開けなければ std::nullopt）
+ */
+std::optional<std::string> ReadLogFile(const std::string &filePath);
+
+/**
+ * GZip圧縮かどうかをマジックナンバーで判定する関数
+ */
+bool IsGzCompressed(const std::string &filePath);
+
+/**
+ * ファイルを読み込む関数
+ * 一度だけ開いてメモリマップし、先頭のマジックナンバーを見て展開するかを決める（開けなければ std::nullopt）
+ */
+std::optional<std::string> ReadFile(const std::string &filePath);
+
+/**
+ * gzipのマジックナンバーで始まっているかを判定する関数
+ */
+bool HasGzipMagic(std::string_view data);
+
+/**
+ * ファイルを読み取り専用でメモリマップするクラス
+ * 書き込み中の latest.log も開けるよう、他のプロセスによる書き込みを許可する
+ */
+class MappedFile
+{
+public:
+  explicit MappedFile(const std::string &filePath);
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  bool IsOpen() const
+  {
+    return open_;
+  }
+
+  /**
+   * マップした内容（空のファイルなら空文字列）
+   */
+  std::string_view View() const
+  {
+    return data_ ? std::string_view(data_, size_) : std::string_view();
+  }
+
+private:
+#ifdef _WIN32
+  // windows.h をヘッダーに持ち込まないよう、HANDLE は void* で持つ（開けていなければ nullptr）
+  void *file_ = nullptr;
+  void *mapping_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+  bool open_ = false;
+};
+
+/**
+ * メモリ上の gzip データを gzread と同じように少しずつ展開するクラス
+ * 連結されたメンバーは続けて展開し、末尾のゴミや壊れたデータ以降は無視する
+ * ネットワークから届くデータのように入力が分かれている場合は、Feed で続きを渡せる
+ * Reset で別のデータを展開し直せるので、ファイルごとに展開器を確保し直さずに使い回せる
+ */
+class GzipReader
+{
+public:
+  explicit GzipReader(std::string_view data = {});
+  ~GzipReader();
+
+  GzipReader(const GzipReader &) = delete;
+  GzipReader &operator=(const GzipReader &) = delete;
+
+  /**
+   * 入力の続きを渡す（前に渡した入力を Read で読み終えてから呼ぶ。data は読み終えるまで有効なこと）
+   */
+  void Feed(std::string_view data)
+  {
+    input_ = data;
+  }
+
+  /**
+   * 展開の状態を捨てて、data を最初から展開し直す（zlib の作業領域は確保したまま使う）
+   */
+  void Reset(std::string_view data);
+
+  /**
+   * 最大 size バイトを展開して output に書き込み、書き込んだバイト数を返す
+   * 渡された入力を使い切ったか、展開が終わったら 0
+   */
+  size_t Read(char *output, size_t size);
+
+  /**
+   * 壊れたデータに出会って展開をやめたか
+   */
+  bool Failed() const
+  {
+    return failed_;
+  }
+
+  /**
+   * ここまでに渡した入力が、終端まで揃ったメンバーで終わっているか（途中で切れていれば false）
+   */
+  bool Complete() const
+  {
+    return !failed_ && memberEnded_;
+  }
+
+private:
+  // z_stream にまだ渡していない入力
+  std::string_view input_;
+  z_stream stream_{};
+  bool initialized_ = false;
+  bool memberEnded_ = false;
+  // 次のメンバーのマジックナンバーの1バイト目だけを読んで、続きを待っているか
+  bool heldMagic_ = false;
+  bool finished_ = false;
+  bool failed_ = false;
+};
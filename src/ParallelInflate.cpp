@@ -0,0 +1,1233 @@
+#include "ParallelInflate.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>
+
+namespace
+{
+
+// deflate の窓の大きさ（後方参照が届く最大の距離）
+constexpr size_t kWindowSize = 32768;
+
+// 1つの長さ・距離の組が書く最大の数（16 バイトずつ写すので、その分の余裕も足す）
+constexpr size_t kMaxMatch = 258 + 16;
+
+// 最後の区切りは止まる位置が無い
+constexpr uint64_t kNoStop = UINT64_MAX;
+
+constexpr uint16_t kLengthBase[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                      31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                      2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr uint16_t kDistanceBase[30] = {1,    2,    3,    4,    5,    7,    9,    13,    17,    25,
+                                        33,   49,   65,   97,   129,  193,  257,  385,   513,   769,
+                                        1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                        6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+// 符号長の符号長が並ぶ順番
+constexpr uint8_t kCodeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+uint64_t Read64(const uint8_t *p)
+{
+  uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint32_t Read32(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+/**
+ * gzip メンバーの見出しの大きさ（gzip の見出しとして読めなければ 0）
+ */
+size_t GzipHeaderSize(std::string_view data)
+{
+  const auto *p = reinterpret_cast<const uint8_t *>(data.data());
+  size_t size = data.size();
+  // zlib と同じく、圧縮方式が deflate 以外のものと、予約されたフラグが立っているものは読まない
+  if (size < 10 || p[0] != 0x1F || p[1] != 0x8B || p[2] != 8 || (p[3] & 0xE0) != 0)
+  {
+    return 0;
+  }
+  uint8_t flags = p[3];
+  size_t position = 10;
+  if (flags & 4)
+  {
+    if (position + 2 > size)
+    {
+      return 0;
+    }
+    position += 2 + (p[position] | (p[position + 1] << 8));
+  }
+  // ファイル名とコメントは 0 で終わる
+  for (int flag : {8, 16})
+  {
+    if (flags & flag)
+    {
+      while (position < size && p[position] != 0)
+      {
+        position++;
+      }
+      position++;
+    }
+  }
+  if (flags & 2)
+  {
+    position += 2;
+  }
+  return position <= size ? position : 0;
+}
+
+/**
+ * deflate のビット列を下位ビットから読むクラス
+ * 終わりより後ろは 0 として読み、読みすぎたかは Overrun で分かる
+ */
+class BitReader
+{
+public:
+  BitReader(const uint8_t *data, size_t size) : data_(data), size_(size)
+  {
+  }
+
+  void Seek(uint64_t bit)
+  {
+    position_ = bit / 8;
+    bits_ = 0;
+    count_ = 0;
+    Refill();
+    Skip(bit % 8);
+  }
+
+  /**
+   * 少なくとも 56 ビットを読める状態にする
+   */
+  void Refill()
+  {
+    if (position_ + 8 <= size_)
+    {
+      bits_ |= Read64(data_ + position_) << count_;
+      position_ += (63 - count_) >> 3;
+      count_ |= 56;
+      return;
+    }
+    while (count_ < 56)
+    {
+      bits_ |= static_cast<uint64_t>(position_ < size_ ? data_[position_] : 0) << count_;
+      position_++;
+      count_ += 8;
+    }
+  }
+
+  uint64_t Peek() const
+  {
+    return bits_;
+  }
+
+  void Skip(unsigned bits)
+  {
+    bits_ >>= bits;
+    count_ -= bits;
+  }
+
+  /**
+   * bits（32 以下）ビットを読む（足りるだけ Refill してあること）
+   */
+  uint32_t Get(unsigned bits)
+  {
+    uint32_t value = static_cast<uint32_t>(bits_ & ((uint64_t{1} << bits) - 1));
+    Skip(bits);
+    return value;
+  }
+
+  /**
+   * 足りなければ Refill してから読む
+   */
+  uint32_t Read(unsigned bits)
+  {
+    if (count_ < bits)
+    {
+      Refill();
+    }
+    return Get(bits);
+  }
+
+  void AlignToByte()
+  {
+    Skip(count_ % 8);
+  }
+
+  uint64_t Position() const
+  {
+    return position_ * 8 - count_;
+  }
+
+  bool Overrun() const
+  {
+    return position_ > size_ && Position() > size_ * 8;
+  }
+
+  const uint8_t *Data() const
+  {
+    return data_;
+  }
+
+  size_t Size() const
+  {
+    return size_;
+  }
+
+private:
+  const uint8_t *data_;
+  size_t size_;
+  // 次に読むバイトの位置
+  size_t position_ = 0;
+  // 読んだがまだ使っていないビット（下位 count_ ビット）
+  uint64_t bits_ = 0;
+  unsigned count_ = 0;
+};
+
+// 復号表の要素の下位8ビット（下位4ビットは符号長で、0 は使われていない符号か、使ってはいけない記号）
+constexpr uint32_t kSubtable = 0x10;
+constexpr uint32_t kLiteral = 0x20;
+constexpr uint32_t kEndOfBlock = 0x40;
+// 使ってはいけない記号（固定ハフマン符号の 286, 287 と距離の 30, 31）
+constexpr uint32_t kInvalidSymbol = UINT32_MAX;
+
+/**
+ * 記号ごとの、復号表の要素の符号長より上の部分
+ * 文字は 文字 << 16 | kLiteral、長さと距離は 基本の値 << 16 | 追加のビット数 << 8
+ */
+constexpr std::array<uint32_t, 288> kLiteralPayloads = [] {
+  std::array<uint32_t, 288> payloads{};
+  for (uint32_t symbol = 0; symbol < 256; symbol++)
+  {
+    payloads[symbol] = symbol << 16 | kLiteral;
+  }
+  payloads[256] = kEndOfBlock;
+  for (uint32_t code = 0; code < 29; code++)
+  {
+    payloads[257 + code] =
+        static_cast<uint32_t>(kLengthBase[code]) << 16 | static_cast<uint32_t>(kLengthExtra[code]) << 8;
+  }
+  payloads[286] = kInvalidSymbol;
+  payloads[287] = kInvalidSymbol;
+  return payloads;
+}();
+
+constexpr std::array<uint32_t, 32> kDistancePayloads = [] {
+  std::array<uint32_t, 32> payloads{};
+  for (uint32_t code = 0; code < 30; code++)
+  {
+    payloads[code] =
+        static_cast<uint32_t>(kDistanceBase[code]) << 16 | static_cast<uint32_t>(kDistanceExtra[code]) << 8;
+  }
+  payloads[30] = kInvalidSymbol;
+  payloads[31] = kInvalidSymbol;
+  return payloads;
+}();
+
+// 符号長の符号は 記号 << 16
+constexpr std::array<uint32_t, 19> kCodeLengthPayloads = [] {
+  std::array<uint32_t, 19> payloads{};
+  for (uint32_t symbol = 0; symbol < 19; symbol++)
+  {
+    payloads[symbol] = symbol << 16;
+  }
+  return payloads;
+}();
+
+/**
+ * 3ビットずつの符号長4つが使う符号の空間（最大の長さ 7 の符号1つを 1 とし、過不足が無ければ合計が 128 になる）
+ */
+constexpr std::array<uint8_t, 4096> kCodeSpace = [] {
+  std::array<uint8_t, 4096> space{};
+  for (unsigned bits = 0; bits < 4096; bits++)
+  {
+    for (unsigned shift = 0; shift < 12; shift += 3)
+    {
+      unsigned length = (bits >> shift) & 7;
+      space[bits] = static_cast<uint8_t>(space[bits] + (length > 0 ? 128u >> length : 0));
+    }
+  }
+  return space;
+}();
+
+/**
+ * 正準ハフマン符号の復号表（先頭 PrimaryBits ビットで引き、それより長い符号は続きのビットで副表を引く）
+ * 要素は 記号ごとの値 | 符号長 で、副表への参照は 副表の位置 << 8 | kSubtable | 副表のビット数
+ */
+template <unsigned PrimaryBits, size_t Capacity> class HuffmanTable
+{
+public:
+  /**
+   * 各記号の符号長から表を作る（zlib と同じく、符号が多すぎるものと、1ビットの符号1つ以外で足りないものは false）
+   * 1つも符号が無ければ空の表になり、引くと失敗する
+   */
+  bool Build(const uint8_t *lengths, unsigned symbolCount, bool allowIncomplete, const uint32_t *payloads)
+  {
+    std::array<unsigned, 16> counts{};
+    for (unsigned symbol = 0; symbol < symbolCount; symbol++)
+    {
+      counts[lengths[symbol]]++;
+    }
+    counts[0] = 0;
+    unsigned maxLength = 15;
+    while (maxLength > 0 && counts[maxLength] == 0)
+    {
+      maxLength--;
+    }
+    if (maxLength == 0)
+    {
+      std::fill(entries_.begin(), entries_.begin() + (size_t{1} << PrimaryBits), 0);
+      return true;
+    }
+
+    // ブロックの先頭を探すときはここでほとんどが外れるので、表を埋めるのは確かめてからにする
+    int left = 1;
+    for (unsigned length = 1; length <= 15; length++)
+    {
+      left = (left << 1) - static_cast<int>(counts[length]);
+      if (left < 0)
+      {
+        return false;
+      }
+    }
+    if (left > 0 && (!allowIncomplete || maxLength != 1))
+    {
+      return false;
+    }
+
+    std::fill(entries_.begin(), entries_.begin() + (size_t{1} << PrimaryBits), 0);
+    std::array<unsigned, 16> nextCode{};
+    for (unsigned length = 1, code = 0; length <= 15; length++)
+    {
+      code = (code + counts[length - 1]) << 1;
+      nextCode[length] = code;
+    }
+
+    // 符号は上位ビットから並ぶが、deflate のビット列は下位ビットから読むので、逆順にしたもので引く
+    std::array<uint16_t, 320> reversed;
+    std::array<uint8_t, size_t{1} << PrimaryBits> subtableBits{};
+    for (unsigned symbol = 0; symbol < symbolCount; symbol++)
+    {
+      unsigned length = lengths[symbol];
+      if (length == 0)
+      {
+        continue;
+      }
+      unsigned code = nextCode[length]++;
+      unsigned reverse = 0;
+      for (unsigned i = 0; i < length; i++)
+      {
+        reverse |= ((code >> i) & 1) << (length - 1 - i);
+      }
+      reversed[symbol] = static_cast<uint16_t>(reverse);
+      if (length > PrimaryBits)
+      {
+        uint8_t &bits = subtableBits[reverse & kPrimaryMask];
+        bits = std::max<uint8_t>(bits, static_cast<uint8_t>(length - PrimaryBits));
+      }
+    }
+
+    size_t used = size_t{1} << PrimaryBits;
+    for (size_t prefix = 0; prefix < subtableBits.size(); prefix++)
+    {
+      if (subtableBits[prefix] == 0)
+      {
+        continue;
+      }
+      size_t subtableSize = size_t{1} << subtableBits[prefix];
+      if (used + subtableSize > Capacity)
+      {
+        return false;
+      }
+      entries_[prefix] = static_cast<uint32_t>(used << 8) | kSubtable | subtableBits[prefix];
+      std::fill(entries_.begin() + used, entries_.begin() + used + subtableSize, 0);
+      used += subtableSize;
+    }
+
+    for (unsigned symbol = 0; symbol < symbolCount; symbol++)
+    {
+      unsigned length = lengths[symbol];
+      if (length == 0)
+      {
+        continue;
+      }
+      uint32_t entry = payloads[symbol] == kInvalidSymbol ? 0 : payloads[symbol] | length;
+      unsigned reverse = reversed[symbol];
+      if (length <= PrimaryBits)
+      {
+        for (size_t i = reverse; i < (size_t{1} << PrimaryBits); i += size_t{1} << length)
+        {
+          entries_[i] = entry;
+        }
+      }
+      else
+      {
+        uint32_t link = entries_[reverse & kPrimaryMask];
+        size_t base = link >> 8;
+        size_t step = size_t{1} << (length - PrimaryBits);
+        for (size_t i = reverse >> PrimaryBits; i < (size_t{1} << (link & 15)); i += step)
+        {
+          entries_[base + i] = entry;
+        }
+      }
+    }
+    return true;
+  }
+
+  uint32_t Lookup(uint64_t bits) const
+  {
+    uint32_t entry = entries_[bits & kPrimaryMask];
+    if (entry & kSubtable)
+    {
+      entry = entries_[(entry >> 8) + ((bits >> PrimaryBits) & ((1u << (entry & 15)) - 1))];
+    }
+    return entry;
+  }
+
+private:
+  static constexpr uint64_t kPrimaryMask = (uint64_t{1} << PrimaryBits) - 1;
+
+  std::array<uint32_t, Capacity> entries_;
+};
+
+using LiteralTable = HuffmanTable<10, 4096>;
+using DistanceTable = HuffmanTable<8, 2048>;
+using CodeLengthTable = HuffmanTable<7, 128>;
+
+/**
+ * 固定ハフマンブロックの表
+ */
+struct FixedTables
+{
+  LiteralTable literals;
+  DistanceTable distances;
+
+  FixedTables()
+  {
+    std::array<uint8_t, 288> lengths;
+    std::fill(lengths.begin(), lengths.begin() + 144, 8);
+    std::fill(lengths.begin() + 144, lengths.begin() + 256, 9);
+    std::fill(lengths.begin() + 256, lengths.begin() + 280, 7);
+    std::fill(lengths.begin() + 280, lengths.end(), 8);
+    literals.Build(lengths.data(), 288, false, kLiteralPayloads.data());
+    std::fill(lengths.begin(), lengths.begin() + 32, 5);
+    distances.Build(lengths.data(), 32, false, kDistancePayloads.data());
+  }
+
+  static const FixedTables &Get()
+  {
+    static const FixedTables tables;
+    return tables;
+  }
+};
+
+/**
+ * 区切り1つを展開した結果（バッファは次に同じ区切りの枠を使うときに使い回す）
+ */
+struct Chunk
+{
+  // 展開を始めた位置と止まった位置（ビット単位、止まった位置は次のブロックの先頭か、最後のブロックの終わり）
+  uint64_t begin = 0;
+  uint64_t end = 0;
+  // 最後のブロックまで展開したか
+  bool final = false;
+  // 壊れたデータか途中で切れたデータに出会い、その手前までしか展開できなかったか
+  bool failed = false;
+  // 直前の 32KB が分からないまま展開した前半
+  // 先頭の kWindowSize 個は窓を表す印で、256 以上の値は窓の (値 - 256) バイト目
+  std::vector<uint16_t> marked;
+  size_t markedSize = 0;
+  // 印を含まなくなってからの後半（先頭の bytesBegin バイトは展開を始める前から分かっていた窓）
+  std::vector<uint8_t> bytes;
+  size_t bytesSize = 0;
+  size_t bytesBegin = 0;
+  // 後半の CRC-32
+  uint32_t bytesCrc = 0;
+  // 前半の値から埋めたバイトを引く表（256 未満はそのまま、256 からは前の区切りまでの最後の 32KB で、
+  // データの先頭に近ければ足りない分は 0）
+  std::vector<uint8_t> window;
+  // 前半の印を埋めたものと、その CRC-32
+  std::vector<uint8_t> resolved;
+  uint32_t resolvedCrc = 0;
+
+  uint8_t Resolve(uint16_t symbol) const
+  {
+    return window[symbol];
+  }
+
+  std::string_view Resolved() const
+  {
+    return {reinterpret_cast<const char *>(resolved.data()), resolved.size()};
+  }
+
+  std::string_view Bytes() const
+  {
+    return {reinterpret_cast<const char *>(bytes.data()) + bytesBegin, bytesSize - bytesBegin};
+  }
+};
+
+/**
+ * 展開先の後ろに、少なくとも extra 個を書ける余裕を作る
+ */
+template <typename T> void Reserve(std::vector<T> &buffer, size_t size, size_t extra)
+{
+  if (size + extra > buffer.size())
+  {
+    buffer.resize(std::max(buffer.size() * 2, size + extra));
+  }
+}
+
+/**
+ * deflate のブロックを展開するクラス
+ */
+class DeflateDecoder
+{
+public:
+  DeflateDecoder(const uint8_t *data, size_t size) : reader_(data, size)
+  {
+  }
+
+  /**
+   * 直前の window（最大 32KB、データの先頭なら空）が分かっている位置 begin から展開し、
+   * stop 以降で始まるブロックの手前か、最後のブロックの終わりで止まる
+   */
+  void Decode(uint64_t begin, uint64_t stop, const std::vector<uint8_t> &window, Chunk &chunk)
+  {
+    chunk.markedSize = 0;
+    chunk.bytesSize = window.size();
+    chunk.bytesBegin = window.size();
+    Reserve(chunk.bytes, 0, window.size() + kMaxMatch);
+    std::copy(window.begin(), window.end(), chunk.bytes.begin());
+    Run(begin, stop, false, chunk);
+  }
+
+  /**
+   * begin から stop の手前までで最初に見つかった、展開できる動的ハフマンブロックの先頭から展開する
+   * 直前の 32KB は分からないので、それを参照した文字は印として残す（見つからなければ failed）
+   */
+  void Speculate(uint64_t begin, uint64_t stop, Chunk &chunk)
+  {
+    // 後ろの 16 バイトより手前で探す（それより後ろで始まり、最後ではないブロックは展開し直せば済む）
+    uint64_t limit = std::min<uint64_t>(stop, reader_.Size() >= 16 ? (reader_.Size() - 16) * 8 : 0);
+    for (uint64_t base = begin; base < limit; base += 32)
+    {
+      // 最後のブロックではない動的ハフマンブロックで、記号の数が範囲に収まっている位置を 32 ビット分まとめて求める
+      uint64_t word = Read64(reader_.Data() + base / 8) >> (base % 8);
+      uint64_t candidates = ~word & ~(word >> 1) & (word >> 2) & ~(word >> 4 & word >> 5 & word >> 6 & word >> 7) &
+                            ~(word >> 9 & word >> 10 & word >> 11 & word >> 12) & 0xFFFFFFFF;
+      if (limit - base < 32)
+      {
+        candidates &= (uint64_t{1} << (limit - base)) - 1;
+      }
+      for (; candidates != 0; candidates &= candidates - 1)
+      {
+        uint64_t bit = base + std::countr_zero(candidates);
+        // 符号長の符号がちょうど過不足の無い符号になっているか（表を作る前に、読み込んだビットのまま確かめる）
+        unsigned codeLengthCount = static_cast<unsigned>((word >> (bit - base + 13)) & 15) + 4;
+        uint64_t lengthBits = Read64(reader_.Data() + (bit + 17) / 8) >> ((bit + 17) % 8);
+        lengthBits &= (uint64_t{1} << (codeLengthCount * 3)) - 1;
+        unsigned space = 0;
+        for (unsigned shift = 0; shift < 60; shift += 12)
+        {
+          space += kCodeSpace[(lengthBits >> shift) & 4095];
+        }
+        if (space != 128)
+        {
+          continue;
+        }
+        reader_.Seek(bit);
+        reader_.Skip(3);
+        if (!ReadDynamicHeader())
+        {
+          continue;
+        }
+
+        chunk.markedSize = kWindowSize;
+        chunk.bytesSize = 0;
+        chunk.bytesBegin = 0;
+        Reserve(chunk.marked, 0, kWindowSize + kMaxMatch);
+        for (size_t i = 0; i < kWindowSize; i++)
+        {
+          chunk.marked[i] = static_cast<uint16_t>(256 + i);
+        }
+        Run(bit, stop, true, chunk);
+        if (!chunk.failed)
+        {
+          return;
+        }
+      }
+    }
+    chunk.begin = kNoStop;
+    chunk.failed = true;
+  }
+
+private:
+  void Run(uint64_t begin, uint64_t stop, bool marking, Chunk &chunk)
+  {
+    chunk.begin = begin;
+    chunk.final = false;
+    chunk.failed = false;
+    reader_.Seek(begin);
+    while (true)
+    {
+      // 直前の 32KB に印が無くなれば、それより後ろは印を参照しないので、バイトのまま展開する
+      if (marking && chunk.markedSize >= kWindowSize * 2 &&
+          !HasMarkers(chunk.marked.data() + chunk.markedSize - kWindowSize))
+      {
+        Reserve(chunk.bytes, 0, kWindowSize + kMaxMatch);
+        std::copy(chunk.marked.begin() + (chunk.markedSize - kWindowSize), chunk.marked.begin() + chunk.markedSize,
+                  chunk.bytes.begin());
+        chunk.markedSize -= kWindowSize;
+        chunk.bytesSize = kWindowSize;
+        chunk.bytesBegin = 0;
+        marking = false;
+      }
+
+      reader_.Refill();
+      bool last = reader_.Get(1) != 0;
+      unsigned type = reader_.Get(2);
+      bool ok = false;
+      if (type == 0)
+      {
+        ok = marking ? CopyStored(chunk.marked, chunk.markedSize) : CopyStored(chunk.bytes, chunk.bytesSize);
+      }
+      else if (type == 1 || (type == 2 && ReadDynamicHeader() && !reader_.Overrun()))
+      {
+        const LiteralTable &literals = type == 1 ? FixedTables::Get().literals : literals_;
+        const DistanceTable &distances = type == 1 ? FixedTables::Get().distances : distances_;
+        ok = marking ? DecodeBlock(chunk.marked, chunk.markedSize, literals, distances)
+                     : DecodeBlock(chunk.bytes, chunk.bytesSize, literals, distances);
+      }
+      if (!ok || reader_.Overrun())
+      {
+        chunk.failed = true;
+        chunk.end = reader_.Position();
+        return;
+      }
+
+      chunk.end = reader_.Position();
+      if (last)
+      {
+        chunk.final = true;
+        return;
+      }
+      if (chunk.end >= stop)
+      {
+        return;
+      }
+    }
+  }
+
+  static bool HasMarkers(const uint16_t *symbols)
+  {
+    uint16_t any = 0;
+    for (size_t i = 0; i < kWindowSize; i++)
+    {
+      any |= symbols[i];
+    }
+    return any >= 256;
+  }
+
+  /**
+   * 動的ハフマンブロックの見出し（ブロックの種類の後ろ）を読んで表を作る（正しい見出しでなければ false）
+   */
+  bool ReadDynamicHeader()
+  {
+    unsigned literalCount = reader_.Read(5) + 257;
+    unsigned distanceCount = reader_.Read(5) + 1;
+    unsigned codeLengthCount = reader_.Read(4) + 4;
+    if (literalCount > 286 || distanceCount > 30)
+    {
+      return false;
+    }
+
+    std::array<uint8_t, 19> codeLengthLengths{};
+    for (unsigned i = 0; i < codeLengthCount; i++)
+    {
+      codeLengthLengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(reader_.Read(3));
+    }
+    if (!codeLengths_.Build(codeLengthLengths.data(), 19, false, kCodeLengthPayloads.data()))
+    {
+      return false;
+    }
+
+    std::array<uint8_t, 286 + 30> lengths{};
+    unsigned total = literalCount + distanceCount;
+    for (unsigned count = 0; count < total;)
+    {
+      reader_.Refill();
+      uint32_t entry = codeLengths_.Lookup(reader_.Peek());
+      if ((entry & 15) == 0)
+      {
+        return false;
+      }
+      reader_.Skip(entry & 15);
+      unsigned symbol = entry >> 16;
+      if (symbol < 16)
+      {
+        lengths[count++] = static_cast<uint8_t>(symbol);
+        continue;
+      }
+      uint8_t value = 0;
+      unsigned repeat;
+      if (symbol == 16)
+      {
+        if (count == 0)
+        {
+          return false;
+        }
+        value = lengths[count - 1];
+        repeat = 3 + reader_.Get(2);
+      }
+      else if (symbol == 17)
+      {
+        repeat = 3 + reader_.Get(3);
+      }
+      else
+      {
+        repeat = 11 + reader_.Get(7);
+      }
+      if (count + repeat > total)
+      {
+        return false;
+      }
+      std::fill(lengths.begin() + count, lengths.begin() + count + repeat, value);
+      count += repeat;
+    }
+    // ブロックの終わりを表す記号が無ければ、ブロックは終わらない
+    if (reader_.Overrun() || lengths[256] == 0)
+    {
+      return false;
+    }
+    return literals_.Build(lengths.data(), literalCount, true, kLiteralPayloads.data()) &&
+           distances_.Build(lengths.data() + literalCount, distanceCount, true, kDistancePayloads.data());
+  }
+
+  /**
+   * 無圧縮ブロックを写す（途中で切れていれば、ある分だけ写して false）
+   */
+  template <typename T> bool CopyStored(std::vector<T> &output, size_t &size)
+  {
+    reader_.AlignToByte();
+    uint32_t length = reader_.Read(16);
+    uint32_t inverse = reader_.Read(16);
+    if (reader_.Overrun() || length != (~inverse & 0xFFFF))
+    {
+      return false;
+    }
+    uint64_t byte = reader_.Position() / 8;
+    size_t available = byte >= reader_.Size() ? 0 : std::min<size_t>(length, reader_.Size() - byte);
+    Reserve(output, size, available + kMaxMatch);
+    std::copy(reader_.Data() + byte, reader_.Data() + byte + available, output.begin() + size);
+    size += available;
+    if (available < length)
+    {
+      return false;
+    }
+    reader_.Seek((byte + length) * 8);
+    return true;
+  }
+
+  /**
+   * ハフマン符号のブロックを、ブロックの終わりを表す記号まで展開する（壊れていれば、その手前まで展開して false）
+   */
+  template <typename T>
+  bool DecodeBlock(std::vector<T> &output, size_t &outputSize, const LiteralTable &literals,
+                   const DistanceTable &distances)
+  {
+    size_t size = outputSize;
+    T *out = output.data();
+    size_t limit = output.size() - kMaxMatch;
+    bool ok = false;
+    while (true)
+    {
+      if (size > limit)
+      {
+        Reserve(output, size, kMaxMatch * 64);
+        out = output.data();
+        limit = output.size() - kMaxMatch;
+      }
+
+      // 1つの記号とその長さ・距離は、合わせても 48 ビットに収まる
+      reader_.Refill();
+      uint64_t bits = reader_.Peek();
+      uint32_t entry = literals.Lookup(bits);
+      unsigned codeLength = entry & 15;
+      if (entry & kLiteral)
+      {
+        reader_.Skip(codeLength);
+        if (reader_.Overrun())
+        {
+          break;
+        }
+        out[size++] = static_cast<T>(entry >> 16);
+        // 残りのビットでもう1つの符号を引けるので、それも文字なら Refill せずに続けて書く
+        entry = literals.Lookup(reader_.Peek());
+        if (entry & kLiteral)
+        {
+          reader_.Skip(entry & 15);
+          if (reader_.Overrun())
+          {
+            break;
+          }
+          out[size++] = static_cast<T>(entry >> 16);
+        }
+        continue;
+      }
+      if (codeLength == 0)
+      {
+        break;
+      }
+      if (entry & kEndOfBlock)
+      {
+        reader_.Skip(codeLength);
+        ok = !reader_.Overrun();
+        break;
+      }
+      unsigned extra = (entry >> 8) & 15;
+      size_t length = (entry >> 16) + ((bits >> codeLength) & ((1u << extra) - 1));
+      reader_.Skip(codeLength + extra);
+
+      bits = reader_.Peek();
+      entry = distances.Lookup(bits);
+      codeLength = entry & 15;
+      if (codeLength == 0)
+      {
+        break;
+      }
+      extra = (entry >> 8) & 15;
+      size_t distance = (entry >> 16) + ((bits >> codeLength) & ((1u << extra) - 1));
+      reader_.Skip(codeLength + extra);
+      if (reader_.Overrun() || distance > size)
+      {
+        break;
+      }
+
+      // 16 か 8 バイトずつ写す（後ろにはみ出した分は次の記号で上書きされる）
+      T *destination = out + size;
+      const T *source = destination - distance;
+      T *end = destination + length;
+      if (distance * sizeof(T) >= 16)
+      {
+        do
+        {
+          std::memcpy(destination, source, 16);
+          destination += 16 / sizeof(T);
+          source += 16 / sizeof(T);
+        } while (destination < end);
+      }
+      else if (distance * sizeof(T) >= 8)
+      {
+        do
+        {
+          std::memcpy(destination, source, 8);
+          destination += 8 / sizeof(T);
+          source += 8 / sizeof(T);
+        } while (destination < end);
+      }
+      else if (distance == 1)
+      {
+        std::fill_n(destination, length, *source);
+      }
+      else
+      {
+        for (size_t i = 0; i < length; i++)
+        {
+          destination[i] = source[i];
+        }
+      }
+      size += length;
+    }
+    outputSize = size;
+    return ok;
+  }
+
+  BitReader reader_;
+  LiteralTable literals_;
+  DistanceTable distances_;
+  CodeLengthTable codeLengths_;
+};
+
+} // namespace
+
+/**
+ * 補助スレッドのプール（仕事は呼び出し元のスレッドも手伝う）
+ */
+class ParallelInflater::Pool
+{
+public:
+  /**
+   * task(0) から task(count - 1) までをまとめた仕事
+   */
+  struct Job
+  {
+    std::function<void(size_t)> task;
+    size_t count = 0;
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t done = 0;
+    std::exception_ptr error;
+  };
+
+  explicit Pool(size_t helpers)
+  {
+    for (size_t i = 0; i < helpers; i++)
+    {
+      threads_.emplace_back([this] { Loop(); });
+    }
+  }
+
+  ~Pool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    available_.notify_all();
+    for (std::thread &thread : threads_)
+    {
+      thread.join();
+    }
+  }
+
+  /**
+   * 仕事を最大 helpers 個の補助スレッドで始める（終わりは Wait で待つ）
+   */
+  std::shared_ptr<Job> Start(size_t count, size_t helpers, std::function<void(size_t)> task)
+  {
+    auto job = std::make_shared<Job>();
+    job->task = std::move(task);
+    job->count = count;
+    helpers = std::min({helpers, threads_.size(), count});
+    if (helpers > 0)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tickets_.insert(tickets_.end(), helpers, job);
+      }
+      available_.notify_all();
+    }
+    return job;
+  }
+
+  /**
+   * 残りを手伝いながら仕事が全部終わるのを待ち、どれかが例外を投げていれば投げ直す
+   */
+  void Wait(Job &job)
+  {
+    Finish(job);
+    if (job.error)
+    {
+      std::rethrow_exception(job.error);
+    }
+  }
+
+  /**
+   * 例外を投げ直さずに待つ（仕事が参照しているものを片付ける前に呼ぶ）
+   */
+  void Finish(Job &job)
+  {
+    Work(job);
+    std::unique_lock<std::mutex> lock(job.mutex);
+    job.finished.wait(lock, [&] { return job.done == job.count; });
+  }
+
+private:
+  static void Work(Job &job)
+  {
+    size_t index;
+    while ((index = job.next.fetch_add(1)) < job.count)
+    {
+      std::exception_ptr error;
+      try
+      {
+        job.task(index);
+      }
+      catch (...)
+      {
+        error = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lock(job.mutex);
+      if (error && !job.error)
+      {
+        job.error = error;
+      }
+      if (++job.done == job.count)
+      {
+        job.finished.notify_all();
+      }
+    }
+  }
+
+  void Loop()
+  {
+    while (true)
+    {
+      std::shared_ptr<Job> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        available_.wait(lock, [&] { return stopping_ || !tickets_.empty(); });
+        if (tickets_.empty())
+        {
+          return;
+        }
+        job = std::move(tickets_.front());
+        tickets_.pop_front();
+      }
+      // 他のスレッドが全部取り終えた仕事なら、何もせずに戻る
+      Work(*job);
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable available_;
+  // 補助スレッド1つが手伝う分の仕事
+  std::deque<std::shared_ptr<Job>> tickets_;
+  bool stopping_ = false;
+};
+
+ParallelInflater::ParallelInflater(size_t threads, size_t chunkSize)
+    : threads_(std::max<size_t>(threads, 1)), chunkSize_(std::max<size_t>(chunkSize, 1)),
+      pool_(std::make_unique<Pool>(threads_ - 1))
+{
+}
+
+ParallelInflater::~ParallelInflater() = default;
+
+ParallelInflater::FileScope::FileScope(const ParallelInflater &inflater) : inflater_(inflater)
+{
+  inflater_.files_++;
+}
+
+ParallelInflater::FileScope::~FileScope()
+{
+  inflater_.files_--;
+}
+
+ParallelInflateResult ParallelInflater::Inflate(std::string_view data,
+                                                const std::function<void(std::string_view)> &output) const
+{
+  ParallelInflateResult result;
+  size_t headerSize = GzipHeaderSize(data);
+  if (headerSize == 0)
+  {
+    return result;
+  }
+  const auto *deflate = reinterpret_cast<const uint8_t *>(data.data()) + headerSize;
+  size_t deflateSize = data.size() - headerSize;
+  size_t chunkCount = std::max<size_t>((deflateSize + chunkSize_ - 1) / chunkSize_, 1);
+  auto chunkBegin = [&](size_t index) { return static_cast<uint64_t>(index) * chunkSize_ * 8; };
+  auto chunkStop = [&](size_t index) { return index + 1 < chunkCount ? chunkBegin(index + 1) : kNoStop; };
+
+  /**
+   * まとめて展開する区切り（2つを交互に使い、片方を渡している間にもう片方を展開する）
+   */
+  struct Batch
+  {
+    std::vector<Chunk> chunks;
+    size_t first = 0;
+    size_t count = 0;
+    // 使ってよいスレッドの数
+    size_t width = 1;
+    std::shared_ptr<Pool::Job> job;
+  };
+  std::array<Batch, 2> batches;
+
+  // 次に展開する位置と、その直前の 32KB
+  uint64_t position = 0;
+  std::vector<uint8_t> window;
+  size_t nextChunk = 0;
+  uint32_t crc = crc32(0, nullptr, 0);
+  uint64_t totalSize = 0;
+  bool finished = false;
+  bool failed = false;
+
+  auto crcOf = [](std::string_view bytes) {
+    return static_cast<uint32_t>(
+        crc32_z(0, reinterpret_cast<const Bytef *>(bytes.data()), static_cast<z_size_t>(bytes.size())));
+  };
+
+  // 先頭の区切りは続きの位置から窓を使って、残りは区切りの後ろで見つけたブロックから、手の空いたスレッドで展開する
+  auto start = [&](Batch &batch) {
+    // 同時に展開しているファイルの数でスレッドを分け合う
+    batch.width = std::max<size_t>(threads_ / std::max<size_t>(files_.load(), 1), 1);
+    batch.first = nextChunk;
+    batch.count = std::min(batch.width, chunkCount - nextChunk);
+    nextChunk += batch.count;
+    if (batch.chunks.size() < batch.count)
+    {
+      batch.chunks.resize(batch.count);
+    }
+    batch.job = pool_->Start(batch.count, batch.width - 1, [&, begin = position](size_t i) {
+      Chunk &chunk = batch.chunks[i];
+      size_t index = batch.first + i;
+      DeflateDecoder decoder(deflate, deflateSize);
+      if (i == 0)
+      {
+        decoder.Decode(begin, chunkStop(index), window, chunk);
+      }
+      else
+      {
+        decoder.Speculate(chunkBegin(index), chunkStop(index), chunk);
+      }
+      chunk.bytesCrc = crcOf(chunk.Bytes());
+    });
+  };
+
+  // 区切りを前から順につなぎ、見つけた先頭が前の区切りの止まった位置と違えば展開し直し、印を埋める
+  auto link = [&](Batch &batch) {
+    pool_->Wait(*batch.job);
+    batch.job.reset();
+    for (size_t i = 0; i < batch.count; i++)
+    {
+      Chunk &chunk = batch.chunks[i];
+      size_t index = batch.first + i;
+      if (i > 0 && (chunk.failed || chunk.begin != position))
+      {
+        DeflateDecoder decoder(deflate, deflateSize);
+        decoder.Decode(position, chunkStop(index), window, chunk);
+        chunk.bytesCrc = crcOf(chunk.Bytes());
+      }
+
+      // 印は後でまとめて埋めるので、ここでは次の区切りの窓になる最後の 32KB だけを埋める
+      std::string_view bytes = chunk.Bytes();
+      if (chunk.markedSize > kWindowSize)
+      {
+        chunk.window.resize(256 + kWindowSize);
+        for (size_t j = 0; j < 256; j++)
+        {
+          chunk.window[j] = static_cast<uint8_t>(j);
+        }
+        std::fill(chunk.window.begin() + 256, chunk.window.end() - window.size(), 0);
+        std::copy(window.begin(), window.end(), chunk.window.end() - window.size());
+      }
+      if (bytes.size() >= kWindowSize)
+      {
+        window.assign(bytes.end() - kWindowSize, bytes.end());
+      }
+      else
+      {
+        size_t markedTail = std::min(chunk.markedSize - std::min(chunk.markedSize, kWindowSize),
+                                     kWindowSize - bytes.size());
+        for (size_t j = chunk.markedSize - markedTail; j < chunk.markedSize; j++)
+        {
+          window.push_back(chunk.Resolve(chunk.marked[j]));
+        }
+        window.insert(window.end(), bytes.begin(), bytes.end());
+        if (window.size() > kWindowSize)
+        {
+          window.erase(window.begin(), window.end() - kWindowSize);
+        }
+      }
+
+      position = chunk.end;
+      if (chunk.failed || chunk.final)
+      {
+        finished = true;
+        failed = chunk.failed;
+        batch.count = i + 1;
+        break;
+      }
+    }
+
+    // 印を埋めて CRC-32 を求めるのは、区切りごとに手の空いたスレッドで行う
+    auto resolve = pool_->Start(batch.count, batch.width - 1, [&](size_t i) {
+      Chunk &chunk = batch.chunks[i];
+      chunk.resolved.resize(chunk.markedSize - std::min(chunk.markedSize, kWindowSize));
+      const uint16_t *marked = chunk.marked.data() + kWindowSize;
+      const uint8_t *table = chunk.window.data();
+      // キャッシュに残っているうちに CRC-32 を求めるよう、少しずつ埋める
+      chunk.resolvedCrc = 0;
+      for (size_t begin = 0; begin < chunk.resolved.size(); begin += kWindowSize)
+      {
+        size_t end = std::min(begin + kWindowSize, chunk.resolved.size());
+        for (size_t j = begin; j < end; j++)
+        {
+          chunk.resolved[j] = table[marked[j]];
+        }
+        chunk.resolvedCrc = static_cast<uint32_t>(
+            crc32_z(chunk.resolvedCrc, chunk.resolved.data() + begin, static_cast<z_size_t>(end - begin)));
+      }
+    });
+    pool_->Wait(*resolve);
+    for (size_t i = 0; i < batch.count; i++)
+    {
+      const Chunk &chunk = batch.chunks[i];
+      for (auto [part, partCrc] :
+           {std::pair(chunk.Resolved(), chunk.resolvedCrc), std::pair(chunk.Bytes(), chunk.bytesCrc)})
+      {
+        crc = static_cast<uint32_t>(crc32_combine(crc, partCrc, static_cast<z_off_t>(part.size())));
+        totalSize += part.size();
+      }
+    }
+  };
+
+  Batch *current = &batches[0];
+  start(*current);
+  link(*current);
+  while (true)
+  {
+    Batch *following = nullptr;
+    if (!finished)
+    {
+      following = current == &batches[0] ? &batches[1] : &batches[0];
+      start(*following);
+    }
+    try
+    {
+      for (size_t i = 0; i < current->count; i++)
+      {
+        const Chunk &chunk = current->chunks[i];
+        for (std::string_view part : {chunk.Resolved(), chunk.Bytes()})
+        {
+          if (!part.empty())
+          {
+            output(part);
+          }
+        }
+      }
+    }
+    catch (...)
+    {
+      // 展開中の仕事は window やバッファを参照しているので、終わるのを待ってから戻る
+      if (following)
+      {
+        pool_->Finish(*following->job);
+      }
+      throw;
+    }
+    if (!following)
+    {
+      break;
+    }
+    link(*following);
+    current = following;
+  }
+
+  // 最後のブロックの後ろのバイト境界から、CRC-32 と展開後のサイズが続く
+  size_t trailer = static_cast<size_t>((position + 7) / 8);
+  if (!failed && trailer + 8 <= deflateSize && Read32(deflate + trailer) == crc &&
+      Read32(deflate + trailer + 4) == static_cast<uint32_t>(totalSize))
+  {
+    result.complete = true;
+    result.consumed = headerSize + trailer + 8;
+  }
+  return result;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string_view>
+
+// 1つのスレッドが受け持つ圧縮データの大きさ（展開したものがキャッシュに収まるよう小さめにする）
+constexpr size_t kParallelInflateChunkSize = 256 << 10;
+
+/**
+ * ParallelInflater::Inflate の結果
+ */
+struct ParallelInflateResult
+{
+  // メンバーを最後まで展開し、CRC-32 と展開後のサイズも合っていたか
+  bool complete = false;
+  // メンバーの終わり（CRC-32 と展開後のサイズの後ろ）までのバイト数（complete のときだけ）
+  size_t consumed = 0;
+};
+
+/**
+ * 1つの大きな gzip メンバーを、圧縮データを区切って複数のスレッドで展開するクラス（rapidgzip と同じ考え方）
+ *
+ * 圧縮データを chunkSize ごとに区切り、各スレッドは区切りの後ろで最初に見つかった動的ハフマンブロックの先頭から展開する
+ * 直前の 32KB の内容はまだ分からないので、それを参照した文字は窓の何バイト目かを表す印として残しておき、
+ * 前の区切りの展開が済んでから埋める
+ * 展開は次の区切りの後ろで始まるブロックの手前で止めるので、前の区切りが止まった位置と次の区切りで見つけた先頭は
+ * 一致するはずで、一致しなければ見つけた先頭はブロックに見えただけのデータとして、前の区切りの続きから展開し直す
+ * どの区切りで誤った先頭を見つけても、結果は先頭から1つずつ展開した場合と同じになる
+ *
+ * スレッドはインスタンスごとに一度だけ作り、FileScope で数えた同時に展開しているファイルの数で分け合うので、
+ * 多数のファイルを並列に展開している間は1つのファイルに補助スレッドを使わない
+ * 展開したデータを output に渡している間も、他のスレッドは次の区切りを展開している
+ */
+class ParallelInflater
+{
+public:
+  /**
+   * threads は呼び出し元のスレッドも含めて同時に使うスレッドの数
+   */
+  explicit ParallelInflater(size_t threads, size_t chunkSize = kParallelInflateChunkSize);
+  ~ParallelInflater();
+
+  ParallelInflater(const ParallelInflater &) = delete;
+  ParallelInflater &operator=(const ParallelInflater &) = delete;
+
+  /**
+   * スコープを抜けるまで、スレッドを分け合うファイルの1つに数える
+   * 小さなファイルを別の方法で展開している間も数えておけば、大きなファイルが CPU の数より多いスレッドを使わない
+   */
+  class FileScope
+  {
+  public:
+    explicit FileScope(const ParallelInflater &inflater);
+    ~FileScope();
+
+    FileScope(const FileScope &) = delete;
+    FileScope &operator=(const FileScope &) = delete;
+
+  private:
+    const ParallelInflater &inflater_;
+  };
+
+  /**
+   * 区切りが2つ以上になり、複数のスレッドで展開できる大きさか
+   */
+  bool IsWorthSplitting(std::string_view data) const
+  {
+    return data.size() >= chunkSize_ * 2;
+  }
+
+  /**
+   * data の先頭の gzip メンバーを展開し、展開したデータを先頭から順に output に渡す
+   * 壊れたデータや途中で切れたデータは、zlib と同じくそこまでに展開できた分を渡して complete = false を返す
+   * 複数のスレッドから同時に呼んでよい（それぞれ FileScope の中で呼ぶ）
+   */
+  ParallelInflateResult Inflate(std::string_view data, const std::function<void(std::string_view)> &output) const;
+
+private:
+  class Pool;
+
+  size_t threads_;
+  size_t chunkSize_;
+  std::unique_ptr<Pool> pool_;
+  // FileScope の中にいるファイルの数
+  mutable std::atomic<size_t> files_{0};
+};
@@ -0,0 +1,528 @@
+#include "Pipeline.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <thread>
+
+#include "BatchFileReader.h"
+#include "LogFile.h"
+#include "PurchaseScanner.h"
+
+namespace
+{
+
+/**
+ * 単一生産者・単一消費者の固定長ロックフリーキュー
+ * 満杯・空のときは std::atomic::wait で相手側の更新を待つ
+ */
+template <typename T, size_t Capacity> class SpscQueue
+{
+public:
+  void Push(const T &value)
+  {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head;
+    while (tail - (head = head_.load(std::memory_order_acquire)) == Capacity)
+    {
+      head_.wait(head, std::memory_order_acquire);
+    }
+    slots_[tail % Capacity] = value;
+    tail_.store(tail + 1, std::memory_order_release);
+    tail_.notify_one();
+  }
+
+  T Pop()
+  {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail;
+    while ((tail = tail_.load(std::memory_order_acquire)) == head)
+    {
+      tail_.wait(tail, std::memory_order_acquire);
+    }
+    T value = slots_[head % Capacity];
+    head_.store(head + 1, std::memory_order_release);
+    head_.notify_one();
+    return value;
+  }
+
+  /**
+   * 空なら待たずに false を返す Pop
+   */
+  bool TryPop(T &value)
+  {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (tail_.load(std::memory_order_acquire) == head)
+    {
+      return false;
+    }
+    value = slots_[head % Capacity];
+    head_.store(head + 1, std::memory_order_release);
+    head_.notify_one();
+    return true;
+  }
+
+private:
+  std::array<T, Capacity> slots_{};
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+};
+
+// パイプラインの各段が持つバッファの数
+constexpr size_t kPipelineBuffers = 8;
+
+// 読み込みの段が先に開いておくファイルの数（同時に出しておく開く・読む要求の数）
+constexpr size_t kReadAheadFiles = 64;
+
+// 読み込みの段のバッファの数（1つに収まる小さなファイルは、これだけのファイルを同時に読んでおける）
+constexpr size_t kReadBuffers = 32;
+
+/**
+ * パイプラインの段の間で受け渡すデータ
+ */
+struct PipelineBlock
+{
+  // ファイル番号（kPipelineEnd なら終了の合図）
+  size_t file;
+  // バッファ番号（データが無ければ -1）
+  int buffer;
+  size_t size;
+  // ファイルの最後のブロックか
+  bool last;
+  // ファイルを開けなかったか
+  bool failed;
+};
+
+constexpr size_t kPipelineEnd = static_cast<size_t>(-1);
+
+/**
+ * 読み込みの段が先に開いているファイルの状態
+ */
+enum class ReadState
+{
+  // 開く要求を出した
+  OPENING,
+  // 開いて、読み込みに使うバッファが空くのを待っている
+  OPENED,
+  // 読む要求を出した
+  READING,
+  // 読み終えた（空のファイルはバッファを使わずにここまで進む）
+  READ,
+  // バッファに収まらないので、順番が来たらメモリマップして読む
+  MAPPED,
+  // 開けなかったか、読めなかった
+  FAILED
+};
+
+struct ReadAheadFile
+{
+  size_t file;
+  ReadState state = ReadState::OPENING;
+  BatchFile handle = kNoBatchFile;
+  size_t size = 0;
+  int buffer = -1;
+  // 今の要求を出した時刻
+  std::chrono::steady_clock::time_point submitted;
+};
+
+/**
+ * begin から今までの時間を stats の stage に加える（stats が nullptr なら何もしない）
+ * 他のファイルの要求と重なっていても、そのファイルが待った時間として数える
+ */
+void AddStageTime(FileStats *stats, Stage stage, std::chrono::steady_clock::time_point begin)
+{
+  if (!stats)
+  {
+    return;
+  }
+  auto end = std::chrono::steady_clock::now();
+  stats->stageTime[static_cast<size_t>(stage)] += end - begin;
+  if (stats->trace)
+  {
+    stats->trace->Record(stage, stats->path, begin, end);
+  }
+}
+
+} // namespace
+
+void RunPipeline(const std::vector<std::string> &files, const ItemCatalog &catalog, std::vector<FileStats> *stats,
+                 const PipelineCallbacks &callbacks)
+{
+  auto fileStats = [&](size_t file) { return stats ? &(*stats)[file] : nullptr; };
+
+  std::vector<std::vector<char>> rawBuffers(kReadBuffers, std::vector<char>(kStreamBufferSize));
+  std::vector<std::vector<char>> textBuffers(kPipelineBuffers, std::vector<char>(kStreamBufferSize));
+  SpscQueue<PipelineBlock, kReadBuffers * 2> rawQueue;
+  SpscQueue<PipelineBlock, kPipelineBuffers * 2> textQueue;
+  SpscQueue<int, kReadBuffers> freeRaw;
+  SpscQueue<int, kPipelineBuffers> freeText;
+  for (int i = 0; i < static_cast<int>(kReadBuffers); i++)
+  {
+    freeRaw.Push(i);
+  }
+  for (int i = 0; i < static_cast<int>(kPipelineBuffers); i++)
+  {
+    freeText.Push(i);
+  }
+
+  // 1段目: ディスクから読み込む
+  // 1つのバッファに収まるファイルは、先の kReadAheadFiles 個まで開く・読む要求をまとめて出しておき、files の順に渡す
+  // 小さなログが何千もあっても、ディスクには常に多くの要求が届いていて、1つずつの待ち時間が積み重ならない
+  std::thread reader([&] {
+    // 読み込みの段が手元に持っている空きバッファ（freeRaw に戻すと生産者が2つになるので、ここに置いて使い回す）
+    std::vector<int> spareRaw;
+    auto acquireRaw = [&] {
+      int buffer = -1;
+      if (!spareRaw.empty())
+      {
+        buffer = spareRaw.back();
+        spareRaw.pop_back();
+      }
+      else
+      {
+        freeRaw.TryPop(buffer);
+      }
+      return buffer;
+    };
+
+    // バッファに収まらない大きなファイルはメモリマップして順にコピーする（大きなファイルは1つでも OS の先読みが効く）
+    auto readMapped = [&](size_t file) {
+      FileStats *readerStats = fileStats(file);
+      StageTimer openTimer(readerStats, Stage::OPEN);
+      MappedFile mapped(files[file]);
+      openTimer.Stop();
+      if (!mapped.IsOpen())
+      {
+        rawQueue.Push({file, -1, 0, true, true});
+        return;
+      }
+      std::string_view data = mapped.View();
+      if (callbacks.shouldScan && !callbacks.shouldScan(file, data))
+      {
+        return;
+      }
+      if (callbacks.onFileStart)
+      {
+        callbacks.onFileStart(file);
+      }
+
+      if (data.empty())
+      {
+        rawQueue.Push({file, -1, 0, true, false});
+      }
+      while (!data.empty())
+      {
+        int buffer = acquireRaw();
+        if (buffer < 0)
+        {
+          buffer = freeRaw.Pop();
+        }
+        // マップからのコピーで起きるページの読み込みを読み込みの時間として数える
+        StageTimer readTimer(readerStats, Stage::READ);
+        size_t size = std::min(data.size(), rawBuffers[buffer].size());
+        std::memcpy(rawBuffers[buffer].data(), data.data(), size);
+        data.remove_prefix(size);
+        readTimer.Stop();
+        if (readerStats)
+        {
+          readerStats->bytesIn += size;
+        }
+        rawQueue.Push({file, buffer, size, data.empty(), false});
+      }
+    };
+
+    BatchFileReader io(kReadAheadFiles);
+    // 開く要求を出したファイル（files の順で、先頭から次の段へ渡す）
+    std::deque<ReadAheadFile> window;
+    size_t nextOpen = 0;
+    size_t nextRead = 0;
+    auto entryOf = [&](size_t file) -> ReadAheadFile & { return window[file - window.front().file]; };
+
+    auto deliver = [&](const ReadAheadFile &entry) {
+      if (entry.state == ReadState::FAILED)
+      {
+        rawQueue.Push({entry.file, -1, 0, true, true});
+        return;
+      }
+      if (entry.state == ReadState::MAPPED)
+      {
+        readMapped(entry.file);
+        return;
+      }
+
+      std::string_view data = entry.buffer >= 0 ? std::string_view(rawBuffers[entry.buffer].data(), entry.size) : "";
+      if (callbacks.shouldScan && !callbacks.shouldScan(entry.file, data))
+      {
+        if (entry.buffer >= 0)
+        {
+          spareRaw.push_back(entry.buffer);
+        }
+        return;
+      }
+      if (callbacks.onFileStart)
+      {
+        callbacks.onFileStart(entry.file);
+      }
+      if (FileStats *readerStats = fileStats(entry.file))
+      {
+        readerStats->bytesIn += entry.size;
+      }
+      rawQueue.Push({entry.file, entry.buffer, entry.size, true, false});
+    };
+
+    while (nextOpen < files.size() || !window.empty())
+    {
+      while (nextOpen < files.size() && window.size() < kReadAheadFiles)
+      {
+        window.push_back({nextOpen, ReadState::OPENING, kNoBatchFile, 0, -1, std::chrono::steady_clock::now()});
+        if (FileStats *readerStats = fileStats(nextOpen))
+        {
+          readerStats->begin = window.back().submitted;
+        }
+        io.Open(files[nextOpen].c_str(), nextOpen);
+        nextOpen++;
+      }
+
+      // 読む要求は files の順に出すので、先頭のファイルが後ろのファイルにバッファを取られて読めなくなることはない
+      // メモリマップして読むファイルの後ろは、そのファイルがバッファを使い終えるまで読まない
+      for (; nextRead < nextOpen; nextRead++)
+      {
+        ReadAheadFile &entry = entryOf(nextRead);
+        if (entry.state == ReadState::OPENING || entry.state == ReadState::MAPPED)
+        {
+          break;
+        }
+        if (entry.state == ReadState::OPENED)
+        {
+          int buffer = acquireRaw();
+          if (buffer < 0)
+          {
+            break;
+          }
+          entry.buffer = buffer;
+          entry.state = ReadState::READING;
+          entry.submitted = std::chrono::steady_clock::now();
+          io.Read(entry.handle, 0, rawBuffers[buffer].data(), entry.size, entry.file);
+        }
+      }
+
+      ReadState head = window.front().state;
+      if (head == ReadState::READ || head == ReadState::MAPPED || head == ReadState::FAILED)
+      {
+        deliver(window.front());
+        // メモリマップして読んだファイルで止めていた読み込みを、その次のファイルから続ける
+        nextRead = std::max(nextRead, window.front().file + 1);
+        window.pop_front();
+        continue;
+      }
+      if (io.Pending() == 0)
+      {
+        // 先頭のファイルに使うバッファが、後の段から戻ってくるのを待つ
+        spareRaw.push_back(freeRaw.Pop());
+        continue;
+      }
+
+      BatchCompletion completion = io.Wait();
+      ReadAheadFile &entry = entryOf(completion.tag);
+      FileStats *readerStats = fileStats(entry.file);
+      if (entry.state == ReadState::OPENING)
+      {
+        AddStageTime(readerStats, Stage::OPEN, entry.submitted);
+        uint64_t size = 0;
+        if (!completion.ok)
+        {
+          entry.state = ReadState::FAILED;
+        }
+        else if (!io.Size(completion.file, size) || size > rawBuffers[0].size())
+        {
+          io.Close(completion.file);
+          entry.state = size > rawBuffers[0].size() ? ReadState::MAPPED : ReadState::FAILED;
+        }
+        else if (size == 0)
+        {
+          io.Close(completion.file);
+          entry.state = ReadState::READ;
+        }
+        else
+        {
+          entry.handle = completion.file;
+          entry.size = static_cast<size_t>(size);
+          entry.state = ReadState::OPENED;
+        }
+      }
+      else
+      {
+        AddStageTime(readerStats, Stage::READ, entry.submitted);
+        io.Close(entry.handle);
+        entry.handle = kNoBatchFile;
+        entry.size = completion.size;
+        entry.state = completion.ok ? ReadState::READ : ReadState::FAILED;
+        if (!completion.ok)
+        {
+          spareRaw.push_back(entry.buffer);
+          entry.buffer = -1;
+        }
+      }
+    }
+    rawQueue.Push({kPipelineEnd, -1, 0, true, false});
+  });
+
+  // 2段目: .gz を展開する（非圧縮ならそのまま渡す）
+  std::thread inflater([&] {
+    // メンバーの区切りと末尾のゴミの扱いは ReadFile と同じ GzipReader に任せる
+    GzipReader gzipReader;
+    size_t currentFile = kPipelineEnd;
+    bool gzip = false;
+
+    int text = -1;
+    size_t textUsed = 0;
+    auto flushText = [&](size_t file, bool last) {
+      if (text >= 0 && (textUsed > 0 || last))
+      {
+        textQueue.Push({file, text, textUsed, last, false});
+        text = -1;
+        textUsed = 0;
+      }
+      else if (last)
+      {
+        textQueue.Push({file, -1, 0, true, false});
+      }
+    };
+    auto acquireText = [&] {
+      if (text < 0)
+      {
+        text = freeText.Pop();
+        textUsed = 0;
+      }
+    };
+
+    while (true)
+    {
+      PipelineBlock block = rawQueue.Pop();
+      if (block.file == kPipelineEnd)
+      {
+        textQueue.Push(block);
+        break;
+      }
+      if (block.failed)
+      {
+        textQueue.Push(block);
+        continue;
+      }
+
+      const char *data = block.buffer >= 0 ? rawBuffers[block.buffer].data() : nullptr;
+      size_t size = block.size;
+
+      if (block.file != currentFile)
+      {
+        currentFile = block.file;
+        gzip = HasGzipMagic(std::string_view(data, size));
+        gzipReader.Reset({});
+      }
+
+      if (!gzip)
+      {
+        while (size > 0)
+        {
+          acquireText();
+          size_t copy = std::min(size, textBuffers[text].size() - textUsed);
+          std::memcpy(textBuffers[text].data() + textUsed, data, copy);
+          textUsed += copy;
+          data += copy;
+          size -= copy;
+          if (textUsed == textBuffers[text].size())
+          {
+            flushText(block.file, false);
+          }
+        }
+      }
+      else
+      {
+        gzipReader.Feed(std::string_view(data, size));
+        while (true)
+        {
+          acquireText();
+          StageTimer inflateTimer(fileStats(block.file), Stage::INFLATE);
+          size_t produced =
+              gzipReader.Read(textBuffers[text].data() + textUsed, textBuffers[text].size() - textUsed);
+          inflateTimer.Stop();
+          if (produced == 0)
+          {
+            break;
+          }
+          textUsed += produced;
+          if (textUsed == textBuffers[text].size())
+          {
+            flushText(block.file, false);
+          }
+        }
+      }
+
+      if (block.buffer >= 0)
+      {
+        freeRaw.Push(block.buffer);
+      }
+      if (block.last)
+      {
+        flushText(block.file, true);
+      }
+    }
+  });
+
+  // 3段目: 購入ログを走査する（呼び出し元のスレッドで実行）
+  std::unique_ptr<PurchaseStreamScanner> scanner;
+  while (true)
+  {
+    PipelineBlock block = textQueue.Pop();
+    if (block.file == kPipelineEnd)
+    {
+      break;
+    }
+    FileStats *scanStats = fileStats(block.file);
+    if (block.failed)
+    {
+      if (scanStats)
+      {
+        scanStats->end = scanStats->begin;
+      }
+      if (callbacks.onOpenFailed)
+      {
+        callbacks.onOpenFailed(block.file);
+      }
+      continue;
+    }
+
+    if (!scanner)
+    {
+      scanner = std::make_unique<PurchaseStreamScanner>();
+      scanner->SetCatalog(catalog);
+    }
+    scanner->SetStats(scanStats);
+    if (block.buffer >= 0)
+    {
+      scanner->Feed(std::string_view(textBuffers[block.buffer].data(), block.size));
+      freeText.Push(block.buffer);
+    }
+    if (block.last)
+    {
+      scanner->Finish();
+      if (callbacks.onFileDone)
+      {
+        callbacks.onFileDone(block.file, scanner->Purchases());
+      }
+      if (scanStats)
+      {
+        scanStats->matches = scanner->Purchases().Size();
+        scanStats->end = std::chrono::steady_clock::now();
+      }
+      // 購入データと一緒に行の時刻も捨て、次のファイルは最初の行から日付を数え直す
+      scanner->Reset();
+    }
+  }
+
+  reader.join();
+  inflater.join();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ItemCatalog.h"
+#include "Purchase.h"
+#include "Stats.h"
+
+/**
+ * RunPipeline が呼び出し元に任せる処理（空のものは呼ばない）
+ * パイプライン自身は何も出力しないので、進み具合や開けなかったファイルの表示はここで行う
+ */
+struct PipelineCallbacks
+{
+  // 展開・走査するか（false を返したファイルは展開も走査もせず、onFileStart も onFileDone も呼ばない）
+  // 読み込みの段のスレッドから files の順に呼ばれる
+  std::function<bool(size_t file, std::string_view data)> shouldScan;
+  // 展開・走査を始めるとき（読み込みの段のスレッドから呼ばれる）
+  std::function<void(size_t file)> onFileStart;
+  // 走査し終えたとき（RunPipeline を呼んだスレッドから呼ばれる）
+  std::function<void(size_t file, const PurchaseColumns &purchases)> onFileDone;
+  // ファイルを開けなかったとき（RunPipeline を呼んだスレッドから呼ばれる）
+  std::function<void(size_t file)> onOpenFailed;
+};
+
+/**
+ * 読み込み・展開・走査を別々のスレッドで同時に進めるパイプライン
+ * ディスクの読み込み待ちと展開・走査のCPU処理が重なるので、全体の時間は一番遅い段の時間に近くなる
+ * バッファは段ごとに固定数を使い回すので、ファイルの大きさに関係なくメモリ使用量は一定
+ * stats が nullptr でなければ、files と同じ順番の各要素に計測結果を加える
+ * 読み込みの段は BatchFileReader で先のファイルをまとめて開いて読み、shouldScan があればファイルの内容を渡して呼ぶ
+ * 1つのバッファ（kStreamBufferSize）に収まらないファイルは、一度だけ開いてメモリマップした内容を渡す
+ */
+void RunPipeline(const std::vector<std::string> &files, const ItemCatalog &catalog, std::vector<FileStats> *stats,
+                 const PipelineCallbacks &callbacks);
@@ -0,0 +1,205 @@
+#include "Platform.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <windows.h>
+// WIN32_LEAN_AND_MEAN では windows.h に含まれない
+#include <cderr.h>
+#include <commdlg.h>
+#else
+#include <sys/wait.h>
+#endif
+
+#ifdef __APPLE__
+#include <climits>
+#include <mach-o/dyld.h>
+#endif
+
+std::filesystem::path GetExecutableDirectory()
+{
+#if defined(_WIN32)
+  char path[MAX_PATH];
+  DWORD size = GetModuleFileNameA(NULL, path, MAX_PATH);
+  if (size > 0 && size < MAX_PATH)
+  {
+    return std::filesystem::path(std::string(path, size)).parent_path();
+  }
+#elif defined(__APPLE__)
+  char path[PATH_MAX];
+  uint32_t size = sizeof(path);
+  if (_NSGetExecutablePath(path, &size) == 0)
+  {
+    std::error_code ec;
+    std::filesystem::path resolved = std::filesystem::canonical(path, ec);
+    return (ec ? std::filesystem::path(path) : resolved).parent_path();
+  }
+#else
+  std::error_code ec;
+  std::filesystem::path path = std::filesystem::read_symlink("/proc/self/exe", ec);
+  if (!ec)
+  {
+    return path.parent_path();
+  }
+#endif
+  return std::filesystem::current_path();
+}
+
+#ifdef _WIN32
+
+bool SelectFilesWithDialog(std::vector<std::string> &selectedFiles)
+{
+  // 複数選択したファイル名はすべてこのバッファに入るので、大きめに確保する
+  std::vector<char> fileNames(1 << 20);
+
+  OPENFILENAMEA ofn;
+  ZeroMemory(&ofn, sizeof(ofn));
+  ofn.lStructSize = sizeof(ofn);
+  ofn.hwndOwner = NULL;
+  ofn.lpstrFile = fileNames.data();
+  ofn.nMaxFile = static_cast<DWORD>(fileNames.size());
+  ofn.lpstrFilter = "Log Files (*.log;*.log.gz)\0*.log;*.log.gz\0All Files (*.*)\0*.*\0";
+  ofn.nFilterIndex = 1;
+  ofn.lpstrFileTitle = NULL;
+  ofn.nMaxFileTitle = 0;
+  ofn.lpstrInitialDir = NULL;
+  ofn.Flags = OFN_ALLOWMULTISELECT | OFN_EXPLORER;
+
+  if (!GetOpenFileNameA(&ofn))
+  {
+    if (CommDlgExtendedError() == FNERR_BUFFERTOOSMALL)
+    {
+      std::cerr << "Too many files selected. Pass the log directory on the command line instead." << std::endl;
+    }
+    return false;
+  }
+
+  char *p = fileNames.data();
+  std::string directory = p;
+  p += directory.size() + 1;
+
+  if (*p)
+  { // 複数ファイル
+    while (*p)
+    {
+      std::string filePath = directory + "\\" + p;
+      selectedFiles.push_back(filePath);
+      p += std::strlen(p) + 1;
+    }
+  }
+  else
+  { // 単一ファイル
+    selectedFiles.push_back(directory);
+  }
+  return true;
+}
+
+#else
+
+namespace
+{
+
+// sh がコマンドを見つけられなかったときの終了コード
+constexpr int kCommandNotFound = 127;
+
+/**
+ * シェルのコマンドを実行して、標準出力の各行を lines に加える関数（終了コードを返す）
+ */
+int RunDialogCommand(const char *command, std::vector<std::string> &lines)
+{
+  FILE *pipe = popen(command, "r");
+  if (!pipe)
+  {
+    return kCommandNotFound;
+  }
+  std::string output;
+  char buffer[4096];
+  size_t readBytes;
+  while ((readBytes = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+  {
+    output.append(buffer, readBytes);
+  }
+  int status = pclose(pipe);
+
+  size_t begin = 0;
+  while (begin < output.size())
+  {
+    size_t end = output.find('\n', begin);
+    end = end == std::string::npos ? output.size() : end;
+    if (end > begin)
+    {
+      lines.emplace_back(output, begin, end - begin);
+    }
+    begin = end + 1;
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : kCommandNotFound;
+}
+
+/**
+ * ダイアログのコマンド（出せない環境なら nullptr）
+ * どちらも選んだファイルのパスを1行に1つ出力し、キャンセルされるとエラー終了する
+ */
+const char *DialogCommand()
+{
+#ifdef __APPLE__
+  return "osascript"
+         " -e 'set picked to choose file with prompt \"Select log files\" with multiple selections allowed'"
+         " -e 'set paths to \"\"'"
+         " -e 'repeat with f in picked'"
+         " -e 'set paths to paths & POSIX path of f & linefeed'"
+         " -e 'end repeat'"
+         " -e 'return paths' 2>/dev/null";
+#else
+  if (!std::getenv("DISPLAY") && !std::getenv("WAYLAND_DISPLAY"))
+  {
+    return nullptr;
+  }
+  // 区切りは引用符の中の改行
+  return "zenity --file-selection --multiple --title='Select log files' --separator='\n'"
+         " --file-filter='Log files | *.log *.log.gz' --file-filter='All files | *' 2>/dev/null";
+#endif
+}
+
+} // namespace
+
+bool SelectFilesWithDialog(std::vector<std::string> &selectedFiles)
+{
+  if (const char *command = DialogCommand())
+  {
+    std::vector<std::string> chosen;
+    int exitCode = RunDialogCommand(command, chosen);
+    if (exitCode != kCommandNotFound)
+    {
+      if (exitCode != 0 || chosen.empty())
+      {
+        return false;
+      }
+      selectedFiles.insert(selectedFiles.end(), chosen.begin(), chosen.end());
+      return true;
+    }
+  }
+
+  // デスクトップの無いサーバーなどでは、コンソールで入力してもらう
+  std::cout << "Enter log files, directories or globs, one per line (empty line to finish):" << std::endl;
+  size_t before = selectedFiles.size();
+  std::string line;
+  while (std::getline(std::cin, line))
+  {
+    if (!line.empty() && line.back() == '\r')
+    {
+      line.pop_back();
+    }
+    if (line.empty())
+    {
+      break;
+    }
+    selectedFiles.push_back(line);
+  }
+  return selectedFiles.size() > before;
+}
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * OS ごとに実装が異なる、コマンドラインの前面（main.cpp）だけで使う関数
+ * ライブラリ（jerryparser）には含めず、JerryParser の実行ファイルと一緒にビルドする
+ */
+
+/**
+ * 実行ファイルがあるディレクトリ（分からなければカレントディレクトリ）
+ */
+std::filesystem::path GetExecutableDirectory();
+
+/**
+ * ログを選んでもらう関数（キャンセルされたら false）
+ * Windows はファイル選択ダイアログ、macOS は osascript のダイアログ、
+ * それ以外はデスクトップがあれば zenity のダイアログを使う
+ * ダイアログを出せなければ、コンソールで1行に1つずつファイル・ディレクトリ・ワイルドカードを入力してもらう
+ */
+bool SelectFilesWithDialog(std::vector<std::string> &selectedFiles);
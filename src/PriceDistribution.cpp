@@ -0,0 +1,300 @@
+#include "PriceDistribution.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <map>
+#include <string>
+
+#include "Format.h"
+
+namespace
+{
+
+// 区間の比 (1 + α) / (1 - α) の対数
+const double kLogGamma = std::log((1 + PriceSketch::kRelativeAccuracy) / (1 - PriceSketch::kRelativeAccuracy));
+
+// これより絶対値の小さい値は 0 として数える（区間番号の範囲を抑えるため）
+constexpr double kMinMagnitude = 1e-3;
+
+// ヒストグラムの棒の最大の長さ
+constexpr size_t kBarWidth = 40;
+
+/**
+ * 値のヒストグラムの区切りの番号（1, 2, 5, 10, 20, 50... の区切りを 0, 1, 2, 3... とする、1 未満は -1）
+ */
+int HistogramBin(double value)
+{
+  if (value < 1)
+  {
+    return -1;
+  }
+  int decade = static_cast<int>(std::floor(std::log10(value)));
+  double mantissa = value / std::pow(10.0, decade);
+  // log10 の丸め誤差で仮数が [1, 10) から外れた分を直す
+  if (mantissa >= 10)
+  {
+    decade++;
+    mantissa /= 10;
+  }
+  else if (mantissa < 1)
+  {
+    decade--;
+    mantissa *= 10;
+  }
+  return decade * 3 + (mantissa < 2 ? 0 : mantissa < 5 ? 1 : 2);
+}
+
+/**
+ * ヒストグラムの区切りの下限（long long に収まらなければ最大値）
+ */
+long long HistogramBinLower(int bin)
+{
+  constexpr long long kSteps[] = {1, 2, 5};
+  long long lower = kSteps[bin % 3];
+  for (int decade = 0; decade < bin / 3; decade++)
+  {
+    if (lower > LLONG_MAX / 10)
+    {
+      return LLONG_MAX;
+    }
+    lower *= 10;
+  }
+  return lower;
+}
+
+void PrintPrice(std::ostream &out, const char *label, double price)
+{
+  long long coins = std::llround(price);
+  FormatBuffer coinsBuffer;
+  FormatBuffer numberBuffer;
+  out << label << ": " << FormatCoins(coins, coinsBuffer) << " (" << FormatNumber(coins, numberBuffer) << " coins)\n";
+}
+
+} // namespace
+
+void PriceSketch::Store::Add(int32_t key, uint64_t count)
+{
+  if (counts.empty())
+  {
+    offset = key;
+    counts.assign(1, 0);
+  }
+  else if (key < offset)
+  {
+    counts.insert(counts.begin(), static_cast<size_t>(offset - key), 0);
+    offset = key;
+  }
+  else if (static_cast<size_t>(key - offset) >= counts.size())
+  {
+    counts.resize(static_cast<size_t>(key - offset) + 1, 0);
+  }
+  counts[static_cast<size_t>(key - offset)] += count;
+}
+
+int32_t PriceSketch::BucketKey(double magnitude)
+{
+  return static_cast<int32_t>(std::ceil(std::log(magnitude) / kLogGamma));
+}
+
+double PriceSketch::BucketValue(int32_t key)
+{
+  // 区間 (γ^(key-1), γ^key] のどの値に対しても相対誤差が α になる点
+  double gamma = std::exp(kLogGamma);
+  return 2 * std::exp(key * kLogGamma) / (gamma + 1);
+}
+
+void PriceSketch::Add(double value, uint64_t count)
+{
+  if (count == 0)
+  {
+    return;
+  }
+  if (count_ == 0)
+  {
+    min_ = value;
+    max_ = value;
+  }
+  else
+  {
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+  count_ += count;
+
+  if (value >= kMinMagnitude)
+  {
+    positive_.Add(BucketKey(value), count);
+  }
+  else if (value <= -kMinMagnitude)
+  {
+    negative_.Add(BucketKey(-value), count);
+  }
+  else
+  {
+    zeroCount_ += count;
+  }
+}
+
+void PriceSketch::Merge(const PriceSketch &other)
+{
+  if (other.count_ == 0)
+  {
+    return;
+  }
+  if (count_ == 0)
+  {
+    *this = other;
+    return;
+  }
+
+  for (size_t i = 0; i < other.positive_.counts.size(); i++)
+  {
+    if (other.positive_.counts[i] > 0)
+    {
+      positive_.Add(other.positive_.offset + static_cast<int32_t>(i), other.positive_.counts[i]);
+    }
+  }
+  for (size_t i = 0; i < other.negative_.counts.size(); i++)
+  {
+    if (other.negative_.counts[i] > 0)
+    {
+      negative_.Add(other.negative_.offset + static_cast<int32_t>(i), other.negative_.counts[i]);
+    }
+  }
+  zeroCount_ += other.zeroCount_;
+  count_ += other.count_;
+  min_ = std::min(min_, other.min_);
+  max_ = std::max(max_, other.max_);
+}
+
+double PriceSketch::Quantile(double q) const
+{
+  if (count_ == 0)
+  {
+    return 0;
+  }
+  if (q <= 0)
+  {
+    return min_;
+  }
+  if (q >= 1)
+  {
+    return max_;
+  }
+
+  // 小さい方から数えて rank 番目（0 始まり）の値を含む区間の代表値
+  double rank = std::clamp(q, 0.0, 1.0) * static_cast<double>(count_ - 1);
+  double result = max_;
+  bool found = false;
+  uint64_t seen = 0;
+  ForEachBucket([&](double value, uint64_t count) {
+    if (!found && static_cast<double>(seen + count) > rank)
+    {
+      result = value;
+      found = true;
+    }
+    seen += count;
+  });
+  // 両端の区間の代表値が実際の最小・最大を越えないようにする
+  return std::clamp(result, min_, max_);
+}
+
+PriceDistribution::PriceDistribution(const ItemCatalog &catalog, long long recombobulatorPrice)
+    : families_(catalog.Families().size()), kinds_(kPurchaseKindCount)
+{
+  for (size_t family = 0; family < catalog.Families().size(); family++)
+  {
+    const ItemFamily &itemFamily = catalog.Families()[family];
+    for (size_t tier = 0; tier < itemFamily.tiers.size(); tier++)
+    {
+      long long multiplier = itemFamily.tiers[tier].multiplier;
+      kinds_[PurchaseKind(itemFamily.firstTier + tier, false)] = {static_cast<uint32_t>(family), multiplier, 0};
+      kinds_[PurchaseKind(itemFamily.firstTier + tier, true)] = {static_cast<uint32_t>(family), multiplier,
+                                                                  recombobulatorPrice};
+    }
+  }
+}
+
+void PriceDistribution::Add(const PurchaseColumns &purchases)
+{
+  for (size_t i = 0; i < purchases.Size(); i++)
+  {
+    const KindInfo &kind = kinds_[purchases.Kinds()[i]];
+    double price = static_cast<double>(purchases.Costs()[i] - kind.deduction) / static_cast<double>(kind.multiplier);
+    families_[kind.family].Add(price, static_cast<uint64_t>(kind.multiplier));
+  }
+}
+
+void PriceDistribution::Merge(const PriceDistribution &other)
+{
+  for (size_t family = 0; family < families_.size(); family++)
+  {
+    families_[family].Merge(other.families_[family]);
+  }
+}
+
+void PrintPriceDistribution(std::ostream &out, const PriceDistribution &distribution, const ItemCatalog &catalog)
+{
+  out << "\n========= Price Distribution =========\n";
+  bool first = true;
+  for (size_t family = 0; family < catalog.Families().size(); family++)
+  {
+    const PriceSketch &sketch = distribution.Family(family);
+    if (sketch.Count() == 0)
+    {
+      continue;
+    }
+    if (!first)
+    {
+      out << "-------------------------------------------\n";
+    }
+    first = false;
+
+    const std::string &base = catalog.Families()[family].BaseItemName();
+    out << "Per " << base << " (" << sketch.Count() << " converted)\n";
+    PrintPrice(out, "Min", sketch.Min());
+    PrintPrice(out, "P10", sketch.Quantile(0.10));
+    PrintPrice(out, "Median", sketch.Quantile(0.50));
+    PrintPrice(out, "P90", sketch.Quantile(0.90));
+    PrintPrice(out, "P99", sketch.Quantile(0.99));
+    PrintPrice(out, "Max", sketch.Max());
+
+    // 区間の代表値で 1, 2, 5... の区切りに振り分け、最初と最後の区切りの間は件数が無くても表示する
+    std::map<int, uint64_t> bins;
+    // 代表値は区間の中ほどなので、実際の最小・最大を越える分は端に寄せる
+    sketch.ForEachBucket([&](double value, uint64_t count) {
+      bins[HistogramBin(std::clamp(value, sketch.Min(), sketch.Max()))] += count;
+    });
+    uint64_t largest = 0;
+    for (const auto &[bin, count] : bins)
+    {
+      largest = std::max(largest, count);
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> rows;
+    size_t labelWidth = 0;
+    for (int bin = bins.begin()->first; bin <= bins.rbegin()->first; bin++)
+    {
+      std::string label;
+      if (bin < 0)
+      {
+        label = "< 1";
+      }
+      else
+      {
+        label = FormatCoins(HistogramBinLower(bin)) + " - " + FormatCoins(HistogramBinLower(bin + 1));
+      }
+      labelWidth = std::max(labelWidth, label.size());
+      auto it = bins.find(bin);
+      rows.emplace_back(std::move(label), it == bins.end() ? 0 : it->second);
+    }
+    for (const auto &[label, count] : rows)
+    {
+      size_t bar = static_cast<size_t>((count * kBarWidth + largest - 1) / largest);
+      out << "  " << label << std::string(labelWidth - label.size(), ' ') << "  " << std::string(bar, '#')
+          << std::string(kBarWidth - bar, ' ') << "  " << count << "\n";
+    }
+  }
+  out << "=============================================" << std::endl;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "ItemCatalog.h"
+#include "Purchase.h"
+
+/**
+ * 値の分布を一定のメモリで近似する DDSketch
+ * 値を相対誤差 kRelativeAccuracy 以内に収まる対数の区間に振り分けて、区間ごとの件数だけを持つ
+ * 分位数は真の値から相対誤差 kRelativeAccuracy 以内になり、区間ごとの件数を足すだけでマージできる
+ * 区間の数は値の範囲の対数に比例するので、1 から 10^12 まででも 1,400 程度で済む
+ */
+class PriceSketch
+{
+public:
+  static constexpr double kRelativeAccuracy = 0.01;
+
+  /**
+   * value を count 件分加える
+   */
+  void Add(double value, uint64_t count = 1);
+
+  void Merge(const PriceSketch &other);
+
+  uint64_t Count() const
+  {
+    return count_;
+  }
+
+  double Min() const
+  {
+    return min_;
+  }
+
+  double Max() const
+  {
+    return max_;
+  }
+
+  /**
+   * q（0 から 1）の分位数（空なら 0）
+   */
+  double Quantile(double q) const;
+
+  /**
+   * 値の小さい順に、区間の代表値とその件数を visit(value, count) に渡す
+   */
+  template <typename Visit> void ForEachBucket(Visit &&visit) const
+  {
+    for (size_t i = negative_.counts.size(); i-- > 0;)
+    {
+      if (negative_.counts[i] > 0)
+      {
+        visit(-BucketValue(negative_.offset + static_cast<int32_t>(i)), negative_.counts[i]);
+      }
+    }
+    if (zeroCount_ > 0)
+    {
+      visit(0.0, zeroCount_);
+    }
+    for (size_t i = 0; i < positive_.counts.size(); i++)
+    {
+      if (positive_.counts[i] > 0)
+      {
+        visit(BucketValue(positive_.offset + static_cast<int32_t>(i)), positive_.counts[i]);
+      }
+    }
+  }
+
+private:
+  /**
+   * 連続した区間番号の件数（必要な範囲だけを確保する）
+   */
+  struct Store
+  {
+    int32_t offset = 0;
+    std::vector<uint64_t> counts;
+
+    void Add(int32_t key, uint64_t count);
+  };
+
+  static int32_t BucketKey(double magnitude);
+  static double BucketValue(int32_t key);
+
+  // 絶対値が正の値と負の値の区間（負の値は絶対値で振り分ける）
+  Store positive_;
+  Store negative_;
+  uint64_t zeroCount_ = 0;
+  uint64_t count_ = 0;
+  double min_ = 0;
+  double max_ = 0;
+};
+
+/**
+ * 系統ごとの、最初の段階1個あたりの価格の分布
+ * 購入1件の価格（Recombobulated なら Recombobulator の価格を引く）を倍率で割り、倍率の個数分として加えるので、
+ * 分布の平均は ItemFamily::PricePerBase と同じになる
+ * ワーカーごとに集計し、最後に Merge でまとめる
+ */
+class PriceDistribution
+{
+public:
+  PriceDistribution(const ItemCatalog &catalog, long long recombobulatorPrice);
+
+  void Add(const PurchaseColumns &purchases);
+
+  void Merge(const PriceDistribution &other);
+
+  /**
+   * ItemCatalog::Families() の family 番目の系統の分布
+   */
+  const PriceSketch &Family(size_t family) const
+  {
+    return families_[family];
+  }
+
+private:
+  struct KindInfo
+  {
+    uint32_t family = 0;
+    long long multiplier = 1;
+    long long deduction = 0;
+  };
+
+  std::vector<PriceSketch> families_;
+  // PurchaseKind ごとの系統・倍率・差し引く Recombobulator の価格
+  std::vector<KindInfo> kinds_;
+};
+
+/**
+ * 系統ごとに、最初の段階1個あたりの価格の分位数（P10・中央値・P90・P99）とヒストグラムを表示する関数
+ * ヒストグラムの区切りは 1, 2, 5, 10, 20, 50... コイン
+ */
+void PrintPriceDistribution(std::ostream &out, const PriceDistribution &distribution, const ItemCatalog &catalog);
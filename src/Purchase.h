@@ -0,0 +1,283 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+/**
+ * 既定の品目表（ItemCatalog::Jerry）の段階の番号
+ */
+enum class JerryType
+{
+  GREEN,
+  BLUE,
+  PURPLE,
+  GOLDEN
+};
+
+// 品目表に載せられる段階の数
+constexpr size_t kMaxItemTiers = 32;
+
+// 段階と Recombobulated の組み合わせの数
+constexpr size_t kPurchaseKindCount = kMaxItemTiers * 2;
+
+/**
+ * 段階（品目表の番号）と Recombobulated を1バイトにまとめた番号（段階 * 2 + Recombobulated）
+ */
+constexpr uint8_t PurchaseKind(size_t tier, bool recombobulated)
+{
+  return static_cast<uint8_t>(tier * 2 + (recombobulated ? 1 : 0));
+}
+
+constexpr uint8_t PurchaseKind(JerryType type, bool recombobulated)
+{
+  return PurchaseKind(static_cast<size_t>(type), recombobulated);
+}
+
+// ログの行に時刻が無い場合の TalismanPurchase::time
+constexpr int32_t kNoTime = -1;
+
+constexpr int32_t kSecondsPerDay = 24 * 60 * 60;
+
+/**
+ * ログの行頭の時刻を順に見て、日付をまたいだ回数を数える時計
+ * 購入の行だけでなくすべての行の時刻を見るので、購入がまばらなログでも日付の変わり目を取りこぼさない
+ * チャンクに分けて走査するときは、同じ時計を渡し続ける
+ */
+struct LineClock
+{
+  // 購入の時刻は日付をまたいだ分を含めて int32_t の秒数で持つので、壊れたログでもこれより多くは数えない
+  static constexpr int32_t kMaxRollovers = INT32_MAX / kSecondsPerDay - 1;
+
+  // 直前の時刻のある行の時刻（まだ無ければ kNoTime）
+  int32_t previous = kNoTime;
+  // ここまでに時刻が戻った回数（日付をまたいだ回数）
+  int32_t rollovers = 0;
+
+  /**
+   * 行頭の時刻 time（その日の0時からの秒数）を進め、日付をまたいだら true を返す
+   */
+  bool Advance(int32_t time)
+  {
+    if (time == kNoTime)
+    {
+      return false;
+    }
+    bool rolled = previous != kNoTime && time < previous && rollovers < kMaxRollovers;
+    rollovers += rolled;
+    previous = time;
+    return rolled;
+  }
+};
+
+/**
+ * 購入データ
+ */
+struct TalismanPurchase
+{
+  // 品目表の段階の番号
+  uint8_t tier;
+  // Recombobulated?
+  bool recombobulated;
+  // 購入コスト
+  long long cost;
+  // 行頭の [HH:MM:SS] を、ログの最初の行の日付の0時からの秒数にしたもの（日付をまたぐたびに1日分増える、無ければ kNoTime）
+  int32_t time = kNoTime;
+};
+
+/**
+ * 購入データを列ごとに持つ入れ物
+ * 段階と Recombobulated を PurchaseKind の1バイトにまとめ、コストと時刻は別の列に置くので1件13バイトで済む
+ */
+class PurchaseColumns
+{
+public:
+  size_t Size() const
+  {
+    return kinds_.size();
+  }
+
+  bool Empty() const
+  {
+    return kinds_.empty();
+  }
+
+  void Clear()
+  {
+    kinds_.clear();
+    costs_.clear();
+    times_.clear();
+    invalidCosts_ = 0;
+    dayRollovers_ = 0;
+  }
+
+  void Reserve(size_t size)
+  {
+    kinds_.reserve(size);
+    costs_.reserve(size);
+    times_.reserve(size);
+  }
+
+  void Add(const TalismanPurchase &purchase)
+  {
+    Add(PurchaseKind(purchase.tier, purchase.recombobulated), purchase.cost, purchase.time);
+  }
+
+  void Add(uint8_t kind, int64_t cost, int32_t time)
+  {
+    kinds_.push_back(kind);
+    costs_.push_back(cost);
+    times_.push_back(time);
+  }
+
+  /**
+   * other を末尾に加える（other は同じログの続きを、同じ LineClock で走査したもの）
+   */
+  void Append(const PurchaseColumns &other)
+  {
+    kinds_.insert(kinds_.end(), other.kinds_.begin(), other.kinds_.end());
+    costs_.insert(costs_.end(), other.costs_.begin(), other.costs_.end());
+    times_.insert(times_.end(), other.times_.begin(), other.times_.end());
+    invalidCosts_ += other.invalidCosts_;
+    dayRollovers_ += other.dayRollovers_;
+  }
+
+  /**
+   * 走査したログの最初の行から最後の行までに日付をまたいだ回数（購入の無い行の時刻も含めて数える）
+   * 最後の行の日付からこれだけ遡った日が、Times() の起点になる
+   */
+  int32_t DayRollovers() const
+  {
+    return dayRollovers_;
+  }
+
+  void AddDayRollover()
+  {
+    dayRollovers_++;
+  }
+
+  void SetDayRollovers(int32_t rollovers)
+  {
+    dayRollovers_ = rollovers;
+  }
+
+  /**
+   * コストが読めず 0 コインとして加えた購入の件数（走査した結果だけで数え、キャッシュなどの保存ファイルには書かない）
+   */
+  size_t InvalidCostCount() const
+  {
+    return invalidCosts_;
+  }
+
+  void AddInvalidCost()
+  {
+    invalidCosts_++;
+  }
+
+  TalismanPurchase operator[](size_t index) const
+  {
+    return {static_cast<uint8_t>(kinds_[index] / 2), (kinds_[index] & 1) != 0, costs_[index], times_[index]};
+  }
+
+  const std::vector<uint8_t> &Kinds() const
+  {
+    return kinds_;
+  }
+
+  const std::vector<int64_t> &Costs() const
+  {
+    return costs_;
+  }
+
+  const std::vector<int32_t> &Times() const
+  {
+    return times_;
+  }
+
+private:
+  std::vector<uint8_t> kinds_;
+  std::vector<int64_t> costs_;
+  std::vector<int32_t> times_;
+  size_t invalidCosts_ = 0;
+  int32_t dayRollovers_ = 0;
+};
+
+/**
+ * 段階ごとの購入件数と合計コスト
+ * ワーカーごとに集計し、最後に Merge でまとめる
+ * counts と costs は PurchaseKind で引く表なので、段階ごとの分岐なしに集計できる
+ * 系統ごとの換算や平均価格は品目表の ItemFamily で求める
+ */
+struct PurchaseSummary
+{
+  std::array<long long, kPurchaseKindCount> counts{};
+  std::array<long long, kPurchaseKindCount> costs{};
+
+  void Add(const TalismanPurchase &purchase)
+  {
+    uint8_t kind = PurchaseKind(purchase.tier, purchase.recombobulated);
+    counts[kind]++;
+    costs[kind] += purchase.cost;
+  }
+
+  void Add(const PurchaseColumns &purchases)
+  {
+    // 同じ種類が続くと同じ要素への加算が直列に待たされるので、4本の表に振り分けてから足し合わせる
+    constexpr size_t kLanes = 4;
+    long long laneCounts[kLanes][kPurchaseKindCount] = {};
+    long long laneCosts[kLanes][kPurchaseKindCount] = {};
+
+    const uint8_t *kinds = purchases.Kinds().data();
+    const int64_t *purchaseCosts = purchases.Costs().data();
+    size_t size = purchases.Size();
+    size_t i = 0;
+    for (; i + kLanes <= size; i += kLanes)
+    {
+      for (size_t lane = 0; lane < kLanes; lane++)
+      {
+        laneCounts[lane][kinds[i + lane]]++;
+        laneCosts[lane][kinds[i + lane]] += purchaseCosts[i + lane];
+      }
+    }
+    for (; i < size; i++)
+    {
+      laneCounts[0][kinds[i]]++;
+      laneCosts[0][kinds[i]] += purchaseCosts[i];
+    }
+
+    for (size_t lane = 0; lane < kLanes; lane++)
+    {
+      for (size_t kind = 0; kind < kPurchaseKindCount; kind++)
+      {
+        counts[kind] += laneCounts[lane][kind];
+        costs[kind] += laneCosts[lane][kind];
+      }
+    }
+  }
+
+  void Merge(const PurchaseSummary &other)
+  {
+    for (size_t kind = 0; kind < kPurchaseKindCount; kind++)
+    {
+      counts[kind] += other.counts[kind];
+      costs[kind] += other.costs[kind];
+    }
+  }
+
+  long long Count(size_t tier, bool recombobulated) const
+  {
+    return counts[PurchaseKind(tier, recombobulated)];
+  }
+
+  long long PurchaseCount() const
+  {
+    return std::accumulate(counts.begin(), counts.end(), 0LL);
+  }
+
+  long long TotalCost() const
+  {
+    return std::accumulate(costs.begin(), costs.end(), 0LL);
+  }
+};
@@ -0,0 +1,116 @@
+#include "PurchaseCache.h"
+
+#include "BinaryIO.h"
+#include "LogFile.h"
+#include "PurchaseScanner.h"
+#include "XxHash.h"
+
+namespace
+{
+
+// フィンガープリントでハッシュを取る先頭・末尾の範囲
+constexpr size_t kFingerprintSpan = 64 * 1024;
+
+} // namespace
+
+bool ComputeFileFingerprint(const std::string &filePath, FileFingerprint &fingerprint)
+{
+  MappedFile file(filePath);
+  return file.IsOpen() && ComputeFileFingerprint(filePath, file.View(), fingerprint);
+}
+
+bool ComputeFileFingerprint(const std::string &filePath, std::string_view data, FileFingerprint &fingerprint)
+{
+  std::error_code ec;
+  auto mtime = std::filesystem::last_write_time(filePath, ec);
+  if (ec)
+  {
+    return false;
+  }
+
+  std::string_view head = data.substr(0, kFingerprintSpan);
+  std::string_view tail = data.size() > kFingerprintSpan ? data.substr(data.size() - kFingerprintSpan) : "";
+
+  fingerprint.path = filePath;
+  fingerprint.size = data.size();
+  fingerprint.mtime = mtime.time_since_epoch().count();
+  fingerprint.hash = XxHash64(tail.data(), tail.size(), XxHash64(head.data(), head.size()));
+  return true;
+}
+
+bool PurchaseCache::Load(const std::filesystem::path &cachePath, uint64_t catalogHash)
+{
+  std::string data;
+  if (!ReadBinaryFile(cachePath, data))
+  {
+    return false;
+  }
+  std::string_view in = data;
+
+  uint64_t hash;
+  uint32_t parserVersion;
+  uint32_t count;
+  if (!in.starts_with(kMagic) || (in.remove_prefix(kMagic.size()), !ReadValue(in, hash)) || hash != catalogHash ||
+      !ReadValue(in, parserVersion) || parserVersion != kPurchaseParserVersion || !ReadValue(in, count))
+  {
+    return false;
+  }
+
+  std::unordered_map<std::string, Entry> entries;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    Entry entry;
+    uint32_t pathSize;
+    if (!ReadValue(in, pathSize) || in.size() < pathSize)
+    {
+      return false;
+    }
+    entry.fingerprint.path = in.substr(0, pathSize);
+    in.remove_prefix(pathSize);
+    if (!ReadValue(in, entry.fingerprint.size) || !ReadValue(in, entry.fingerprint.mtime) ||
+        !ReadValue(in, entry.fingerprint.hash) || !ReadPurchases(in, entry.purchases))
+    {
+      return false;
+    }
+    std::string key = entry.fingerprint.path;
+    entries[key] = std::move(entry);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_ = std::move(entries);
+  dirty_ = false;
+  return true;
+}
+
+bool PurchaseCache::Save(const std::filesystem::path &cachePath, uint64_t catalogHash) const
+{
+  std::string out(kMagic);
+  AppendValue(out, catalogHash);
+  AppendValue(out, kPurchaseParserVersion);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    AppendValue(out, static_cast<uint32_t>(entries_.size()));
+    for (const auto &[key, entry] : entries_)
+    {
+      AppendValue(out, static_cast<uint32_t>(entry.fingerprint.path.size()));
+      out += entry.fingerprint.path;
+      AppendValue(out, entry.fingerprint.size);
+      AppendValue(out, entry.fingerprint.mtime);
+      AppendValue(out, entry.fingerprint.hash);
+      AppendPurchases(out, entry.purchases);
+    }
+  }
+  return WriteBinaryFileAtomically(cachePath, out);
+}
+
+bool PurchaseCache::Find(const FileFingerprint &fingerprint, PurchaseColumns &purchases) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(fingerprint.path);
+  if (it == entries_.end() || !(it->second.fingerprint == fingerprint))
+  {
+    return false;
+  }
+  purchases = it->second.purchases;
+  return true;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "Purchase.h"
+
+/**
+ * ファイルを識別する情報
+ * ローテーション済みのログは一度書かれたら変わらないので、これが一致すれば前回の抽出結果をそのまま使える
+ */
+struct FileFingerprint
+{
+  std::string path;
+  uint64_t size = 0;
+  int64_t mtime = 0;
+  // 先頭と末尾 64KB の XXH64
+  uint64_t hash = 0;
+
+  bool operator==(const FileFingerprint &) const = default;
+};
+
+/**
+ * ファイルのフィンガープリントを求める関数（開けなければ false）
+ */
+bool ComputeFileFingerprint(const std::string &filePath, FileFingerprint &fingerprint);
+
+/**
+ * 呼び出し側でメモリマップした filePath の内容 data からフィンガープリントを求める版（更新日時が取れなければ false）
+ * 走査に使うマップをそのまま渡せば、フィンガープリントのためにファイルを開き直さずに済む
+ */
+bool ComputeFileFingerprint(const std::string &filePath, std::string_view data, FileFingerprint &fingerprint);
+
+/**
+ * ファイルごとの抽出結果を保存しておくキャッシュ
+ * 複数のワーカーから同時に使える
+ *
+ * 購入データの段階の番号は品目表によって変わるので、別の品目表で保存したキャッシュは使わない
+ * 抽出の規則が変わっても結果が変わるので、kPurchaseParserVersion の違うキャッシュも使わない
+ *
+ * ファイル形式（リトルエンディアン）:
+ *   "JPC5" | 品目表のハッシュ u64 | 抽出規則の版 u32（kPurchaseParserVersion） | エントリー数 u32 |
+ *   エントリー: パス長 u32 | パス | サイズ u64 | 更新日時 i64 | ハッシュ u64 | 購入データ（AppendPurchases）
+ */
+class PurchaseCache
+{
+public:
+  /**
+   * キャッシュファイルを読み込む（無い・壊れている・catalogHash と別の品目表や別の抽出規則のものなら空のまま false を返す）
+   */
+  bool Load(const std::filesystem::path &cachePath, uint64_t catalogHash);
+
+  /**
+   * キャッシュファイルに書き出す（catalogHash は抽出に使った品目表の ItemCatalog::Hash）
+   */
+  bool Save(const std::filesystem::path &cachePath, uint64_t catalogHash) const;
+
+  /**
+   * フィンガープリントが一致するエントリーがあれば purchases に取り出す
+   */
+  bool Find(const FileFingerprint &fingerprint, PurchaseColumns &purchases) const;
+
+  void Store(const FileFingerprint &fingerprint, const PurchaseColumns &purchases)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[fingerprint.path] = {fingerprint, purchases};
+    dirty_ = true;
+  }
+
+  bool IsDirty() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dirty_;
+  }
+
+private:
+  static constexpr std::string_view kMagic = "JPC5";
+
+  struct Entry
+  {
+    FileFingerprint fingerprint;
+    PurchaseColumns purchases;
+  };
+
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  bool dirty_ = false;
+};
@@ -0,0 +1,156 @@
+#include "PurchaseDedup.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <utility>
+
+#include "TimeSeries.h"
+#include "XxHash.h"
+
+namespace
+{
+
+// 表の初期の大きさ（2のべき乗）
+constexpr size_t kInitialCapacity = 1 << 12;
+
+/**
+ * 購入1件のキー（0 は空きを表すので使わない）
+ */
+uint64_t PurchaseKey(uint64_t instanceHash, int64_t timestamp, uint8_t kind, int64_t cost)
+{
+  unsigned char record[25];
+  std::memcpy(record, &instanceHash, 8);
+  std::memcpy(record + 8, &timestamp, 8);
+  std::memcpy(record + 16, &cost, 8);
+  record[24] = kind;
+  uint64_t key = XxHash64(record, sizeof(record));
+  return key == 0 ? 1 : key;
+}
+
+} // namespace
+
+std::string LogInstanceName(const std::string &filePath)
+{
+  std::filesystem::path directory = std::filesystem::absolute(filePath).parent_path();
+  if (directory.filename() == "logs")
+  {
+    directory = directory.parent_path();
+  }
+  if (directory.filename() == ".minecraft" || directory.filename() == "minecraft")
+  {
+    directory = directory.parent_path();
+  }
+  return directory.filename().string();
+}
+
+PurchaseDeduplicator::PurchaseDeduplicator() : keys_(kInitialCapacity), counts_(kInitialCapacity)
+{
+}
+
+void PurchaseDeduplicator::Filter(std::string_view instance, int32_t day, const PurchaseColumns &purchases,
+                                  PurchaseColumns &kept)
+{
+  // 作業用の配列はファイルごとに確保し直さず、スレッドごとに使い回す
+  thread_local std::vector<int64_t> timestamps;
+  thread_local std::vector<std::pair<uint64_t, uint32_t>> keys;
+  thread_local std::vector<char> keep;
+
+  uint64_t instanceHash = XxHash64(instance.data(), instance.size());
+  PurchaseTimestamps(purchases, day, timestamps);
+
+  // 同じキーの購入を並べて、このファイルの中での件数を数える
+  keys.clear();
+  for (size_t i = 0; i < purchases.Size(); i++)
+  {
+    if (timestamps[i] != kNoTimestamp)
+    {
+      keys.emplace_back(PurchaseKey(instanceHash, timestamps[i], purchases.Kinds()[i], purchases.Costs()[i]),
+                        static_cast<uint32_t>(i));
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+
+  keep.assign(purchases.Size(), 1);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t begin = 0; begin < keys.size();)
+    {
+      size_t end = begin + 1;
+      while (end < keys.size() && keys[end].first == keys[begin].first)
+      {
+        end++;
+      }
+
+      // 他のログで既に数えた件数を超える分だけを残す
+      size_t count = std::min<size_t>(end - begin, std::numeric_limits<uint16_t>::max());
+      uint16_t &counted = Count(keys[begin].first);
+      size_t fresh = count > counted ? count - counted : 0;
+      counted = static_cast<uint16_t>(std::max<size_t>(counted, count));
+      for (size_t i = begin + fresh; i < end; i++)
+      {
+        keep[keys[i].second] = 0;
+        duplicates_++;
+      }
+      begin = end;
+    }
+  }
+
+  kept.Clear();
+  kept.Reserve(purchases.Size());
+  kept.SetDayRollovers(purchases.DayRollovers());
+  for (size_t i = 0; i < purchases.Size(); i++)
+  {
+    if (keep[i])
+    {
+      kept.Add(purchases.Kinds()[i], purchases.Costs()[i], purchases.Times()[i]);
+    }
+  }
+}
+
+uint16_t &PurchaseDeduplicator::Count(uint64_t key)
+{
+  // 埋まる割合が 3/4 を超えないようにする
+  if ((size_ + 1) * 4 > keys_.size() * 3)
+  {
+    Grow();
+  }
+
+  // キーは既にハッシュなので、下位ビットをそのまま位置に使って線形探索する
+  size_t mask = keys_.size() - 1;
+  size_t slot = static_cast<size_t>(key) & mask;
+  while (keys_[slot] != 0 && keys_[slot] != key)
+  {
+    slot = (slot + 1) & mask;
+  }
+  if (keys_[slot] == 0)
+  {
+    keys_[slot] = key;
+    size_++;
+  }
+  return counts_[slot];
+}
+
+void PurchaseDeduplicator::Grow()
+{
+  std::vector<uint64_t> keys(keys_.size() * 2);
+  std::vector<uint16_t> counts(counts_.size() * 2);
+  size_t mask = keys.size() - 1;
+  for (size_t i = 0; i < keys_.size(); i++)
+  {
+    if (keys_[i] == 0)
+    {
+      continue;
+    }
+    size_t slot = static_cast<size_t>(keys_[i]) & mask;
+    while (keys[slot] != 0)
+    {
+      slot = (slot + 1) & mask;
+    }
+    keys[slot] = keys_[i];
+    counts[slot] = counts_[i];
+  }
+  keys_ = std::move(keys);
+  counts_ = std::move(counts);
+}
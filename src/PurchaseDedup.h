@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Purchase.h"
+
+/**
+ * ログのあるインスタンスの名前を求める関数
+ * .../Skyblock/.minecraft/logs/latest.log や .../Skyblock/logs/2024-05-01-1.log.gz なら "Skyblock"
+ * インスタンスのフォルダーを丸ごとバックアップした場合も、フォルダー名が同じなら同じインスタンスになる
+ */
+std::string LogInstanceName(const std::string &filePath);
+
+/**
+ * 複数のログに含まれる同じ購入を一度だけ数えるためのクラス
+ * latest.log とそれを圧縮した .log.gz や、同じインスタンスのバックアップを一緒に集計する場合に使う
+ *
+ * 購入は（インスタンス, 日時, 種類, コスト）で識別し、1つのログの中で同じ購入が何件あるかを数える
+ * 複数のログに含まれる購入はその件数の最大だけを残すので、同じ秒に同じ価格で続けて買った分は消えず、
+ * どの順番でログを加えても結果は同じになる
+ * キーは 64 ビットのハッシュにして開番地法の表に持つので、1件あたり十数バイトで済む
+ * 複数のワーカーから同時に使える
+ */
+class PurchaseDeduplicator
+{
+public:
+  PurchaseDeduplicator();
+
+  /**
+   * 1ファイル分の購入データのうち、他のログで数えていない分だけを kept に書き込む（kept は先に空にする）
+   * instance は LogInstanceName、day はファイルの日付（LogFileDay）
+   * 行頭の時刻が無い購入は区別できないので、すべて残す
+   */
+  void Filter(std::string_view instance, int32_t day, const PurchaseColumns &purchases, PurchaseColumns &kept);
+
+  /**
+   * 重複として除いた購入の件数
+   */
+  size_t DuplicateCount() const
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return duplicates_;
+  }
+
+private:
+  /**
+   * key の件数の表の要素（無ければ追加する）
+   */
+  uint16_t &Count(uint64_t key);
+  void Grow();
+
+  mutable std::mutex mutex_;
+  // 0 は空き
+  std::vector<uint64_t> keys_;
+  std::vector<uint16_t> counts_;
+  size_t size_ = 0;
+  size_t duplicates_ = 0;
+};
@@ -0,0 +1,272 @@
+#include "PurchaseExport.h"
+
+#include <algorithm>
+
+#include "BinaryIO.h"
+#include "LogFile.h"
+#include "TimeSeries.h"
+
+namespace
+{
+
+constexpr std::string_view kExportMagic = "JPX3";
+constexpr size_t kSectionCount = 5;
+
+void AppendPadding(std::string &out)
+{
+  out.append((8 - out.size() % 8) % 8, '\0');
+}
+
+} // namespace
+
+void PurchaseExportWriter::AddFile(const std::string &filePath, int32_t day, const PurchaseColumns &purchases)
+{
+  File file{filePath, day, purchases, std::vector<int64_t>(purchases.Size(), kNoTimestamp)};
+  if (day != kExportNoDay)
+  {
+    PurchaseTimestamps(purchases, day, file.timestamps);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  files_.push_back(std::move(file));
+}
+
+std::vector<size_t> PurchaseExportWriter::SortedFiles() const
+{
+  // ワーカーが終えた順ではなくパスの順にすれば、同じ入力からは毎回同じバイト列になる
+  std::vector<size_t> order(files_.size());
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return files_[a].path < files_[b].path; });
+  return order;
+}
+
+bool PurchaseExportWriter::Write(const std::filesystem::path &exportPath) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::string tiers;
+  AppendValue(tiers, static_cast<uint32_t>(catalog_.TierCount()));
+  for (const auto &family : catalog_.Families())
+  {
+    for (const auto &tier : family.tiers)
+    {
+      AppendValue(tiers, static_cast<uint32_t>(tier.itemNames.front().size()));
+      tiers += tier.itemNames.front();
+    }
+  }
+
+  std::string files;
+  std::string kinds;
+  std::string timestamps;
+  std::string costs;
+  uint64_t purchaseCount = 0;
+  int64_t previousTimestamp = 0;
+  std::vector<int64_t> previousCosts(catalog_.TierCount() * 2);
+  for (size_t index : SortedFiles())
+  {
+    const File &file = files_[index];
+    AppendValue(files, static_cast<uint32_t>(file.path.size()));
+    files += file.path;
+    AppendValue(files, file.day);
+    AppendValue(files, static_cast<uint32_t>(file.purchases.Size()));
+
+    for (size_t i = 0; i < file.purchases.Size(); i++)
+    {
+      uint8_t kind = file.purchases.Kinds()[i];
+      if (file.timestamps[i] == kNoTimestamp)
+      {
+        kind |= kExportNoTimeFlag;
+      }
+      else
+      {
+        AppendVarint(timestamps, ZigZagEncode(file.timestamps[i] - previousTimestamp));
+        previousTimestamp = file.timestamps[i];
+      }
+      kinds += static_cast<char>(kind);
+      int64_t &previousCost = previousCosts[file.purchases.Kinds()[i]];
+      AppendVarint(costs, ZigZagEncode(file.purchases.Costs()[i] - previousCost));
+      previousCost = file.purchases.Costs()[i];
+    }
+    purchaseCount += file.purchases.Size();
+  }
+
+  const std::string *sections[kSectionCount] = {&tiers, &files, &kinds, &timestamps, &costs};
+  std::string out(kExportMagic);
+  AppendValue(out, static_cast<uint32_t>(files_.size()));
+  AppendValue(out, purchaseCount);
+  AppendValue(out, catalog_.Hash());
+  for (const std::string *section : sections)
+  {
+    AppendValue(out, static_cast<uint64_t>(section->size()));
+  }
+  for (const std::string *section : sections)
+  {
+    out += *section;
+    AppendPadding(out);
+  }
+  return WriteBinaryFileAtomically(exportPath, out);
+}
+
+bool PurchaseExportWriter::Verify(const std::filesystem::path &exportPath) const
+{
+  PurchaseExport exported;
+  if (!ReadPurchaseExport(exportPath.string(), exported))
+  {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (exported.catalogHash != catalog_.Hash() || exported.tierNames.size() != catalog_.TierCount() ||
+      exported.files.size() != files_.size())
+  {
+    return false;
+  }
+  size_t purchase = 0;
+  size_t fileIndex = 0;
+  for (size_t index : SortedFiles())
+  {
+    const File &file = files_[index];
+    const PurchaseExport::File &entry = exported.files[fileIndex++];
+    if (entry.path != file.path || entry.day != file.day || entry.purchaseCount != file.purchases.Size())
+    {
+      return false;
+    }
+    for (size_t i = 0; i < file.purchases.Size(); i++, purchase++)
+    {
+      if (exported.purchases.Kinds()[purchase] != file.purchases.Kinds()[i] ||
+          exported.purchases.Costs()[purchase] != file.purchases.Costs()[i] ||
+          exported.timestamps[purchase] != file.timestamps[i])
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool ReadPurchaseExport(const std::string &exportPath, PurchaseExport &result)
+{
+  MappedFile file(exportPath);
+  if (!file.IsOpen())
+  {
+    return false;
+  }
+  std::string_view in = file.View();
+
+  PurchaseExport exported;
+  uint32_t fileCount;
+  uint64_t purchaseCount;
+  uint64_t sectionSizes[kSectionCount];
+  if (!in.starts_with(kExportMagic) || (in.remove_prefix(kExportMagic.size()), !ReadValue(in, fileCount)) ||
+      !ReadValue(in, purchaseCount) || !ReadValue(in, exported.catalogHash))
+  {
+    return false;
+  }
+  for (uint64_t &size : sectionSizes)
+  {
+    if (!ReadValue(in, size))
+    {
+      return false;
+    }
+  }
+
+  std::string_view sections[kSectionCount];
+  for (size_t i = 0; i < kSectionCount; i++)
+  {
+    if (in.size() < sectionSizes[i])
+    {
+      return false;
+    }
+    sections[i] = in.substr(0, sectionSizes[i]);
+    in.remove_prefix(sectionSizes[i]);
+    in.remove_prefix(std::min<size_t>(in.size(), (8 - sectionSizes[i] % 8) % 8));
+  }
+  auto [tiers, files, kinds, timestamps, costs] = sections;
+  if (kinds.size() != purchaseCount)
+  {
+    return false;
+  }
+
+  uint32_t tierCount;
+  if (!ReadValue(tiers, tierCount) || tierCount > kMaxItemTiers)
+  {
+    return false;
+  }
+  for (uint32_t i = 0; i < tierCount; i++)
+  {
+    uint32_t nameSize;
+    if (!ReadValue(tiers, nameSize) || tiers.size() < nameSize)
+    {
+      return false;
+    }
+    exported.tierNames.emplace_back(tiers.substr(0, nameSize));
+    tiers.remove_prefix(nameSize);
+  }
+
+  uint64_t listed = 0;
+  for (uint32_t i = 0; i < fileCount; i++)
+  {
+    uint32_t pathSize;
+    PurchaseExport::File entry;
+    if (!ReadValue(files, pathSize) || files.size() < pathSize)
+    {
+      return false;
+    }
+    entry.path = files.substr(0, pathSize);
+    files.remove_prefix(pathSize);
+    if (!ReadValue(files, entry.day) || !ReadValue(files, entry.purchaseCount))
+    {
+      return false;
+    }
+    listed += entry.purchaseCount;
+    exported.files.push_back(std::move(entry));
+  }
+  if (listed != purchaseCount)
+  {
+    return false;
+  }
+
+  exported.purchases.Reserve(purchaseCount);
+  exported.timestamps.reserve(purchaseCount);
+  int64_t timestamp = 0;
+  std::vector<int64_t> previousCosts(tierCount * 2);
+  for (char c : kinds)
+  {
+    uint8_t kind = static_cast<uint8_t>(c);
+    uint64_t cost;
+    if (!ReadVarint(costs, cost) || (kind & ~kExportNoTimeFlag) >= tierCount * 2)
+    {
+      return false;
+    }
+    if (kind & kExportNoTimeFlag)
+    {
+      exported.timestamps.push_back(kNoTimestamp);
+    }
+    else
+    {
+      uint64_t delta;
+      if (!ReadVarint(timestamps, delta))
+      {
+        return false;
+      }
+      timestamp += ZigZagDecode(delta);
+      exported.timestamps.push_back(timestamp);
+    }
+
+    // ファイルの中で日付をまたいだ回数は書き出していないので、時刻はその日の0時からの秒数だけを戻す（日付は timestamps にある）
+    int64_t time = exported.timestamps.back();
+    int32_t secondOfDay = time == kNoTimestamp
+                              ? kNoTime
+                              : static_cast<int32_t>(((time % kSecondsPerDay) + kSecondsPerDay) % kSecondsPerDay);
+    kind &= ~kExportNoTimeFlag;
+    int64_t &previousCost = previousCosts[kind];
+    previousCost += ZigZagDecode(cost);
+    exported.purchases.Add(kind, previousCost, secondOfDay);
+  }
+
+  result = std::move(exported);
+  return true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ItemCatalog.h"
+#include "Purchase.h"
+
+/**
+ * 抽出した購入データを列ごとのバイナリファイルに書き出すクラス
+ * 複数のワーカーから同時に AddFile してよい（ファイルは書き出すときにパスの順に並べるので、加えた順によらず同じ内容になる）
+ *
+ * ファイル形式（リトルエンディアン、各セクションは8バイト境界から始まる）:
+ *   "JPX3" | ファイル数 u32 | 購入件数 u64 | 品目表の ItemCatalog::Hash u64 | 各セクションのバイト数 u64 * 5 |
+ *   品目表: 段階数 u32 | (段階の最初の品目名の長さ u32 | 品目名) * 段階数
+ *   ファイル表: (パス長 u32 | パス | 日付 i32 | 件数 u32) * ファイル数
+ *   種類: PurchaseKind u8 * 購入件数（時刻が無ければ kExportNoTimeFlag を立てる）
+ *   日時: 直前の購入との差の ZigZag 可変長整数 * 時刻のある購入件数（1970-01-01 0時からの秒数、ローカル時刻）
+ *   コスト: 同じ種類の直前の購入のコストとの差の ZigZag 可変長整数 * 購入件数（種類ごとの最初は 0 との差）
+ * 購入データはファイル表の順に並ぶので、各購入のファイル番号は件数の累計から分かる
+ * 種類の段階は品目表のセクションの番号なので、items.txt を変えた後でも品目名が分かる
+ * 種類の列は固定長なので、メモリマップしたまま読める
+ * 同じ種類の価格は近いので、コストは種類ごとに差を取る（Green と Golden のように桁の違う種類をまたぐ差は大きくなる）
+ */
+class PurchaseExportWriter
+{
+public:
+  explicit PurchaseExportWriter(const ItemCatalog &catalog) : catalog_(catalog)
+  {
+  }
+
+  /**
+   * 1ファイル分の購入データを加える（day は LogFileDay の日付、分からなければ kExportNoDay）
+   */
+  void AddFile(const std::string &filePath, int32_t day, const PurchaseColumns &purchases);
+
+  bool Write(const std::filesystem::path &exportPath) const;
+
+  /**
+   * 書き出したファイルを ReadPurchaseExport で読み戻し、加えた内容と同じかを確かめる
+   */
+  bool Verify(const std::filesystem::path &exportPath) const;
+
+private:
+  struct File
+  {
+    std::string path;
+    int32_t day;
+    PurchaseColumns purchases;
+    // 購入データごとの日時（分からなければ kNoTimestamp）
+    std::vector<int64_t> timestamps;
+  };
+
+  /**
+   * パスの順に並べたファイルの番号
+   */
+  std::vector<size_t> SortedFiles() const;
+
+  const ItemCatalog &catalog_;
+  mutable std::mutex mutex_;
+  std::vector<File> files_;
+};
+
+// ファイル表の日付が分からない場合の値
+constexpr int32_t kExportNoDay = INT32_MIN;
+
+// 種類の列で、その購入に時刻が無いことを表すビット
+constexpr uint8_t kExportNoTimeFlag = 0x80;
+
+/**
+ * 書き出したファイルを読み込んだ内容
+ */
+struct PurchaseExport
+{
+  struct File
+  {
+    std::string path;
+    int32_t day;
+    uint32_t purchaseCount;
+  };
+
+  // 書き出したときの品目表の ItemCatalog::Hash と、段階ごとの最初の品目名
+  uint64_t catalogHash = 0;
+  std::vector<std::string> tierNames;
+  std::vector<File> files;
+  // すべてのファイルの購入データを続けたもの（時刻はその日の0時からの秒数で、日付は timestamps で分かる）
+  PurchaseColumns purchases;
+  // 購入データごとの日時（分からなければ kNoTimestamp）
+  std::vector<int64_t> timestamps;
+};
+
+/**
+ * PurchaseExportWriter で書き出したファイルを読み込む関数（開けない・壊れている場合は false）
+ */
+bool ReadPurchaseExport(const std::string &exportPath, PurchaseExport &result);
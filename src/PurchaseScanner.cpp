@@ -0,0 +1,631 @@
+#include "PurchaseScanner.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define JERRY_SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define JERRY_SIMD_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define JERRY_SIMD_NEON
+#endif
+
+namespace
+{
+
+// 購入メッセージの各トークン
+constexpr std::string_view kPurchaseAnchor = "You purchased ";
+constexpr std::string_view kForToken = "for ";
+constexpr std::string_view kCoinsToken = " coins";
+// §カラーコードの記号（UTF-8）
+constexpr std::string_view kSectionSign = "\xC2\xA7";
+
+/**
+ * 購入メッセージ1件分の照合結果
+ */
+struct PurchaseMatch
+{
+  // 品目名直前の1バイト（レアリティのカラーコード）
+  char rarity;
+  // 品目表の段階の番号
+  size_t tier;
+  // カラーコードを除いた数値部分（カンマ・小数点・k/m/b の省略形を含む）
+  std::string_view cost;
+  // 照合の終端（行の先頭からのオフセット）
+  size_t end;
+};
+
+bool IsCostChar(char c)
+{
+  return (c >= '0' && c <= '9') || c == ',' || c == '.';
+}
+
+// 1.2m や 500k のような省略形の単位
+bool IsCostSuffix(char c)
+{
+  return c == 'k' || c == 'K' || c == 'm' || c == 'M' || c == 'b' || c == 'B';
+}
+
+/**
+ * "You purchased " 以降、行末までの文字列を照合する関数
+ *
+ * 以前の正規表現
+ *   You purchased .+(.)(Green|Blue|PurPle|Golden) Jerry (Talisman|Artifact) .+for .+?([0-9,]+) coins
+ * の品目名の部分を catalog の品目名すべての選択にしたものに沿って、
+ * 貪欲な .+ は「条件を満たす最後の候補」、最短の .+? は「条件を満たす最初の候補」として
+ * 後ろから一度ずつ位置を決めるため、バックトラックは発生しない
+ * どの "for " と " coins" に合わせるかは正規表現と同じで、数値として読む範囲だけが異なる
+ * 数値は "for " の直後から始まってもよく、"§6" のようなカラーコードの数字は数値に含めない
+ * （以前はカラーコードの有無に関係なく先頭の1文字を捨てていたため、カラーコードの無い行で桁が落ちていた）
+ */
+bool MatchPurchaseLine(std::string_view line, const ItemCatalog &catalog, PurchaseMatch &match)
+{
+  // "[0-9,.kmb] coins" となる最後の位置（数値の末尾）
+  size_t coins = line.rfind(kCoinsToken);
+  while (coins != std::string_view::npos &&
+         (coins == 0 || !(IsCostChar(line[coins - 1]) || IsCostSuffix(line[coins - 1]))))
+  {
+    coins = coins == 0 ? std::string_view::npos : line.rfind(kCoinsToken, coins - 1);
+  }
+  if (coins == std::string_view::npos)
+  {
+    return false;
+  }
+  size_t lastCostChar = coins - 1;
+
+  // "for " の後ろに最低1文字、その後に数値が来る最後の "for "
+  if (lastCostChar < kForToken.size() + 1)
+  {
+    return false;
+  }
+  size_t forPos = line.rfind(kForToken, lastCostChar - kForToken.size() - 1);
+  if (forPos == std::string_view::npos)
+  {
+    return false;
+  }
+
+  // "(.)(品目名) " の後ろに最低1文字空けて "for " が来る最後の候補
+  // 品目名の前には "You purchased " の後ろの最低1文字とレアリティの1文字が要る
+  ItemMatch item;
+  if (forPos < 1 || !catalog.FindLastItem(line.substr(0, forPos - 1), 2, item))
+  {
+    return false;
+  }
+  match.rarity = line[item.begin - 1];
+  match.tier = item.tier;
+
+  // "for " の後ろに最低1文字空けて、" coins" で終わる数値列に入る最初の位置
+  size_t i = forPos + kForToken.size() + 1;
+  while (i <= lastCostChar)
+  {
+    if (!IsCostChar(line[i]))
+    {
+      i++;
+      continue;
+    }
+    size_t runEnd = i;
+    while (runEnd < line.size() && IsCostChar(line[runEnd]))
+    {
+      runEnd++;
+    }
+    size_t costEnd = runEnd < line.size() && IsCostSuffix(line[runEnd]) ? runEnd + 1 : runEnd;
+    if (line.substr(costEnd, kCoinsToken.size()) == kCoinsToken)
+    {
+      // 空けた1文字も数字なら数値は "for " の直後から始まる。直前が "§" なら先頭の1文字はカラーコード
+      size_t costBegin = i;
+      if (i == forPos + kForToken.size() + 1 && IsCostChar(line[i - 1]))
+      {
+        costBegin = i - 1;
+      }
+      else if (line.substr(i - kSectionSign.size(), kSectionSign.size()) == kSectionSign)
+      {
+        costBegin = i + 1;
+      }
+      match.cost = line.substr(costBegin, costEnd - costBegin);
+      match.end = costEnd + kCoinsToken.size();
+      return true;
+    }
+    i = runEnd;
+  }
+
+  return false;
+}
+
+/**
+ * 購入メッセージの数値部分をコストに変換する関数（読めなければ false）
+ * カンマは桁区切りとして読み飛ばし、"1.2m" や "500k" のような省略形は単位を掛けて小数点以下を切り捨てる
+ * メモリを確保せず、桁あふれも読めない数値として扱う
+ */
+bool ParseCost(std::string_view text, long long &cost)
+{
+  constexpr long long kMax = std::numeric_limits<long long>::max();
+
+  long long unit = 1;
+  if (!text.empty() && IsCostSuffix(text.back()))
+  {
+    char suffix = static_cast<char>(text.back() | 0x20);
+    unit = suffix == 'k' ? 1000LL : suffix == 'm' ? 1000000LL : 1000000000LL;
+    text.remove_suffix(1);
+  }
+
+  long long integer = 0;
+  long long fraction = 0;
+  long long fractionScale = 1;
+  bool hasDigit = false;
+  bool inFraction = false;
+  for (char c : text)
+  {
+    if (c == ',' && !inFraction)
+    {
+      continue;
+    }
+    if (c == '.' && !inFraction && unit > 1)
+    {
+      inFraction = true;
+      continue;
+    }
+    if (c < '0' || c > '9')
+    {
+      return false;
+    }
+    int digit = c - '0';
+    hasDigit = true;
+    if (!inFraction)
+    {
+      if (integer > (kMax - digit) / 10)
+      {
+        return false;
+      }
+      integer = integer * 10 + digit;
+    }
+    else if (fractionScale < unit)
+    {
+      // 単位より細かい桁は1コイン未満なので読み飛ばす
+      fraction = fraction * 10 + digit;
+      fractionScale *= 10;
+    }
+  }
+  long long fractionCost = fraction * (unit / fractionScale);
+  if (!hasDigit || integer > (kMax - fractionCost) / unit)
+  {
+    return false;
+  }
+  cost = integer * unit + fractionCost;
+  return true;
+}
+
+/**
+ * lineBegin から始まる行の先頭にある "[HH:MM:SS]" を、その日の0時からの秒数にする関数（無ければ kNoTime）
+ */
+int32_t ParseLineTime(std::string_view logContent, size_t lineBegin)
+{
+  std::string_view prefix = logContent.substr(lineBegin, 10);
+  auto digits = [&](size_t i) {
+    char tens = prefix[i];
+    char ones = prefix[i + 1];
+    return tens >= '0' && tens <= '9' && ones >= '0' && ones <= '9' ? (tens - '0') * 10 + (ones - '0') : -1;
+  };
+  if (prefix.size() < 10 || prefix[0] != '[' || prefix[3] != ':' || prefix[6] != ':' || prefix[9] != ']')
+  {
+    return kNoTime;
+  }
+  int hours = digits(1);
+  int minutes = digits(4);
+  int seconds = digits(7);
+  if (hours < 0 || hours >= 24 || minutes < 0 || minutes >= 60 || seconds < 0 || seconds >= 60)
+  {
+    return kNoTime;
+  }
+  return hours * 3600 + minutes * 60 + seconds;
+}
+
+// LineTerminatorMask で一度に調べるバイト数
+constexpr size_t kLineBlock = 64;
+
+/**
+ * p から kLineBlock バイトのうち、行末の記号（'\n' か '\r'）の位置のビットを立てたマスク
+ */
+uint64_t LineTerminatorMask(const char *p)
+{
+#if defined(JERRY_SIMD_AVX2)
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i carriageReturn = _mm256_set1_epi8('\r');
+  uint64_t mask = 0;
+  for (size_t i = 0; i < kLineBlock; i += 32)
+  {
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+    __m256i terminators = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, newline), _mm256_cmpeq_epi8(bytes, carriageReturn));
+    mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(terminators))) << i;
+  }
+  return mask;
+#elif defined(JERRY_SIMD_SSE2)
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i carriageReturn = _mm_set1_epi8('\r');
+  uint64_t mask = 0;
+  for (size_t i = 0; i < kLineBlock; i += 16)
+  {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    __m128i terminators = _mm_or_si128(_mm_cmpeq_epi8(bytes, newline), _mm_cmpeq_epi8(bytes, carriageReturn));
+    mask |= static_cast<uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(terminators))) << i;
+  }
+  return mask;
+#elif defined(JERRY_SIMD_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+  // 各バイトの一致を位置ごとのビットにして、隣どうしを足し合わせていく（movemask が無いため）
+  static constexpr uint8_t kBitOfByte[16] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+                                             0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+  const uint8x16_t bitOfByte = vld1q_u8(kBitOfByte);
+  uint8x16_t bits[4];
+  for (size_t i = 0; i < 4; i++)
+  {
+    uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t *>(p + i * 16));
+    uint8x16_t terminators = vorrq_u8(vceqq_u8(bytes, vdupq_n_u8('\n')), vceqq_u8(bytes, vdupq_n_u8('\r')));
+    bits[i] = vandq_u8(terminators, bitOfByte);
+  }
+  uint8x16_t sum = vpaddq_u8(vpaddq_u8(bits[0], bits[1]), vpaddq_u8(bits[2], bits[3]));
+  sum = vpaddq_u8(sum, sum);
+  return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+#else
+  uint64_t mask = 0;
+  for (size_t i = 0; i < kLineBlock; i++)
+  {
+    mask |= static_cast<uint64_t>(IsLineTerminator(p[i])) << i;
+  }
+  return mask;
+#endif
+}
+
+/**
+ * LineTerminatorMask のマスクが示す行末の位置（base からのオフセット）を out に書き出し、その数を返す関数
+ * 1ブロックに行末が4つ以下なら分岐せずに書き出す（余分に書いた分は、次に書き出す位置なので上書きされる）
+ */
+size_t AppendLineEnds(uint64_t mask, uint32_t base, uint32_t *out)
+{
+  size_t count = 0;
+  for (size_t k = 0; k < 4; k++)
+  {
+    out[count] = base + static_cast<uint32_t>(std::countr_zero(mask));
+    count += mask != 0;
+    mask &= mask - 1;
+  }
+  while (mask != 0)
+  {
+    out[count++] = base + static_cast<uint32_t>(std::countr_zero(mask));
+    mask &= mask - 1;
+  }
+  return count;
+}
+
+/**
+ * lineBegin から始まる行のうち、end までに始まる行の時刻で clock を進める関数
+ * 日付をまたぐたびに sink.OnDayRollover を呼ぶ
+ * lineBegin は最後に見た行の次の行の先頭に、lineTime は最後に見た行の時刻になる（行を見なければそのまま）
+ *
+ * 行の長さはまちまちなので、行末を1つずつ探すと分岐の予測が外れ続ける
+ * kClockChunk バイトごとに行末の位置を SIMD で配列へ書き出してから、まとめて時刻を読む
+ */
+void AdvanceClock(std::string_view logContent, size_t &lineBegin, size_t end, LineClock &clock, int32_t &lineTime,
+                  PurchaseSink &sink)
+{
+  constexpr size_t kClockChunk = 1024;
+  size_t size = logContent.size();
+  if (lineBegin > end || lineBegin >= size)
+  {
+    return;
+  }
+
+  auto visit = [&](size_t line) {
+    lineTime = ParseLineTime(logContent, line);
+    if (clock.Advance(lineTime))
+    {
+      sink.OnDayRollover();
+    }
+  };
+  visit(lineBegin);
+
+  // この位置より前の行末の次が、end までに始まる行の先頭
+  const char *data = logContent.data();
+  size_t limit = std::min(end, size - 1);
+  uint32_t lineEnds[kClockChunk + 4];
+  for (size_t chunk = lineBegin; chunk < limit; chunk += kClockChunk)
+  {
+    size_t chunkEnd = std::min(limit, chunk + kClockChunk);
+    size_t count = 0;
+    size_t i = chunk;
+    for (; i + kLineBlock <= chunkEnd; i += kLineBlock)
+    {
+      count += AppendLineEnds(LineTerminatorMask(data + i), static_cast<uint32_t>(i - chunk), lineEnds + count);
+    }
+    for (; i < chunkEnd; i++)
+    {
+      lineEnds[count] = static_cast<uint32_t>(i - chunk);
+      count += IsLineTerminator(data[i]);
+    }
+    for (size_t k = 0; k < count; k++)
+    {
+      visit(chunk + lineEnds[k] + 1);
+    }
+  }
+
+  // 最後に見た行の行末の次へ進める
+  size_t lineEnd = limit;
+  while (lineEnd < size && !IsLineTerminator(data[lineEnd]))
+  {
+    lineEnd++;
+  }
+  lineBegin = std::min(lineEnd + 1, size);
+}
+
+} // namespace
+
+size_t FindSubstring(std::string_view haystack, std::string_view needle, size_t pos)
+{
+  if (needle.empty() || pos > haystack.size() || haystack.size() - pos < needle.size())
+  {
+    return needle.empty() && pos <= haystack.size() ? pos : std::string_view::npos;
+  }
+
+  // 末尾の空白はログ中に頻出するので、最後の非空白文字を2つ目の照合位置にする
+  size_t probe = needle.find_last_not_of(' ');
+  if (probe == std::string_view::npos || probe == 0)
+  {
+    probe = needle.size() - 1;
+  }
+
+  const char *data = haystack.data();
+  size_t i = pos;
+  // この位置までは probe 側のロードがバッファ内に収まる
+  size_t last = haystack.size() - needle.size();
+
+  auto candidateAt = [&](size_t at) { return std::memcmp(data + at, needle.data(), needle.size()) == 0; };
+
+#if defined(JERRY_SIMD_AVX2)
+  const __m256i first = _mm256_set1_epi8(needle[0]);
+  const __m256i second = _mm256_set1_epi8(needle[probe]);
+  for (; i + 32 <= last + 1; i += 32)
+  {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + probe));
+    unsigned mask = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, second))));
+    while (mask != 0)
+    {
+      size_t at = i + std::countr_zero(mask);
+      if (candidateAt(at))
+      {
+        return at;
+      }
+      mask &= mask - 1;
+    }
+  }
+#elif defined(JERRY_SIMD_SSE2)
+  const __m128i first = _mm_set1_epi8(needle[0]);
+  const __m128i second = _mm_set1_epi8(needle[probe]);
+  for (; i + 16 <= last + 1; i += 16)
+  {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + probe));
+    unsigned mask =
+        static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, second))));
+    while (mask != 0)
+    {
+      size_t at = i + std::countr_zero(mask);
+      if (candidateAt(at))
+      {
+        return at;
+      }
+      mask &= mask - 1;
+    }
+  }
+#elif defined(JERRY_SIMD_NEON)
+  const uint8x16_t first = vdupq_n_u8(static_cast<uint8_t>(needle[0]));
+  const uint8x16_t second = vdupq_n_u8(static_cast<uint8_t>(needle[probe]));
+  for (; i + 16 <= last + 1; i += 16)
+  {
+    uint8x16_t a = vld1q_u8(reinterpret_cast<const uint8_t *>(data + i));
+    uint8x16_t b = vld1q_u8(reinterpret_cast<const uint8_t *>(data + i + probe));
+    uint8x16_t eq = vandq_u8(vceqq_u8(a, first), vceqq_u8(b, second));
+    // 1バイトあたり4ビットのマスクに縮める
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    while (mask != 0)
+    {
+      size_t at = i + std::countr_zero(mask) / 4;
+      if (candidateAt(at))
+      {
+        return at;
+      }
+      mask &= ~(uint64_t{0xF} << (std::countr_zero(mask) & ~3));
+    }
+  }
+#endif
+
+  for (; i <= last; i++)
+  {
+    if (data[i] == needle[0] && data[i + probe] == needle[probe] && candidateAt(i))
+    {
+      return i;
+    }
+  }
+  return std::string_view::npos;
+}
+
+bool FindCandidateLine(std::string_view logContent, size_t &pos, std::string_view &line)
+{
+  while ((pos = FindSubstring(logContent, kPurchaseAnchor, pos)) != std::string_view::npos)
+  {
+    size_t lineBegin = pos + kPurchaseAnchor.size();
+    size_t lineEnd = lineBegin;
+    while (lineEnd < logContent.size() && !IsLineTerminator(logContent[lineEnd]))
+    {
+      lineEnd++;
+    }
+
+    line = logContent.substr(lineBegin, lineEnd - lineBegin);
+    return true;
+  }
+  return false;
+}
+
+void ScanPurchases(std::string_view logContent, const ItemCatalog &catalog, PurchaseSink &sink)
+{
+  LineClock clock;
+  ScanPurchases(logContent, catalog, sink, clock);
+}
+
+void ScanPurchases(std::string_view logContent, const ItemCatalog &catalog, PurchaseSink &sink, LineClock &clock)
+{
+  size_t pos = 0;
+  // まだ時刻を見ていない最初の行の先頭と、最後に見た行の時刻
+  size_t clockLine = 0;
+  int32_t lineTime = kNoTime;
+  std::string_view line;
+  while (FindCandidateLine(logContent, pos, line))
+  {
+    size_t lineBegin = pos + kPurchaseAnchor.size();
+
+    PurchaseMatch match;
+    if (!MatchPurchaseLine(line, catalog, match))
+    {
+      // 同じ行の後ろにあるアンカーも必ず失敗するので次の行へ進む
+      pos = lineBegin + line.size();
+      continue;
+    }
+    // 購入の行までのすべての行の時刻で、日付の変わり目を数える
+    AdvanceClock(logContent, clockLine, pos, clock, lineTime, sink);
+    int32_t time = lineTime == kNoTime ? kNoTime : clock.rollovers * kSecondsPerDay + lineTime;
+    pos = lineBegin + match.end;
+
+    long long cost = 0;
+    if (!ParseCost(match.cost, cost))
+    {
+      sink.OnInvalidCost(match.cost);
+    }
+
+    // Recombobulated ならレアリティが1つ上がっている
+    char rarity = catalog.RecombobulatedRarity(match.tier);
+    bool recombobulated = rarity != 0 && match.rarity == rarity;
+
+    sink.OnPurchase({static_cast<uint8_t>(match.tier), recombobulated, cost, time});
+  }
+  AdvanceClock(logContent, clockLine, logContent.size(), clock, lineTime, sink);
+}
+
+void ExtractPurchases(std::string_view logContent, const ItemCatalog &catalog, PurchaseColumns &purchases)
+{
+  PurchaseColumnsSink sink(purchases);
+  ScanPurchases(logContent, catalog, sink);
+}
+
+void ExtractPurchases(std::string_view logContent, const ItemCatalog &catalog, PurchaseColumns &purchases,
+                      LineClock &clock)
+{
+  PurchaseColumnsSink sink(purchases);
+  ScanPurchases(logContent, catalog, sink, clock);
+}
+
+PurchaseColumns ExtractPurchases(std::string_view logContent, const ItemCatalog &catalog)
+{
+  PurchaseColumns purchases;
+  ExtractPurchases(logContent, catalog, purchases);
+  return purchases;
+}
+
+void PurchaseStreamScanner::Commit(size_t size)
+{
+  used_ += size;
+
+  size_t lineEnd = used_;
+  while (lineEnd > 0 && !IsLineTerminator(buffer_[lineEnd - 1]))
+  {
+    lineEnd--;
+  }
+
+  if (lineEnd == 0)
+  {
+    // バッファより長い行は、行末が来るまでバッファを広げて持ち越す
+    if (used_ == buffer_.size())
+    {
+      buffer_.resize(buffer_.size() * 2);
+    }
+    return;
+  }
+
+  Scan(std::string_view(buffer_.data(), lineEnd));
+  std::memmove(buffer_.data(), buffer_.data() + lineEnd, used_ - lineEnd);
+  used_ -= lineEnd;
+}
+
+void PurchaseStreamScanner::Feed(std::string_view data)
+{
+  // 持ち越している行があれば、その行末まではバッファ経由で走査する
+  while (used_ > 0 && !data.empty())
+  {
+    size_t lineEnd = 0;
+    while (lineEnd < data.size() && !IsLineTerminator(data[lineEnd]))
+    {
+      lineEnd++;
+    }
+    size_t size = std::min({lineEnd < data.size() ? lineEnd + 1 : lineEnd, data.size(), WritableSize()});
+    CopyAndCommit(data.substr(0, size));
+    data.remove_prefix(size);
+  }
+
+  size_t lineEnd = data.size();
+  while (lineEnd > 0 && !IsLineTerminator(data[lineEnd - 1]))
+  {
+    lineEnd--;
+  }
+  Scan(data.substr(0, lineEnd));
+  data.remove_prefix(lineEnd);
+
+  while (!data.empty())
+  {
+    size_t size = std::min(data.size(), WritableSize());
+    CopyAndCommit(data.substr(0, size));
+    data.remove_prefix(size);
+  }
+}
+
+void PurchaseStreamScanner::Finish()
+{
+  Scan(std::string_view(buffer_.data(), used_));
+  used_ = 0;
+}
+
+void PurchaseStreamScanner::CopyAndCommit(std::string_view data)
+{
+  std::memcpy(WritePointer(), data.data(), data.size());
+  Commit(data.size());
+}
+
+void PurchaseStreamScanner::Scan(std::string_view text)
+{
+  if (text.empty())
+  {
+    return;
+  }
+
+  {
+    StageTimer timer(stats_, Stage::SCAN);
+    if (sink_)
+    {
+      ScanPurchases(text, *catalog_, *sink_, clock_);
+    }
+    else
+    {
+      ExtractPurchases(text, *catalog_, purchases_, clock_);
+    }
+  }
+  if (stats_)
+  {
+    stats_->bytesOut += text.size();
+    stats_->lines += CountLines(text);
+  }
+}
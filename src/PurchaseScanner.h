@@ -0,0 +1,274 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "ItemCatalog.h"
+#include "Purchase.h"
+#include "Stats.h"
+
+inline bool IsLineTerminator(char c)
+{
+  return c == '\n' || c == '\r';
+}
+
+/**
+ * 文字列を高速に検索する関数（見つからなければ npos）
+ * 先頭と末尾（空白以外）の2バイトをSIMDで一括比較し、両方一致した位置だけを memcmp で確認する
+ */
+size_t FindSubstring(std::string_view haystack, std::string_view needle, size_t pos = 0);
+
+/**
+ * 購入メッセージの候補行を探す前段フィルタ
+ * "You purchased " を含む行を返す（品目名は品目表の照合器で調べる）
+ * 見つかった場合、pos はアンカーの位置、line はアンカー直後から行末までになる
+ */
+bool FindCandidateLine(std::string_view logContent, size_t &pos, std::string_view &line);
+
+/**
+ * 見つかった購入データを受け取るインターフェース
+ */
+class PurchaseSink
+{
+public:
+  virtual ~PurchaseSink() = default;
+
+  virtual void OnPurchase(const TalismanPurchase &purchase) = 0;
+
+  /**
+   * コストが読めなかったときに、その購入を 0 コインとして OnPurchase に渡す前に呼ばれる（引数はコストの部分の文字列）
+   * ライブラリは何も表示しないので、知らせるかどうかは呼び出し側で決める
+   */
+  virtual void OnInvalidCost(std::string_view /* cost */)
+  {
+  }
+
+  /**
+   * 行頭の時刻が戻った（日付をまたいだ）ときに呼ばれる（購入の無い行でも呼ばれる）
+   */
+  virtual void OnDayRollover()
+  {
+  }
+};
+
+/**
+ * 購入データを purchases の末尾に追加する Sink
+ */
+class PurchaseColumnsSink : public PurchaseSink
+{
+public:
+  explicit PurchaseColumnsSink(PurchaseColumns &purchases) : purchases_(purchases)
+  {
+  }
+
+  void OnPurchase(const TalismanPurchase &purchase) override
+  {
+    purchases_.Add(purchase);
+  }
+
+  void OnInvalidCost(std::string_view) override
+  {
+    purchases_.AddInvalidCost();
+  }
+
+  void OnDayRollover() override
+  {
+    purchases_.AddDayRollover();
+  }
+
+private:
+  PurchaseColumns &purchases_;
+};
+
+/**
+ * 購入データを PurchaseSummary に直接集計する Sink
+ */
+class PurchaseSummarySink : public PurchaseSink
+{
+public:
+  explicit PurchaseSummarySink(PurchaseSummary &summary) : summary_(summary)
+  {
+  }
+
+  void OnPurchase(const TalismanPurchase &purchase) override
+  {
+    summary_.Add(purchase);
+  }
+
+private:
+  PurchaseSummary &summary_;
+};
+
+/**
+ * catalog の品目の購入ログを走査し、見つかった順に sink へ渡す関数
+ * 途中でメモリを確保しないので、大量のログを続けて処理する場合はこれを使う
+ */
+void ScanPurchases(std::string_view logContent, const ItemCatalog &catalog, PurchaseSink &sink);
+
+/**
+ * 同じログの続きを少しずつ走査する ScanPurchases（logContent は行の先頭から始まること）
+ * 購入の時刻は clock の日付をまたいだ回数を含めたものになり、走査した行の時刻で clock を進める
+ */
+void ScanPurchases(std::string_view logContent, const ItemCatalog &catalog, PurchaseSink &sink, LineClock &clock);
+
+/**
+ * catalog の品目の購入ログを抽出し、purchases の末尾に追加する関数
+ */
+void ExtractPurchases(std::string_view logContent, const ItemCatalog &catalog, PurchaseColumns &purchases);
+
+void ExtractPurchases(std::string_view logContent, const ItemCatalog &catalog, PurchaseColumns &purchases,
+                      LineClock &clock);
+
+/**
+ * catalog の品目の購入ログを抽出する関数
+ */
+PurchaseColumns ExtractPurchases(std::string_view logContent, const ItemCatalog &catalog);
+
+/**
+ * 既定の品目表（Jerry Talisman）で走査する関数
+ */
+inline void ScanJerryPurchases(std::string_view logContent, PurchaseSink &sink)
+{
+  ScanPurchases(logContent, ItemCatalog::Jerry(), sink);
+}
+
+inline void ExtractJerryPurchases(std::string_view logContent, PurchaseColumns &purchases)
+{
+  ExtractPurchases(logContent, ItemCatalog::Jerry(), purchases);
+}
+
+inline PurchaseColumns ExtractJerryPurchases(std::string_view logContent)
+{
+  return ExtractPurchases(logContent, ItemCatalog::Jerry());
+}
+
+// 抽出の規則（コストの読み方など）の版
+// 同じログから違う結果になる変更をしたら上げ、古い規則で保存したキャッシュと latest.log の状態を使わないようにする
+constexpr uint32_t kPurchaseParserVersion = 2;
+
+// ストリーミング走査で使うバッファのサイズ
+constexpr size_t kStreamBufferSize = 256 * 1024;
+
+/**
+ * ログを固定長のバッファで少しずつ走査するクラス
+ * バッファの末尾で途切れた行は次のチャンクの先頭へ持ち越すので、ファイル全体を一度に読み込んだ場合と同じ結果になる
+ * 品目表は SetCatalog で変えるまで既定の表（ItemCatalog::Jerry）を使う
+ */
+class PurchaseStreamScanner
+{
+public:
+  explicit PurchaseStreamScanner(size_t bufferSize = kStreamBufferSize) : buffer_(bufferSize)
+  {
+  }
+
+  /**
+   * 見つかった購入データを Purchases() に溜めずに sink へ渡す走査器
+   */
+  explicit PurchaseStreamScanner(PurchaseSink &sink, size_t bufferSize = kStreamBufferSize)
+      : buffer_(bufferSize), sink_(&sink)
+  {
+  }
+
+  /**
+   * 次のデータを書き込める領域
+   */
+  char *WritePointer()
+  {
+    return buffer_.data() + used_;
+  }
+
+  size_t WritableSize() const
+  {
+    return buffer_.size() - used_;
+  }
+
+  /**
+   * WritePointer() に書き込んだ size バイトを確定し、完結した行を走査する
+   */
+  void Commit(size_t size);
+
+  /**
+   * 任意の長さのデータを走査する
+   * 完結している行はコピーせずにそのまま走査し、持ち越しが必要な部分だけをバッファへコピーする
+   */
+  void Feed(std::string_view data);
+
+  /**
+   * 持ち越している最後の行を走査する
+   */
+  void Finish();
+
+  /**
+   * 行末が来ていないため持ち越している部分
+   */
+  std::string_view Pending() const
+  {
+    return std::string_view(buffer_.data(), used_);
+  }
+
+  /**
+   * 見つかった購入データ（sink を渡した場合は常に空）
+   */
+  PurchaseColumns &Purchases()
+  {
+    return purchases_;
+  }
+
+  /**
+   * 持ち越しと見つかった購入データを捨て、次のファイルの走査に使い回せる状態にする
+   * 確保済みのバッファはそのまま使うので、ファイルごとにメモリを確保し直さずに済む（品目表もそのまま）
+   */
+  void Reset(PurchaseSink *sink = nullptr)
+  {
+    used_ = 0;
+    purchases_.Clear();
+    clock_ = LineClock();
+    sink_ = sink;
+    stats_ = nullptr;
+  }
+
+  /**
+   * ここまでに走査した行の時刻（持ち越している行は含まない）
+   */
+  const LineClock &Clock() const
+  {
+    return clock_;
+  }
+
+  /**
+   * 前に途中まで走査したログの続きを走査するときに、その時点の時刻から始める
+   */
+  void SetClock(const LineClock &clock)
+  {
+    clock_ = clock;
+  }
+
+  /**
+   * 以降の走査の時間・バイト数・行数を stats に加える（nullptr なら計測しない）
+   */
+  void SetStats(FileStats *stats)
+  {
+    stats_ = stats;
+  }
+
+  /**
+   * 以降の走査で探す品目の表（走査が終わるまで catalog を残しておくこと）
+   */
+  void SetCatalog(const ItemCatalog &catalog)
+  {
+    catalog_ = &catalog;
+  }
+
+private:
+  void CopyAndCommit(std::string_view data);
+  void Scan(std::string_view text);
+
+  std::vector<char> buffer_;
+  size_t used_ = 0;
+  PurchaseColumns purchases_;
+  LineClock clock_;
+  PurchaseSink *sink_ = nullptr;
+  FileStats *stats_ = nullptr;
+  const ItemCatalog *catalog_ = &ItemCatalog::Jerry();
+};
@@ -0,0 +1,961 @@
+#include "PurchaseServer.h"
+
+// winsock2.h は windows.h より先に読み込む必要がある
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "Format.h"
+#include "LogFile.h"
+#include "PurchaseScanner.h"
+#include "TextUtil.h"
+#include "XxHash.h"
+
+namespace
+{
+
+#ifdef _WIN32
+using Socket = SOCKET;
+using PollDescriptor = WSAPOLLFD;
+constexpr Socket kInvalidSocket = INVALID_SOCKET;
+
+void CloseSocket(Socket socket)
+{
+  closesocket(socket);
+}
+
+bool SetNonBlocking(Socket socket)
+{
+  u_long mode = 1;
+  return ioctlsocket(socket, FIONBIO, &mode) == 0;
+}
+
+bool WouldBlock()
+{
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+int PollSockets(std::vector<PollDescriptor> &descriptors, int timeoutMilliseconds)
+{
+  return WSAPoll(descriptors.data(), static_cast<ULONG>(descriptors.size()), timeoutMilliseconds);
+}
+#else
+using Socket = int;
+using PollDescriptor = pollfd;
+constexpr Socket kInvalidSocket = -1;
+
+void CloseSocket(Socket socket)
+{
+  close(socket);
+}
+
+bool SetNonBlocking(Socket socket)
+{
+  int flags = fcntl(socket, F_GETFL, 0);
+  return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool WouldBlock()
+{
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+int PollSockets(std::vector<PollDescriptor> &descriptors, int timeoutMilliseconds)
+{
+  return poll(descriptors.data(), static_cast<nfds_t>(descriptors.size()), timeoutMilliseconds);
+}
+#endif
+
+// 切断された相手に送っても SIGPIPE で落ちないようにする
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+// リクエスト行とヘッダーの合計の上限
+constexpr size_t kMaxHeaderSize = 16 * 1024;
+// 1回の recv で読むサイズ（1つの接続がイベントループを占有しないよう、1回の通知で1回だけ読む）
+constexpr size_t kReceiveSize = 64 * 1024;
+// 同時に受け付ける接続の上限（超えた分は OS の待ち行列に残し、空きができてから受け付ける）
+constexpr size_t kMaxConnections = 256;
+// この間に送受信の進まない接続は切る
+constexpr std::chrono::seconds kIdleTimeout{60};
+// 未送信の応答がこれを超えたら、相手が受け取るまで次のリクエストを読まない
+constexpr size_t kOutputHighWater = 1024 * 1024;
+
+/**
+ * アップロードされた本文を届いた分から展開・走査し、展開後の内容のハッシュを求めるクラス
+ * 先頭2バイトが gzip のマジックナンバーなら .log.gz、そうでなければ .log として扱う
+ */
+class UploadDecoder
+{
+public:
+  explicit UploadDecoder(const ItemCatalog &catalog) : sink_(summary_), scanner_(sink_)
+  {
+    scanner_.SetCatalog(catalog);
+  }
+
+  void Feed(std::string_view data)
+  {
+    bytes_ += data.size();
+    if (!gzip_)
+    {
+      // マジックナンバーが2つのチャンクに分かれて届いても判定できるよう、先頭2バイトだけは溜める
+      if (head_.size() < 2)
+      {
+        size_t take = std::min(data.size(), 2 - head_.size());
+        head_.append(data.substr(0, take));
+        data.remove_prefix(take);
+        if (head_.size() < 2)
+        {
+          return;
+        }
+        gzip_ = HasGzipMagic(head_);
+        Decode(head_);
+      }
+    }
+    Decode(data);
+  }
+
+  /**
+   * 本文の終わり
+   */
+  void Finish()
+  {
+    // 2バイトに満たない本文
+    if (!gzip_)
+    {
+      gzip_ = false;
+      Decode(head_);
+    }
+    scanner_.Finish();
+  }
+
+  const PurchaseSummary &Summary() const
+  {
+    return summary_;
+  }
+
+  uint64_t ContentHash() const
+  {
+    return hash_.Digest();
+  }
+
+  uint64_t Bytes() const
+  {
+    return bytes_;
+  }
+
+  /**
+   * Finish の後で、本文が展開できなかった理由（できていれば nullopt）
+   */
+  std::optional<std::string_view> Error() const
+  {
+    if (!*gzip_)
+    {
+      return std::nullopt;
+    }
+    if (reader_.Failed())
+    {
+      return "the gzip data is corrupt";
+    }
+    if (!reader_.Complete())
+    {
+      return "the gzip data is truncated";
+    }
+    return std::nullopt;
+  }
+
+private:
+  void Decode(std::string_view data)
+  {
+    if (!*gzip_)
+    {
+      hash_.Update(data.data(), data.size());
+      scanner_.Feed(data);
+      return;
+    }
+
+    reader_.Feed(data);
+    size_t readBytes;
+    while ((readBytes = reader_.Read(scanner_.WritePointer(), scanner_.WritableSize())) > 0)
+    {
+      hash_.Update(scanner_.WritePointer(), readBytes);
+      scanner_.Commit(readBytes);
+    }
+  }
+
+  PurchaseSummary summary_;
+  PurchaseSummarySink sink_;
+  PurchaseStreamScanner scanner_;
+  GzipReader reader_;
+  XxHash64Stream hash_;
+  std::string head_;
+  std::optional<bool> gzip_;
+  uint64_t bytes_ = 0;
+};
+
+/**
+ * 接続1つ分の状態
+ * リクエストの解析は届いたデータの分だけ進め、続きは次の通知で再開する
+ */
+struct Connection
+{
+  enum class State
+  {
+    HEADERS,
+    BODY,
+    CHUNK_SIZE,
+    CHUNK_DATA,
+    CHUNK_END,
+    TRAILER,
+    CLOSING
+  };
+
+  Socket socket = kInvalidSocket;
+  State state = State::HEADERS;
+  std::string input;
+  size_t inputUsed = 0;
+  std::string output;
+  size_t outputSent = 0;
+  bool closed = false;
+  // 最後に送受信が進んだ時刻
+  std::chrono::steady_clock::time_point lastActive = std::chrono::steady_clock::now();
+
+  size_t PendingOutput() const
+  {
+    return output.size() - outputSent;
+  }
+
+  /**
+   * 未送信の応答が多すぎて、次のリクエストを読むのを待っているか
+   */
+  bool OutputBlocked() const
+  {
+    return PendingOutput() >= kOutputHighWater;
+  }
+
+  // 解析中のリクエスト
+  std::string method;
+  std::string path;
+  std::string query;
+  bool keepAlive = true;
+  uint64_t bodyRemaining = 0;
+  std::unique_ptr<UploadDecoder> upload;
+  std::string user;
+};
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b)
+{
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+           return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+         });
+}
+
+/**
+ * URL のクエリの値（%XX と + を戻す）
+ */
+std::string UrlDecode(std::string_view text)
+{
+  std::string decoded;
+  for (size_t i = 0; i < text.size(); i++)
+  {
+    unsigned value = 0;
+    if (text[i] == '%' && i + 2 < text.size() &&
+        std::from_chars(text.data() + i + 1, text.data() + i + 3, value, 16).ptr == text.data() + i + 3)
+    {
+      decoded += static_cast<char>(value);
+      i += 2;
+    }
+    else
+    {
+      decoded += text[i] == '+' ? ' ' : text[i];
+    }
+  }
+  return decoded;
+}
+
+/**
+ * クエリから name の値を取り出す関数（無ければ nullopt）
+ */
+std::optional<std::string> QueryValue(std::string_view query, std::string_view name)
+{
+  while (!query.empty())
+  {
+    size_t end = query.find('&');
+    std::string_view pair = query.substr(0, end);
+    size_t equals = pair.find('=');
+    if (pair.substr(0, equals) == name)
+    {
+      return equals == std::string_view::npos ? std::string() : UrlDecode(pair.substr(equals + 1));
+    }
+    query = end == std::string_view::npos ? std::string_view() : query.substr(end + 1);
+  }
+  return std::nullopt;
+}
+
+std::string SummaryJson(const PurchaseSummary &summary, const ItemCatalog &catalog, long long recombobulatorPrice)
+{
+  std::string json = "{\"totalCost\":" + std::to_string(summary.TotalCost());
+  json += ",\"recombobulatorPrice\":" + std::to_string(recombobulatorPrice);
+  json += ",\"families\":[";
+  for (size_t i = 0; i < catalog.Families().size(); i++)
+  {
+    const ItemFamily &family = catalog.Families()[i];
+    json += i > 0 ? ",{\"name\":" : "{\"name\":";
+    AppendJsonString(json, family.name);
+    json += ",\"totalCost\":" + std::to_string(family.TotalCost(summary));
+    json += ",\"tiers\":[";
+    for (size_t tier = 0; tier < family.tiers.size(); tier++)
+    {
+      json += tier > 0 ? ",{\"name\":" : "{\"name\":";
+      AppendJsonString(json, family.tiers[tier].name);
+      json += ",\"count\":" + std::to_string(family.Count(summary, tier, false)) +
+              ",\"recombobulated\":" + std::to_string(family.Count(summary, tier, true)) + '}';
+    }
+    json += "],\"baseEquivalent\":" + std::to_string(family.BaseEquivalent(summary));
+    json += ",\"costWithoutRecombobulators\":" +
+            std::to_string(family.CostWithoutRecombobulators(summary, recombobulatorPrice));
+    json += ",\"pricePerBase\":" + std::to_string(family.PricePerBase(summary, recombobulatorPrice)) + '}';
+  }
+  json += "]}";
+  return json;
+}
+
+std::string_view StatusText(int status)
+{
+  switch (status)
+  {
+  case 200:
+    return "OK";
+  case 400:
+    return "Bad Request";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 431:
+    return "Request Header Fields Too Large";
+  }
+  return "Error";
+}
+
+void Respond(Connection &connection, int status, std::string_view body)
+{
+  connection.output += "HTTP/1.1 " + std::to_string(status) + ' ' + std::string(StatusText(status)) +
+                       "\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body.size() + 1) +
+                       (connection.keepAlive ? "\r\n\r\n" : "\r\nConnection: close\r\n\r\n");
+  connection.output += body;
+  connection.output += '\n';
+}
+
+std::string ErrorJson(std::string_view message)
+{
+  std::string json = "{\"error\":";
+  AppendJsonString(json, message);
+  json += '}';
+  return json;
+}
+
+/**
+ * 解析とルーティングを行うサーバーの状態
+ */
+class Server
+{
+public:
+  Server(const ItemCatalog &catalog, long long recombobulatorPrice, PurchaseAggregates &aggregates,
+         const PurchaseServerEvents &events)
+      : catalog_(catalog), recombobulatorPrice_(recombobulatorPrice), aggregates_(aggregates), events_(events)
+  {
+  }
+
+  /**
+   * 届いているデータで進められるところまでリクエストを処理する
+   */
+  void Process(Connection &connection)
+  {
+    // パイプラインで届いたリクエストでも、応答が溜まりすぎたらそこで止める（続きは送れてから再開する）
+    while (connection.state != Connection::State::CLOSING && !connection.OutputBlocked() && ProcessStep(connection))
+    {
+    }
+    // 処理済みの入力を捨てる
+    connection.input.erase(0, connection.inputUsed);
+    connection.inputUsed = 0;
+  }
+
+private:
+  std::string_view Unread(const Connection &connection) const
+  {
+    return std::string_view(connection.input).substr(connection.inputUsed);
+  }
+
+  /**
+   * 1段階進める（データが足りなければ false）
+   */
+  bool ProcessStep(Connection &connection)
+  {
+    std::string_view unread = Unread(connection);
+    switch (connection.state)
+    {
+    case Connection::State::HEADERS: {
+      size_t end = unread.find("\r\n\r\n");
+      if (end == std::string_view::npos)
+      {
+        if (unread.size() > kMaxHeaderSize)
+        {
+          Fail(connection, 431, "request headers too large");
+        }
+        return false;
+      }
+      connection.inputUsed += end + 4;
+      return ParseHeaders(connection, unread.substr(0, end + 2));
+    }
+    case Connection::State::BODY: {
+      size_t size = static_cast<size_t>(std::min<uint64_t>(connection.bodyRemaining, unread.size()));
+      if (size == 0)
+      {
+        return false;
+      }
+      ConsumeBody(connection, unread.substr(0, size));
+      connection.inputUsed += size;
+      connection.bodyRemaining -= size;
+      if (connection.bodyRemaining == 0)
+      {
+        CompleteRequest(connection);
+      }
+      return true;
+    }
+    case Connection::State::CHUNK_SIZE: {
+      size_t end = unread.find("\r\n");
+      if (end == std::string_view::npos)
+      {
+        if (unread.size() > kMaxHeaderSize)
+        {
+          Fail(connection, 400, "invalid chunk size");
+        }
+        return false;
+      }
+      // チャンク拡張（";" 以降）は無視する
+      std::string_view line = Trim(unread.substr(0, std::min(end, unread.find(';'))));
+      uint64_t size;
+      auto [ptr, ec] = std::from_chars(line.data(), line.data() + line.size(), size, 16);
+      if (line.empty() || ec != std::errc{} || ptr != line.data() + line.size())
+      {
+        Fail(connection, 400, "invalid chunk size");
+        return false;
+      }
+      connection.inputUsed += end + 2;
+      connection.bodyRemaining = size;
+      connection.state = size == 0 ? Connection::State::TRAILER : Connection::State::CHUNK_DATA;
+      return true;
+    }
+    case Connection::State::CHUNK_DATA: {
+      size_t size = static_cast<size_t>(std::min<uint64_t>(connection.bodyRemaining, unread.size()));
+      if (size == 0)
+      {
+        return false;
+      }
+      ConsumeBody(connection, unread.substr(0, size));
+      connection.inputUsed += size;
+      connection.bodyRemaining -= size;
+      if (connection.bodyRemaining == 0)
+      {
+        connection.state = Connection::State::CHUNK_END;
+      }
+      return true;
+    }
+    case Connection::State::CHUNK_END: {
+      if (unread.size() < 2)
+      {
+        return false;
+      }
+      if (unread.substr(0, 2) != "\r\n")
+      {
+        Fail(connection, 400, "invalid chunk");
+        return false;
+      }
+      connection.inputUsed += 2;
+      connection.state = Connection::State::CHUNK_SIZE;
+      return true;
+    }
+    case Connection::State::TRAILER: {
+      size_t end = unread.find("\r\n");
+      if (end == std::string_view::npos)
+      {
+        return false;
+      }
+      connection.inputUsed += end + 2;
+      // 空行でトレーラーが終わる
+      if (end == 0)
+      {
+        CompleteRequest(connection);
+      }
+      return true;
+    }
+    case Connection::State::CLOSING:
+      break;
+    }
+    return false;
+  }
+
+  bool ParseHeaders(Connection &connection, std::string_view headers)
+  {
+    size_t lineEnd = headers.find("\r\n");
+    std::string_view requestLine = headers.substr(0, lineEnd);
+    headers.remove_prefix(lineEnd + 2);
+
+    // "METHOD /path?query HTTP/1.x"
+    size_t methodEnd = requestLine.find(' ');
+    size_t targetEnd = methodEnd == std::string_view::npos ? methodEnd : requestLine.find(' ', methodEnd + 1);
+    if (targetEnd == std::string_view::npos)
+    {
+      Fail(connection, 400, "invalid request line");
+      return false;
+    }
+    std::string_view target = requestLine.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    std::string_view version = requestLine.substr(targetEnd + 1);
+    size_t queryPos = target.find('?');
+    connection.method = requestLine.substr(0, methodEnd);
+    connection.path = target.substr(0, queryPos);
+    connection.query = queryPos == std::string_view::npos ? std::string_view() : target.substr(queryPos + 1);
+    connection.keepAlive = version == "HTTP/1.1";
+
+    bool chunked = false;
+    bool expectContinue = false;
+    connection.bodyRemaining = 0;
+    while (!headers.empty())
+    {
+      lineEnd = headers.find("\r\n");
+      std::string_view line = headers.substr(0, lineEnd);
+      headers.remove_prefix(std::min(headers.size(), lineEnd + 2));
+
+      size_t colon = line.find(':');
+      if (colon == std::string_view::npos)
+      {
+        continue;
+      }
+      std::string_view name = Trim(line.substr(0, colon));
+      std::string_view value = Trim(line.substr(colon + 1));
+      if (EqualsIgnoreCase(name, "Content-Length"))
+      {
+        auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), connection.bodyRemaining);
+        if (ec != std::errc{} || ptr != value.data() + value.size())
+        {
+          Fail(connection, 400, "invalid Content-Length");
+          return false;
+        }
+      }
+      else if (EqualsIgnoreCase(name, "Transfer-Encoding"))
+      {
+        chunked = EqualsIgnoreCase(value, "chunked");
+      }
+      else if (EqualsIgnoreCase(name, "Connection"))
+      {
+        if (EqualsIgnoreCase(value, "close"))
+        {
+          connection.keepAlive = false;
+        }
+        else if (EqualsIgnoreCase(value, "keep-alive"))
+        {
+          connection.keepAlive = true;
+        }
+      }
+      else if (EqualsIgnoreCase(name, "Expect"))
+      {
+        expectContinue = EqualsIgnoreCase(value, "100-continue");
+      }
+    }
+
+    if (connection.path == "/upload")
+    {
+      if (connection.method != "POST")
+      {
+        Fail(connection, 405, "use POST to upload a log");
+        return false;
+      }
+      connection.user = QueryValue(connection.query, "user").value_or("");
+      connection.upload = std::make_unique<UploadDecoder>(catalog_);
+      // curl などは大きな本文を送る前に 100 Continue を待つ
+      if (expectContinue)
+      {
+        connection.output += "HTTP/1.1 100 Continue\r\n\r\n";
+      }
+    }
+
+    if (chunked)
+    {
+      connection.state = Connection::State::CHUNK_SIZE;
+    }
+    else if (connection.bodyRemaining > 0)
+    {
+      connection.state = Connection::State::BODY;
+    }
+    else
+    {
+      CompleteRequest(connection);
+    }
+    return true;
+  }
+
+  void ConsumeBody(Connection &connection, std::string_view data)
+  {
+    // アップロード以外のリクエストの本文は読み捨てる
+    if (connection.upload)
+    {
+      connection.upload->Feed(data);
+    }
+  }
+
+  void Fail(Connection &connection, int status, std::string_view message)
+  {
+    connection.keepAlive = false;
+    connection.upload.reset();
+    Respond(connection, status, ErrorJson(message));
+    connection.state = Connection::State::CLOSING;
+  }
+
+  void CompleteRequest(Connection &connection)
+  {
+    if (connection.path == "/upload")
+    {
+      HandleUpload(connection);
+    }
+    else if (connection.path == "/summary")
+    {
+      HandleSummary(connection);
+    }
+    else
+    {
+      Respond(connection, 404, ErrorJson("unknown path"));
+    }
+
+    connection.upload.reset();
+    connection.state = connection.keepAlive ? Connection::State::HEADERS : Connection::State::CLOSING;
+  }
+
+  void HandleUpload(Connection &connection)
+  {
+    UploadDecoder &upload = *connection.upload;
+    upload.Finish();
+    UploadReport report;
+    report.user = connection.user;
+    report.bytes = upload.Bytes();
+    // 展開できなかったログは、途中までの集計もハッシュも残さない
+    if (std::optional<std::string_view> error = upload.Error())
+    {
+      report.error = *error;
+      if (events_.onUpload)
+      {
+        events_.onUpload(report);
+      }
+      Respond(connection, 400, ErrorJson(*error));
+      return;
+    }
+
+    const PurchaseSummary &summary = upload.Summary();
+    bool added = aggregates_.Add(upload.ContentHash(), connection.user, summary);
+
+    long long purchases = 0;
+    for (long long count : summary.counts)
+    {
+      purchases += count;
+    }
+    report.duplicate = !added;
+    report.purchases = purchases;
+    if (events_.onUpload)
+    {
+      events_.onUpload(report);
+    }
+
+    std::string json = "{\"duplicate\":" + std::string(added ? "false" : "true") +
+                       ",\"purchases\":" + std::to_string(purchases) + ",\"bytes\":" + std::to_string(upload.Bytes()) +
+                       '}';
+    Respond(connection, 200, json);
+  }
+
+  void HandleSummary(Connection &connection)
+  {
+    if (connection.method != "GET")
+    {
+      Respond(connection, 405, ErrorJson("use GET to read a summary"));
+      return;
+    }
+
+    long long recombobulatorPrice = recombobulatorPrice_;
+    if (std::optional<std::string> price = QueryValue(connection.query, "recomb"))
+    {
+      auto [ptr, ec] = std::from_chars(price->data(), price->data() + price->size(), recombobulatorPrice);
+      if (ec != std::errc{} || ptr != price->data() + price->size())
+      {
+        Respond(connection, 400, ErrorJson("invalid recomb price"));
+        return;
+      }
+    }
+
+    std::optional<std::string> user = QueryValue(connection.query, "user");
+    if (!user)
+    {
+      std::string json = "{\"uploads\":" + std::to_string(aggregates_.UploadCount()) +
+                         ",\"users\":" + std::to_string(aggregates_.UserCount()) +
+                         ",\"summary\":" + SummaryJson(aggregates_.Global(), catalog_, recombobulatorPrice) + '}';
+      Respond(connection, 200, json);
+      return;
+    }
+
+    const PurchaseSummary *summary = aggregates_.Find(*user);
+    if (!summary)
+    {
+      Respond(connection, 404, ErrorJson("unknown user"));
+      return;
+    }
+    std::string json = "{\"user\":";
+    AppendJsonString(json, *user);
+    json += ",\"summary\":" + SummaryJson(*summary, catalog_, recombobulatorPrice) + '}';
+    Respond(connection, 200, json);
+  }
+
+  const ItemCatalog &catalog_;
+  long long recombobulatorPrice_;
+  PurchaseAggregates &aggregates_;
+  const PurchaseServerEvents &events_;
+};
+
+Socket OpenListener(const std::string &host, uint16_t port)
+{
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  addrinfo *addresses = nullptr;
+  std::string service = std::to_string(port);
+  if (getaddrinfo(host.empty() ? nullptr : host.c_str(), service.c_str(), &hints, &addresses) != 0)
+  {
+    return kInvalidSocket;
+  }
+
+  Socket listener = kInvalidSocket;
+  for (addrinfo *address = addresses; address && listener == kInvalidSocket; address = address->ai_next)
+  {
+    listener = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (listener == kInvalidSocket)
+    {
+      continue;
+    }
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&reuse), sizeof(reuse));
+    if (bind(listener, address->ai_addr, static_cast<int>(address->ai_addrlen)) != 0 ||
+        listen(listener, SOMAXCONN) != 0 || !SetNonBlocking(listener))
+    {
+      CloseSocket(listener);
+      listener = kInvalidSocket;
+    }
+  }
+  freeaddrinfo(addresses);
+  return listener;
+}
+
+void AcceptConnections(Socket listener, std::vector<std::unique_ptr<Connection>> &connections)
+{
+  while (connections.size() < kMaxConnections)
+  {
+    Socket socket = accept(listener, nullptr, nullptr);
+    if (socket == kInvalidSocket)
+    {
+      return;
+    }
+    if (!SetNonBlocking(socket))
+    {
+      CloseSocket(socket);
+      continue;
+    }
+    // 応答は1回の send で書き終えるので、Nagle で遅らせない
+    int noDelay = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&noDelay), sizeof(noDelay));
+
+    auto connection = std::make_unique<Connection>();
+    connection->socket = socket;
+    connections.push_back(std::move(connection));
+  }
+}
+
+void Receive(Server &server, Connection &connection)
+{
+  char buffer[kReceiveSize];
+  auto received = recv(connection.socket, buffer, static_cast<int>(sizeof(buffer)), 0);
+  if (received < 0)
+  {
+    connection.closed = !WouldBlock();
+    return;
+  }
+  if (received == 0)
+  {
+    // 相手が送信を終えた（途中のリクエストは捨てる）
+    connection.closed = true;
+    return;
+  }
+  connection.lastActive = std::chrono::steady_clock::now();
+  connection.input.append(buffer, static_cast<size_t>(received));
+  server.Process(connection);
+}
+
+void Send(Connection &connection)
+{
+  while (connection.outputSent < connection.output.size())
+  {
+    auto sent = send(connection.socket, connection.output.data() + connection.outputSent,
+                     static_cast<int>(connection.output.size() - connection.outputSent), kSendFlags);
+    if (sent < 0)
+    {
+      connection.closed = !WouldBlock();
+      return;
+    }
+    connection.outputSent += static_cast<size_t>(sent);
+    connection.lastActive = std::chrono::steady_clock::now();
+  }
+  connection.output.clear();
+  connection.outputSent = 0;
+  if (connection.state == Connection::State::CLOSING)
+  {
+    connection.closed = true;
+  }
+}
+
+} // namespace
+
+bool PurchaseAggregates::Add(uint64_t contentHash, const std::string &user, const PurchaseSummary &summary)
+{
+  if (!hashes_.insert(contentHash).second)
+  {
+    return false;
+  }
+  global_.Merge(summary);
+  if (!user.empty())
+  {
+    users_[user].Merge(summary);
+  }
+  return true;
+}
+
+const PurchaseSummary *PurchaseAggregates::Find(const std::string &user) const
+{
+  auto it = users_.find(user);
+  return it == users_.end() ? nullptr : &it->second;
+}
+
+bool RunPurchaseServer(const std::string &host, uint16_t port, const ItemCatalog &catalog, long long recombobulatorPrice,
+                       PurchaseAggregates &aggregates, const PurchaseServerEvents &events)
+{
+#ifdef _WIN32
+  WSADATA wsaData;
+  if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+  {
+    return false;
+  }
+#endif
+
+  Socket listener = OpenListener(host, port);
+  if (listener == kInvalidSocket)
+  {
+    return false;
+  }
+  if (events.onListening)
+  {
+    events.onListening(host, port);
+  }
+
+  Server server(catalog, recombobulatorPrice, aggregates, events);
+  std::vector<std::unique_ptr<Connection>> connections;
+  std::vector<PollDescriptor> descriptors;
+  while (true)
+  {
+    descriptors.clear();
+    descriptors.push_back({listener, static_cast<short>(connections.size() < kMaxConnections ? POLLIN : 0), 0});
+    for (const auto &connection : connections)
+    {
+      bool reading = connection->state != Connection::State::CLOSING && !connection->OutputBlocked();
+      short events = reading ? POLLIN : 0;
+      if (!connection->output.empty())
+      {
+        events |= POLLOUT;
+      }
+      descriptors.push_back({connection->socket, events, 0});
+    }
+
+    // 接続があれば、無通信の接続を切るために定期的に起きる
+    if (PollSockets(descriptors, connections.empty() ? -1 : 1000) < 0)
+    {
+      if (WouldBlock())
+      {
+        continue;
+      }
+      CloseSocket(listener);
+      return false;
+    }
+
+    // 新しい接続は次の poll から監視する
+    size_t polledCount = connections.size();
+    for (size_t i = 0; i < polledCount; i++)
+    {
+      Connection &connection = *connections[i];
+      short revents = descriptors[i + 1].revents;
+      if (revents & POLLIN)
+      {
+        Receive(server, connection);
+      }
+      else if (revents & (POLLERR | POLLHUP | POLLNVAL))
+      {
+        connection.closed = true;
+      }
+      // 応答ができたらすぐに送る（書き込めなければ POLLOUT を待つ）
+      if (!connection.closed && !connection.output.empty())
+      {
+        Send(connection);
+      }
+      // 応答が送れて読むのを再開できたら、受信済みのリクエストの続きを処理する
+      if (!connection.closed && !connection.OutputBlocked() && !connection.input.empty())
+      {
+        server.Process(connection);
+        if (!connection.output.empty())
+        {
+          Send(connection);
+        }
+      }
+    }
+    if (descriptors[0].revents & POLLIN)
+    {
+      AcceptConnections(listener, connections);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::erase_if(connections, [&](const std::unique_ptr<Connection> &connection) {
+      if (now - connection->lastActive > kIdleTimeout)
+      {
+        connection->closed = true;
+      }
+      if (connection->closed)
+      {
+        CloseSocket(connection->socket);
+      }
+      return connection->closed;
+    });
+  }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ItemCatalog.h"
+#include "Purchase.h"
+
+/**
+ * アップロードされたログの集計結果をユーザーごとと全体で持つクラス
+ * 同じ内容のログ（展開後の XXH64 が一致するもの）は一度だけ数える
+ */
+class PurchaseAggregates
+{
+public:
+  /**
+   * contentHash のログの集計結果を user と全体に加える（既に受け付けた内容なら何もせずに false）
+   * user が空なら全体にだけ加える
+   */
+  bool Add(uint64_t contentHash, const std::string &user, const PurchaseSummary &summary);
+
+  /**
+   * user の集計結果（アップロードが無ければ nullptr）
+   */
+  const PurchaseSummary *Find(const std::string &user) const;
+
+  const PurchaseSummary &Global() const
+  {
+    return global_;
+  }
+
+  size_t UploadCount() const
+  {
+    return hashes_.size();
+  }
+
+  size_t UserCount() const
+  {
+    return users_.size();
+  }
+
+private:
+  PurchaseSummary global_;
+  std::unordered_map<std::string, PurchaseSummary> users_;
+  std::unordered_set<uint64_t> hashes_;
+};
+
+/**
+ * 1件のアップロードを処理した結果（文字列は通知の呼び出し中だけ有効）
+ */
+struct UploadReport
+{
+  // アップロードした人（指定が無ければ空）
+  std::string_view user;
+  // 受け付けなかった理由（受け付けたなら空）
+  std::string_view error;
+  // 前に受け付けたログと同じ内容だったか
+  bool duplicate = false;
+  long long purchases = 0;
+  // 受け取った本文のバイト数
+  size_t bytes = 0;
+};
+
+/**
+ * サーバーで起きたことの通知先（サーバー自身は何も出力しないので、表示は呼び出し元が行う）
+ * どれも RunPurchaseServer を呼んだスレッドから呼ばれ、空なら呼ばない
+ */
+struct PurchaseServerEvents
+{
+  // 待ち受けを始めたとき（host が空なら全てのアドレス）
+  std::function<void(const std::string &host, uint16_t port)> onListening;
+  // アップロードを処理し終えたとき（受け付けなかったものも含む）
+  std::function<void(const UploadReport &report)> onUpload;
+};
+
+/**
+ * ログのアップロードを HTTP で受け付け、aggregates に集計し続けるサーバー
+ * 1つのスレッドの poll イベントループで全接続を処理し、接続ごとにスレッドは作らない
+ * 本文は届いた分から展開（.gz の場合）・走査するので、ログ全体をメモリに置くことはない
+ *
+ *   POST /upload?user=NAME       本文は .log か .log.gz（Content-Length か chunked）
+ *   GET  /summary[?user=NAME]    集計結果の JSON（recomb=N で Recombobulator の価格を変えられる）
+ *
+ * アップロードは catalog の品目について走査し、JSON には系統ごとの件数と平均価格を並べる
+ * 待ち受けを始められなければ false を返し、始められた場合は戻らない
+ */
+bool RunPurchaseServer(const std::string &host, uint16_t port, const ItemCatalog &catalog, long long recombobulatorPrice,
+                       PurchaseAggregates &aggregates, const PurchaseServerEvents &events);
@@ -0,0 +1,151 @@
+#include "Stats.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+#include "Format.h"
+
+namespace
+{
+
+constexpr std::string_view kStageNames[kStageCount] = {"open", "read", "inflate", "scan", "aggregate"};
+
+double Milliseconds(std::chrono::nanoseconds time)
+{
+  return std::chrono::duration<double, std::milli>(time).count();
+}
+
+double Megabytes(uint64_t bytes)
+{
+  return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+void PrintRow(std::ostream &out, const FileStats &stats, std::chrono::nanoseconds wallTime, std::string_view name)
+{
+  out << std::fixed << std::setprecision(1);
+  for (size_t stage = 0; stage < kStageCount; stage++)
+  {
+    out << std::setw(10) << Milliseconds(stats.stageTime[stage]);
+  }
+  out << std::setw(10) << Milliseconds(wallTime) << std::setw(10) << Megabytes(stats.bytesIn) << std::setw(10)
+      << Megabytes(stats.bytesOut) << std::setw(12) << stats.lines << std::setw(9) << stats.matches << "  " << name
+      << (stats.cached ? " (cached)" : "") << '\n';
+}
+
+} // namespace
+
+std::string_view StageName(Stage stage)
+{
+  return kStageNames[static_cast<size_t>(stage)];
+}
+
+TraceRecorder::TraceRecorder() : epoch_(std::chrono::steady_clock::now())
+{
+}
+
+void TraceRecorder::Record(Stage stage, std::string_view filePath, std::chrono::steady_clock::time_point begin,
+                           std::chrono::steady_clock::time_point end)
+{
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.push_back({stage, std::string(filePath), ThreadIndex(), duration_cast<microseconds>(begin - epoch_).count(),
+                     duration_cast<microseconds>(end - begin).count()});
+}
+
+unsigned TraceRecorder::ThreadIndex()
+{
+  std::thread::id id = std::this_thread::get_id();
+  auto it = std::find_if(threads_.begin(), threads_.end(), [&](const auto &thread) { return thread.first == id; });
+  if (it == threads_.end())
+  {
+    threads_.emplace_back(id, static_cast<unsigned>(threads_.size()));
+    return threads_.back().second;
+  }
+  return it->second;
+}
+
+bool TraceRecorder::Write(const std::string &filePath) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  auto separator = [&] {
+    if (!first)
+    {
+      json += ',';
+    }
+    first = false;
+  };
+
+  for (const auto &thread : threads_)
+  {
+    separator();
+    json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(thread.second) +
+            ",\"args\":{\"name\":\"thread " + std::to_string(thread.second) + "\"}}";
+  }
+
+  for (const auto &event : events_)
+  {
+    separator();
+    json += "{\"name\":";
+    AppendJsonString(json, StageName(event.stage));
+    json += ",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(event.thread) + ",\"ts\":" +
+            std::to_string(event.begin) + ",\"dur\":" + std::to_string(event.duration) + ",\"args\":{\"file\":";
+    AppendJsonString(json, event.filePath);
+    json += "}}";
+  }
+  json += "]}\n";
+
+  std::ofstream file(filePath, std::ios::binary);
+  file.write(json.data(), static_cast<std::streamsize>(json.size()));
+  return static_cast<bool>(file);
+}
+
+uint64_t CountLines(std::string_view text)
+{
+  return static_cast<uint64_t>(std::count(text.begin(), text.end(), '\n'));
+}
+
+void PrintStats(std::ostream &out, const std::vector<FileStats> &stats, std::chrono::nanoseconds wallTime,
+                std::chrono::nanoseconds reportTime)
+{
+  out << "\n=================================== Stats ===================================\n";
+  for (size_t stage = 0; stage < kStageCount; stage++)
+  {
+    out << std::setw(10) << StageName(static_cast<Stage>(stage));
+  }
+  out << std::setw(10) << "wall" << std::setw(10) << "in MB" << std::setw(10) << "out MB" << std::setw(12) << "lines"
+      << std::setw(9) << "matches" << "  file\n";
+  out << "  (times in ms)\n";
+
+  FileStats total;
+  for (const auto &file : stats)
+  {
+    PrintRow(out, file, file.end - file.begin, file.path);
+
+    for (size_t stage = 0; stage < kStageCount; stage++)
+    {
+      total.stageTime[stage] += file.stageTime[stage];
+    }
+    total.bytesIn += file.bytesIn;
+    total.bytesOut += file.bytesOut;
+    total.lines += file.lines;
+    total.matches += file.matches;
+  }
+  out << "-------------------------------------------------------------------------------\n";
+  PrintRow(out, total, wallTime, "total (stage times are summed over threads)");
+
+  double seconds = std::chrono::duration<double>(wallTime).count();
+  if (seconds > 0)
+  {
+    out << std::setprecision(1) << "Throughput: " << Megabytes(total.bytesIn) / seconds << " MB/s in, "
+        << Megabytes(total.bytesOut) / seconds << " MB/s out, " << std::setprecision(0)
+        << static_cast<double>(total.lines) / seconds << " lines/s\n";
+  }
+  out << std::setprecision(1) << "Report: " << Milliseconds(reportTime) << " ms\n";
+  out << std::defaultfloat;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * 処理の段階（--stats で時間を計る単位）
+ */
+enum class Stage
+{
+  OPEN,
+  READ,
+  INFLATE,
+  SCAN,
+  AGGREGATE
+};
+
+constexpr size_t kStageCount = 5;
+
+std::string_view StageName(Stage stage);
+
+/**
+ * 各段階の区間を記録し、Chrome のトレース形式（Perfetto で開ける JSON）で書き出すクラス
+ * 複数のワーカーから同時に記録してよい
+ */
+class TraceRecorder
+{
+public:
+  TraceRecorder();
+
+  void Record(Stage stage, std::string_view filePath, std::chrono::steady_clock::time_point begin,
+              std::chrono::steady_clock::time_point end);
+
+  bool Write(const std::string &filePath) const;
+
+private:
+  struct Event
+  {
+    Stage stage;
+    std::string filePath;
+    unsigned thread;
+    int64_t begin;
+    int64_t duration;
+  };
+
+  // 記録したスレッドに 0 から順に番号を振る
+  unsigned ThreadIndex();
+
+  std::chrono::steady_clock::time_point epoch_;
+  mutable std::mutex mutex_;
+  std::vector<Event> events_;
+  std::vector<std::pair<std::thread::id, unsigned>> threads_;
+};
+
+/**
+ * ファイル1つ分の計測結果
+ * 段階ごとに別のスレッドが書き込むことはあるが、同じ項目に同時に書き込むことはない
+ */
+struct FileStats
+{
+  std::string path;
+  std::array<std::chrono::nanoseconds, kStageCount> stageTime{};
+  std::chrono::steady_clock::time_point begin;
+  std::chrono::steady_clock::time_point end;
+  // ディスクから読んだバイト数
+  uint64_t bytesIn = 0;
+  // 展開後に走査したバイト数
+  uint64_t bytesOut = 0;
+  uint64_t lines = 0;
+  uint64_t matches = 0;
+  // キャッシュの結果を使ったか
+  bool cached = false;
+  // 区間も記録する場合のトレース（nullptr なら時間の合計だけ）
+  TraceRecorder *trace = nullptr;
+};
+
+/**
+ * スコープを抜けるまでの時間を stats の stage に加える（stats が nullptr なら何もしない）
+ */
+class StageTimer
+{
+public:
+  StageTimer(FileStats *stats, Stage stage)
+      : stats_(stats), stage_(stage), begin_(stats ? std::chrono::steady_clock::now()
+                                                   : std::chrono::steady_clock::time_point())
+  {
+  }
+
+  ~StageTimer()
+  {
+    Stop();
+  }
+
+  /**
+   * スコープを抜ける前に計測を終える
+   */
+  void Stop()
+  {
+    if (!stats_)
+    {
+      return;
+    }
+    auto end = std::chrono::steady_clock::now();
+    stats_->stageTime[static_cast<size_t>(stage_)] += end - begin_;
+    if (stats_->trace)
+    {
+      stats_->trace->Record(stage_, stats_->path, begin_, end);
+    }
+    stats_ = nullptr;
+  }
+
+  StageTimer(const StageTimer &) = delete;
+  StageTimer &operator=(const StageTimer &) = delete;
+
+private:
+  FileStats *stats_;
+  Stage stage_;
+  std::chrono::steady_clock::time_point begin_;
+};
+
+/**
+ * 走査した行数を数える関数（--stats のときだけ使うので、本来の走査とは別に数える）
+ */
+uint64_t CountLines(std::string_view text);
+
+/**
+ * ファイルごとと全体の計測結果を表で表示する関数
+ * wallTime は全体の経過時間、reportTime は結果表示に掛かった時間
+ */
+void PrintStats(std::ostream &out, const std::vector<FileStats> &stats, std::chrono::nanoseconds wallTime,
+                std::chrono::nanoseconds reportTime);
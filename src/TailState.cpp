@@ -0,0 +1,156 @@
+#include "TailState.h"
+
+#include <algorithm>
+
+#include "BinaryIO.h"
+#include "LogFile.h"
+#include "PurchaseScanner.h"
+#include "XxHash.h"
+
+bool IsTailTarget(const std::string &filePath)
+{
+  return std::filesystem::path(filePath).filename() == "latest.log";
+}
+
+bool ScanAppended(const std::string &filePath, const ItemCatalog &catalog, TailState &state, bool &changed)
+{
+  changed = false;
+  state.newInvalidCosts = 0;
+  MappedFile file(filePath);
+  if (!file.IsOpen())
+  {
+    return false;
+  }
+
+  std::string_view data = file.View();
+  if (HasGzipMagic(data))
+  {
+    // 圧縮された latest.log には追記できないので、変わっていれば全体を展開して読み直す
+    uint64_t headHash = XxHash64(data.data(), std::min<size_t>(data.size(), kTailHeadSpan));
+    if (data.size() == state.offset && headHash == state.headHash)
+    {
+      return true;
+    }
+    state = TailState();
+    PurchaseStreamScanner scanner;
+    scanner.SetCatalog(catalog);
+    GzipReader reader(data);
+    size_t readBytes;
+    while ((readBytes = reader.Read(scanner.WritePointer(), scanner.WritableSize())) > 0)
+    {
+      scanner.Commit(readBytes);
+    }
+    state.purchases = scanner.Purchases();
+    state.newInvalidCosts = scanner.Purchases().InvalidCostCount();
+    state.remainder = scanner.Pending();
+    state.clock = scanner.Clock();
+    state.offset = data.size();
+    state.headHash = headHash;
+    changed = true;
+    return true;
+  }
+  if (data.size() < state.offset || (state.offset > 0 && XxHash64(data.data(), std::min<size_t>(
+                                                                                     state.offset, kTailHeadSpan)) !=
+                                                              state.headHash))
+  {
+    state = TailState();
+    changed = true;
+  }
+  if (data.size() == state.offset)
+  {
+    return true;
+  }
+
+  PurchaseStreamScanner scanner;
+  scanner.SetCatalog(catalog);
+  scanner.SetClock(state.clock);
+  scanner.Feed(state.remainder);
+  scanner.Feed(data.substr(state.offset));
+
+  state.purchases.Append(scanner.Purchases());
+  state.newInvalidCosts = scanner.Purchases().InvalidCostCount();
+  state.remainder = scanner.Pending();
+  state.clock = scanner.Clock();
+  state.offset = data.size();
+  state.headHash = XxHash64(data.data(), std::min<size_t>(data.size(), kTailHeadSpan));
+  changed = true;
+  return true;
+}
+
+PurchaseColumns TailPurchases(const TailState &state, const ItemCatalog &catalog)
+{
+  PurchaseColumns purchases = state.purchases;
+  LineClock clock = state.clock;
+  ExtractPurchases(state.remainder, catalog, purchases, clock);
+  return purchases;
+}
+
+bool TailStateStore::Load(const std::filesystem::path &statePath, uint64_t catalogHash)
+{
+  std::string data;
+  if (!ReadBinaryFile(statePath, data))
+  {
+    return false;
+  }
+  std::string_view in = data;
+
+  uint64_t hash;
+  uint32_t parserVersion;
+  uint32_t count;
+  if (!in.starts_with(kMagic) || (in.remove_prefix(kMagic.size()), !ReadValue(in, hash)) || hash != catalogHash ||
+      !ReadValue(in, parserVersion) || parserVersion != kPurchaseParserVersion || !ReadValue(in, count))
+  {
+    return false;
+  }
+
+  std::unordered_map<std::string, TailState> states;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    uint32_t pathSize;
+    if (!ReadValue(in, pathSize) || in.size() < pathSize)
+    {
+      return false;
+    }
+    std::string path(in.substr(0, pathSize));
+    in.remove_prefix(pathSize);
+
+    TailState state;
+    uint32_t remainderSize;
+    if (!ReadValue(in, state.offset) || !ReadValue(in, state.headHash) || !ReadValue(in, state.clock.previous) ||
+        !ReadValue(in, state.clock.rollovers) || !ReadValue(in, remainderSize) || in.size() < remainderSize)
+    {
+      return false;
+    }
+    state.remainder = in.substr(0, remainderSize);
+    in.remove_prefix(remainderSize);
+    if (!ReadPurchases(in, state.purchases))
+    {
+      return false;
+    }
+    states[path] = std::move(state);
+  }
+
+  states_ = std::move(states);
+  return true;
+}
+
+bool TailStateStore::Save(const std::filesystem::path &statePath, uint64_t catalogHash) const
+{
+  std::string out(kMagic);
+  AppendValue(out, catalogHash);
+  AppendValue(out, kPurchaseParserVersion);
+  AppendValue(out, static_cast<uint32_t>(states_.size()));
+  for (const auto &[path, state] : states_)
+  {
+    AppendValue(out, static_cast<uint32_t>(path.size()));
+    out += path;
+    AppendValue(out, state.offset);
+    AppendValue(out, state.headHash);
+    AppendValue(out, state.clock.previous);
+    AppendValue(out, state.clock.rollovers);
+    AppendValue(out, static_cast<uint32_t>(state.remainder.size()));
+    out += state.remainder;
+    AppendPurchases(out, state.purchases);
+  }
+  return WriteBinaryFileAtomically(statePath, out);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "ItemCatalog.h"
+#include "Purchase.h"
+
+/**
+ * 追記され続ける latest.log をどこまで読んだか
+ */
+struct TailState
+{
+  // 読み終えたバイト数
+  uint64_t offset = 0;
+  // 先頭 kTailHeadSpan バイトの XXH64（ゲームの再起動で作り直されたかの判定用）
+  uint64_t headHash = 0;
+  // 行の途中で止まっている部分
+  std::string remainder;
+  // offset までの行の時刻（続きの行の日付の変わり目を数えるため）
+  LineClock clock;
+  // offset までに見つかった購入データ
+  PurchaseColumns purchases;
+  // 直前の ScanAppended で新しく読んだ部分の、コストが読めず 0 コインとして数えた購入の件数（保存しない）
+  size_t newInvalidCosts = 0;
+};
+
+constexpr size_t kTailHeadSpan = 4096;
+
+/**
+ * 増分読み込みの対象か（latest.log、名前だけで判定してファイルは開かない）
+ */
+bool IsTailTarget(const std::string &filePath);
+
+/**
+ * 前回の続きから latest.log を catalog の品目について走査する関数（開けなければ false）
+ * ファイルが縮んだり先頭が変わったりしていれば、新しいファイルとして最初から読み直す
+ * gzip で圧縮されていれば（マップした先頭のマジックナンバーで判定する）、変わるたびに全体を展開して読み直す
+ * changed には読み込み位置が変わったかが入る
+ */
+bool ScanAppended(const std::string &filePath, const ItemCatalog &catalog, TailState &state, bool &changed);
+
+/**
+ * 今の時点での latest.log の購入データ（最後の行が途中でも、そこまでを1行として扱う）
+ */
+PurchaseColumns TailPurchases(const TailState &state, const ItemCatalog &catalog);
+
+/**
+ * latest.log ごとの TailState を保存しておくファイル
+ *
+ * ファイル形式（リトルエンディアン）:
+ *   "JPT5" | 品目表のハッシュ u64 | 抽出規則の版 u32（kPurchaseParserVersion） | エントリー数 u32 |
+ *   エントリー: パス長 u32 | パス | offset u64 | headHash u64 | 直前の行の時刻 i32 | 日付をまたいだ回数 i32 |
+ *               残り長 u32 | 残り | 購入データ（AppendPurchases）
+ */
+class TailStateStore
+{
+public:
+  /**
+   * 保存ファイルを読み込む（無い・壊れている・別の品目表や別の抽出規則で走査したものなら空のまま false）
+   */
+  bool Load(const std::filesystem::path &statePath, uint64_t catalogHash);
+
+  bool Save(const std::filesystem::path &statePath, uint64_t catalogHash) const;
+
+  TailState &Get(const std::string &filePath)
+  {
+    return states_[filePath];
+  }
+
+private:
+  static constexpr std::string_view kMagic = "JPT5";
+
+  std::unordered_map<std::string, TailState> states_;
+};
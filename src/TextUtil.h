@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string_view>
+
+/**
+ * 前後の空白とタブ（末尾は行末の CR も）を取り除いた部分を返す関数
+ * 品目の表と HTTP のヘッダーのように、行ごとに読むテキストで使う
+ */
+inline std::string_view Trim(std::string_view text)
+{
+  while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+  {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r'))
+  {
+    text.remove_suffix(1);
+  }
+  return text;
+}
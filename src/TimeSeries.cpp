@@ -0,0 +1,253 @@
+#include "TimeSeries.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+
+#include "Format.h"
+
+namespace
+{
+
+int64_t FloorDiv(int64_t value, int64_t divisor)
+{
+  return value / divisor - (value % divisor < 0);
+}
+
+int32_t DayFromDate(int year, unsigned month, unsigned day)
+{
+  std::chrono::sys_days date = std::chrono::year_month_day{std::chrono::year{year}, std::chrono::month{month},
+                                                           std::chrono::day{day}};
+  return static_cast<int32_t>(date.time_since_epoch().count());
+}
+
+/**
+ * "YYYY-MM-DD" で始まるファイル名から日付を読み取る関数
+ */
+bool ParseFileNameDay(std::string_view name, int32_t &day)
+{
+  auto digits = [&](size_t begin, size_t count, int &value) {
+    value = 0;
+    for (size_t i = begin; i < begin + count; i++)
+    {
+      if (name[i] < '0' || name[i] > '9')
+      {
+        return false;
+      }
+      value = value * 10 + (name[i] - '0');
+    }
+    return true;
+  };
+
+  int year;
+  int month;
+  int date;
+  if (name.size() < 10 || name[4] != '-' || name[7] != '-' || !digits(0, 4, year) || !digits(5, 2, month) ||
+      !digits(8, 2, date))
+  {
+    return false;
+  }
+  std::chrono::year_month_day ymd{std::chrono::year{year}, std::chrono::month{static_cast<unsigned>(month)},
+                                  std::chrono::day{static_cast<unsigned>(date)}};
+  if (!ymd.ok())
+  {
+    return false;
+  }
+  day = static_cast<int32_t>(std::chrono::sys_days(ymd).time_since_epoch().count());
+  return true;
+}
+
+void PrintRow(std::ostream &out, const std::string &label, const PurchaseSummary &summary, const ItemCatalog &catalog,
+              long long recombobulatorPrice)
+{
+  bool multipleFamilies = catalog.Families().size() > 1;
+  for (const auto &family : catalog.Families())
+  {
+    long long count = family.PurchaseCount(summary);
+    if (multipleFamilies && count == 0 && family.TotalCost(summary) == 0)
+    {
+      continue;
+    }
+    const std::string &base = family.tiers.front().name;
+    long long price = family.PricePerBase(summary, recombobulatorPrice);
+    // 行数が多くなるので、文字列を作らずに書き込み先のバッファへ整形する
+    FormatBuffer coinsBuffer;
+    FormatBuffer numberBuffer;
+    out << label;
+    if (multipleFamilies)
+    {
+      out << "  " << family.name;
+    }
+    out << "  Purchases: " << count << "  " << base << ": " << family.BaseEquivalent(summary) << "  Per " << base
+        << ": " << FormatCoins(price, coinsBuffer) << " (" << FormatNumber(price, numberBuffer) << " coins)\n";
+  }
+}
+
+} // namespace
+
+bool LogFileDay(const std::string &filePath, int32_t &day)
+{
+  std::filesystem::path path(filePath);
+  if (ParseFileNameDay(path.filename().string(), day))
+  {
+    return true;
+  }
+
+  std::error_code ec;
+  std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, ec);
+  if (ec)
+  {
+    return false;
+  }
+  std::time_t time = std::chrono::system_clock::to_time_t(
+      std::chrono::time_point_cast<std::chrono::system_clock::duration>(std::chrono::file_clock::to_sys(writeTime)));
+  std::tm local{};
+#ifdef _WIN32
+  if (localtime_s(&local, &time) != 0)
+#else
+  if (!localtime_r(&time, &local))
+#endif
+  {
+    return false;
+  }
+  day = DayFromDate(local.tm_year + 1900, static_cast<unsigned>(local.tm_mon + 1), static_cast<unsigned>(local.tm_mday));
+  return true;
+}
+
+bool ParseDay(std::string_view text, int32_t &day)
+{
+  return text.size() == 10 && ParseFileNameDay(text, day);
+}
+
+std::string FormatDay(int32_t day)
+{
+  std::chrono::year_month_day ymd{std::chrono::sys_days(std::chrono::days(day))};
+  char text[16];
+  std::snprintf(text, sizeof(text), "%04d-%02u-%02u", static_cast<int>(ymd.year()), static_cast<unsigned>(ymd.month()),
+                static_cast<unsigned>(ymd.day()));
+  return text;
+}
+
+void PurchaseTimeSeries::Day::Add(size_t hour, uint8_t kind, long long count, long long cost)
+{
+  auto it = std::lower_bound(cells.begin(), cells.end(), std::pair<size_t, uint8_t>(hour, kind),
+                             [](const Cell &cell, const std::pair<size_t, uint8_t> &key) {
+                               return cell.hour < key.first || (cell.hour == key.first && cell.kind < key.second);
+                             });
+  if (it == cells.end() || it->hour != hour || it->kind != kind)
+  {
+    it = cells.insert(it, {static_cast<uint8_t>(hour), kind, 0, 0});
+  }
+  it->count += count;
+  it->cost += cost;
+}
+
+PurchaseSummary PurchaseTimeSeries::Day::Hour(size_t hour) const
+{
+  PurchaseSummary summary;
+  for (const auto &cell : cells)
+  {
+    if (cell.hour == hour)
+    {
+      summary.counts[cell.kind] += cell.count;
+      summary.costs[cell.kind] += cell.cost;
+    }
+  }
+  return summary;
+}
+
+PurchaseSummary PurchaseTimeSeries::Day::Total() const
+{
+  PurchaseSummary total;
+  for (const auto &cell : cells)
+  {
+    total.counts[cell.kind] += cell.count;
+    total.costs[cell.kind] += cell.cost;
+  }
+  return total;
+}
+
+void PurchaseTimestamps(const PurchaseColumns &purchases, int32_t lastDay, std::vector<int64_t> &timestamps)
+{
+  const std::vector<int32_t> &times = purchases.Times();
+
+  // 時刻は走査したときに、すべての行の時刻から数えた日付の変わり目を含めてあるので、最初の行の日付を足すだけで済む
+  int64_t firstDayStart = (static_cast<int64_t>(lastDay) - purchases.DayRollovers()) * kSecondsPerDay;
+  timestamps.resize(times.size());
+  for (size_t i = 0; i < times.size(); i++)
+  {
+    timestamps[i] = times[i] == kNoTime ? kNoTimestamp : firstDayStart + times[i];
+  }
+}
+
+void PurchaseTimeSeries::AddFile(const PurchaseColumns &purchases, int32_t lastDay)
+{
+  // ファイルごとに確保し直さないよう、スレッドごとに使い回す
+  thread_local std::vector<int64_t> timestamps;
+  PurchaseTimestamps(purchases, lastDay, timestamps);
+
+  Day *bucket = nullptr;
+  int64_t bucketDay = 0;
+  for (size_t i = 0; i < purchases.Size(); i++)
+  {
+    if (timestamps[i] == kNoTimestamp)
+    {
+      untimed_.Add(purchases[i]);
+      continue;
+    }
+    int64_t day = FloorDiv(timestamps[i], kSecondsPerDay);
+    if (!bucket || day != bucketDay)
+    {
+      bucket = &days_[static_cast<int32_t>(day)];
+      bucketDay = day;
+    }
+    bucket->Add(static_cast<size_t>((timestamps[i] - day * kSecondsPerDay) / 3600), purchases.Kinds()[i], 1,
+                purchases.Costs()[i]);
+  }
+}
+
+void PurchaseTimeSeries::Merge(const PurchaseTimeSeries &other)
+{
+  for (const auto &[day, bucket] : other.days_)
+  {
+    Day &target = days_[day];
+    for (const auto &cell : bucket.cells)
+    {
+      target.Add(cell.hour, cell.kind, cell.count, cell.cost);
+    }
+  }
+  untimed_.Merge(other.untimed_);
+}
+
+void PrintTimeSeries(std::ostream &out, const PurchaseTimeSeries &series, SeriesInterval interval,
+                     const ItemCatalog &catalog, long long recombobulatorPrice)
+{
+  out << "\n========= Price Series (" << (interval == SeriesInterval::HOUR ? "hour" : "day") << ") =========\n";
+  for (const auto &[day, bucket] : series.Days())
+  {
+    if (interval != SeriesInterval::HOUR)
+    {
+      PrintRow(out, FormatDay(day), bucket.Total(), catalog, recombobulatorPrice);
+      continue;
+    }
+    // cells は時間帯の順なので、購入のあった時間帯だけを順に表示する
+    for (size_t i = 0; i < bucket.cells.size();)
+    {
+      size_t hour = bucket.cells[i].hour;
+      while (i < bucket.cells.size() && bucket.cells[i].hour == hour)
+      {
+        i++;
+      }
+      char label[8];
+      std::snprintf(label, sizeof(label), " %02zu:00", hour);
+      PrintRow(out, FormatDay(day) + label, bucket.Hour(hour), catalog, recombobulatorPrice);
+    }
+  }
+  if (series.Untimed().PurchaseCount() > 0)
+  {
+    PrintRow(out, "(no time)", series.Untimed(), catalog, recombobulatorPrice);
+  }
+  out << "=============================================" << std::endl;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ItemCatalog.h"
+#include "Purchase.h"
+
+/**
+ * ログファイルの日付（1970-01-01 からの日数）を求める関数（分からなければ false）
+ * ローテーション済みのログは名前の YYYY-MM-DD-N.log.gz から、それ以外は更新日時（ローカル時刻）から求める
+ * どちらもそのログに最後に書き込まれた日付になる
+ */
+bool LogFileDay(const std::string &filePath, int32_t &day);
+
+/**
+ * YYYY-MM-DD の形式の日付を読み取る関数
+ */
+bool ParseDay(std::string_view text, int32_t &day);
+
+/**
+ * 日付を YYYY-MM-DD の形式にする関数
+ */
+std::string FormatDay(int32_t day);
+
+// 日時が分からない購入データの PurchaseTimestamps の値
+constexpr int64_t kNoTimestamp = INT64_MIN;
+
+/**
+ * 1ファイル分の購入データそれぞれの日時（1970-01-01 0時からの秒数、ローカル時刻）を求める関数
+ * lastDay はファイルの最後の行の日付で、そこから PurchaseColumns::DayRollovers の日数だけ遡った日を時刻の起点にする
+ * （日付の変わり目は走査したときに、購入の無い行も含めたすべての行の時刻が戻ったところで数えてある）
+ * 時刻の無い購入データは kNoTimestamp になる
+ */
+void PurchaseTimestamps(const PurchaseColumns &purchases, int32_t lastDay, std::vector<int64_t> &timestamps);
+
+/**
+ * 購入データを日ごと・時間ごとに集計した時系列
+ * ファイルを加えると、そのファイルに含まれる日のバケットだけが更新される
+ */
+class PurchaseTimeSeries
+{
+public:
+  /**
+   * 1日分のバケット
+   * 時間帯ごとに PurchaseSummary を持つと1日で 24KB 余りになり、ワーカーごとに何年分も持つことになるので、
+   * 購入のあった時間帯と種類の組み合わせだけを持つ
+   */
+  struct Day
+  {
+    struct Cell
+    {
+      // 0時台から23時台まで
+      uint8_t hour;
+      uint8_t kind;
+      long long count;
+      long long cost;
+    };
+    // (hour, kind) の順に並べる
+    std::vector<Cell> cells;
+
+    void Add(size_t hour, uint8_t kind, long long count, long long cost);
+
+    /**
+     * hour 時台の集計（購入が無ければ空の集計）
+     */
+    PurchaseSummary Hour(size_t hour) const;
+
+    PurchaseSummary Total() const;
+  };
+
+  /**
+   * 1ファイル分の購入データを PurchaseTimestamps の日時で振り分けて加える（lastDay はファイルの日付）
+   * 時刻の無い購入データは Untimed() に加える
+   */
+  void AddFile(const PurchaseColumns &purchases, int32_t lastDay);
+
+  /**
+   * 日付の分からないファイルの購入データを Untimed() に加える
+   */
+  void AddUntimed(const PurchaseColumns &purchases)
+  {
+    untimed_.Add(purchases);
+  }
+
+  void Merge(const PurchaseTimeSeries &other);
+
+  const std::map<int32_t, Day> &Days() const
+  {
+    return days_;
+  }
+
+  const PurchaseSummary &Untimed() const
+  {
+    return untimed_;
+  }
+
+private:
+  std::map<int32_t, Day> days_;
+  PurchaseSummary untimed_;
+};
+
+/**
+ * 時系列の表示単位
+ */
+enum class SeriesInterval
+{
+  NONE,
+  DAY,
+  HOUR
+};
+
+/**
+ * 日ごと（HOUR なら時間ごと）の購入件数と、系統の最初の段階1個あたりの平均価格を表示する関数
+ * 購入の無い時間帯は表示しない（系統が複数ある場合は、購入のある系統だけを系統名付きで表示する）
+ */
+void PrintTimeSeries(std::ostream &out, const PurchaseTimeSeries &series, SeriesInterval interval,
+                     const ItemCatalog &catalog, long long recombobulatorPrice);
@@ -0,0 +1,66 @@
+#include "WorkStealing.h"
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+void RunWorkStealing(size_t workerCount, const std::vector<size_t> &order,
+                     const std::function<void(size_t worker, size_t index)> &task)
+{
+  workerCount = std::max<size_t>(1, std::min(workerCount, order.size()));
+
+  struct WorkQueue
+  {
+    std::mutex mutex;
+    std::deque<size_t> items;
+  };
+  std::vector<WorkQueue> queues(workerCount);
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    queues[i % workerCount].items.push_back(order[i]);
+  }
+
+  auto popOwn = [&](size_t worker, size_t &index) {
+    std::lock_guard<std::mutex> lock(queues[worker].mutex);
+    if (queues[worker].items.empty())
+      return false;
+    index = queues[worker].items.front();
+    queues[worker].items.pop_front();
+    return true;
+  };
+  auto steal = [&](size_t worker, size_t &index) {
+    for (size_t offset = 1; offset < workerCount; offset++)
+    {
+      WorkQueue &victim = queues[(worker + offset) % workerCount];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.items.empty())
+      {
+        index = victim.items.back();
+        victim.items.pop_back();
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // タスクは実行中に増えないので、全キューが空になった時点で終了してよい
+  auto work = [&](size_t worker) {
+    size_t index;
+    while (popOwn(worker, index) || steal(worker, index))
+    {
+      task(worker, index);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t worker = 1; worker < workerCount; worker++)
+  {
+    threads.emplace_back(work, worker);
+  }
+  work(0);
+  for (auto &thread : threads)
+  {
+    thread.join();
+  }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/**
+ * ワークスティーリング方式でタスクを並列実行する関数
+ * order の順にタスクを各ワーカーのキューへ配り、自分のキューが空になったワーカーは他のキューの末尾から盗む
+ * task(worker, index) の worker は 0 から workerCount - 1 までのワーカー番号
+ */
+void RunWorkStealing(size_t workerCount, const std::vector<size_t> &order,
+                     const std::function<void(size_t worker, size_t index)> &task);
@@ -0,0 +1,154 @@
+#include "XxHash.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace
+{
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+uint64_t Read64(const unsigned char *p)
+{
+  uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint32_t Read32(const unsigned char *p)
+{
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+uint64_t Round(uint64_t acc, uint64_t lane)
+{
+  return std::rotl(acc + lane * kPrime2, 31) * kPrime1;
+}
+
+uint64_t MergeRound(uint64_t acc, uint64_t lane)
+{
+  return (acc ^ Round(0, lane)) * kPrime1 + kPrime4;
+}
+
+/**
+ * 4本のレーンをまとめた値（入力が32バイト以上の場合）
+ */
+uint64_t MergeLanes(const uint64_t (&lanes)[4])
+{
+  uint64_t hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+  for (uint64_t lane : lanes)
+  {
+    hash = MergeRound(hash, lane);
+  }
+  return hash;
+}
+
+/**
+ * 32バイト未満の残りを混ぜて仕上げる
+ */
+uint64_t Finalize(uint64_t hash, const unsigned char *p, const unsigned char *end)
+{
+  for (; p + 8 <= end; p += 8)
+  {
+    hash = std::rotl(hash ^ Round(0, Read64(p)), 27) * kPrime1 + kPrime4;
+  }
+  if (p + 4 <= end)
+  {
+    hash = std::rotl(hash ^ (Read32(p) * kPrime1), 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; p++)
+  {
+    hash = std::rotl(hash ^ (*p * kPrime5), 11) * kPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+} // namespace
+
+uint64_t XxHash64(const void *input, size_t size, uint64_t seed)
+{
+  const unsigned char *p = static_cast<const unsigned char *>(input);
+  const unsigned char *end = p + size;
+  uint64_t hash;
+
+  if (size >= 32)
+  {
+    uint64_t lanes[4] = {seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1};
+    for (; p + 32 <= end; p += 32)
+    {
+      for (size_t lane = 0; lane < 4; lane++)
+      {
+        lanes[lane] = Round(lanes[lane], Read64(p + lane * 8));
+      }
+    }
+    hash = MergeLanes(lanes);
+  }
+  else
+  {
+    hash = seed + kPrime5;
+  }
+
+  hash += size;
+  return Finalize(hash, p, end);
+}
+
+XxHash64Stream::XxHash64Stream(uint64_t seed)
+    : seed_(seed), lanes_{seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1}
+{
+}
+
+void XxHash64Stream::Update(const void *input, size_t size)
+{
+  const unsigned char *p = static_cast<const unsigned char *>(input);
+  const unsigned char *end = p + size;
+  totalSize_ += size;
+
+  if (buffered_ > 0)
+  {
+    size_t copy = std::min(size, sizeof(buffer_) - buffered_);
+    std::memcpy(buffer_ + buffered_, p, copy);
+    buffered_ += copy;
+    p += copy;
+    if (buffered_ < sizeof(buffer_))
+    {
+      return;
+    }
+    for (size_t lane = 0; lane < 4; lane++)
+    {
+      lanes_[lane] = Round(lanes_[lane], Read64(buffer_ + lane * 8));
+    }
+    buffered_ = 0;
+  }
+
+  for (; p + 32 <= end; p += 32)
+  {
+    for (size_t lane = 0; lane < 4; lane++)
+    {
+      lanes_[lane] = Round(lanes_[lane], Read64(p + lane * 8));
+    }
+  }
+
+  std::memcpy(buffer_, p, static_cast<size_t>(end - p));
+  buffered_ = static_cast<size_t>(end - p);
+}
+
+uint64_t XxHash64Stream::Digest() const
+{
+  uint64_t hash = totalSize_ >= 32 ? MergeLanes(lanes_) : seed_ + kPrime5;
+  hash += totalSize_;
+  return Finalize(hash, buffer_, buffer_ + buffered_);
+}
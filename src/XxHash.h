@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * XXH64 ハッシュを計算する関数
+ */
+uint64_t XxHash64(const void *input, size_t size, uint64_t seed = 0);
+
+/**
+ * 少しずつ渡されるデータの XXH64 を計算するクラス
+ * 全体を XxHash64 に渡した場合と同じ値になる
+ */
+class XxHash64Stream
+{
+public:
+  explicit XxHash64Stream(uint64_t seed = 0);
+
+  void Update(const void *input, size_t size);
+
+  uint64_t Digest() const;
+
+private:
+  uint64_t seed_;
+  uint64_t lanes_[4];
+  // 32バイトに満たずにまだ混ぜていない入力
+  unsigned char buffer_[32];
+  size_t buffered_ = 0;
+  uint64_t totalSize_ = 0;
+};
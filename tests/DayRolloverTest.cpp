@@ -0,0 +1,206 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <zlib.h>
+
+#include "GzipDecoder.h"
+#include "ItemCatalog.h"
+#include "PurchaseDedup.h"
+#include "PurchaseScanner.h"
+#include "TailState.h"
+#include "TimeSeries.h"
+
+namespace
+{
+
+// 3日にまたがるログの最後の行の日付
+constexpr std::string_view kLastDay = "2024-05-03";
+
+/**
+ * 3日にまたがり、購入が1日目と3日目にしかないログ
+ * 2日目に日付が変わったことは購入の無い行の時刻からしか分からない
+ */
+constexpr std::string_view kMultiDayLog =
+    "[22:00:00] [Client thread/INFO]: [CHAT] Welcome to Hypixel SkyBlock!\n"
+    "[22:10:00] [Client thread/INFO]: [CHAT] You purchased \xC2\xA7" "aGreen Jerry Talisman \xC2\xA7" "8x1 for "
+    "\xC2\xA7" "61,000 coins!\n"
+    "[23:59:59] [Client thread/INFO]: [CHAT] Guild > someone left.\n"
+    "[00:00:05] [Client thread/INFO]: [CHAT] Guild > someone joined.\n"
+    "[12:00:00] [Client thread/INFO]: [CHAT] Your Jerry Talisman is ready.\n"
+    "\n"
+    "[00:30:00] [Client thread/INFO]: [CHAT] Welcome to Hypixel SkyBlock!\r\n"
+    "no timestamp on this line\n"
+    "[09:00:00] [Client thread/INFO]: [CHAT] You purchased \xC2\xA7" "9Blue Jerry Talisman \xC2\xA7" "8x1 for "
+    "\xC2\xA7" "62,500 coins!\n"
+    "[09:00:01] [Client thread/INFO]: [CHAT] Bye\n";
+
+// latest.log に最初に書かれている部分の長さ（2日目の行の途中まで、続きは後から追記する）
+constexpr size_t kTailSplit = 320;
+
+/**
+ * kMultiDayLog の購入の、正しい日時（1970-01-01 0時からの秒数）
+ */
+std::vector<int64_t> ExpectedTimestamps()
+{
+  int32_t lastDay;
+  ParseDay(kLastDay, lastDay);
+  int64_t firstDay = static_cast<int64_t>(lastDay) - 2;
+  return {firstDay * kSecondsPerDay + 22 * 3600 + 10 * 60, (firstDay + 2) * kSecondsPerDay + 9 * 3600};
+}
+
+std::string DescribeTimestamps(const std::vector<int64_t> &timestamps)
+{
+  std::string text;
+  for (int64_t timestamp : timestamps)
+  {
+    text += (text.empty() ? "" : ", ") + std::to_string(timestamp);
+  }
+  return "[" + text + "]";
+}
+
+/**
+ * purchases が kMultiDayLog の2件で、日付をまたいだ回数と日時が正しいかを確かめる関数
+ */
+bool CheckPurchases(std::string_view source, const PurchaseColumns &purchases)
+{
+  int32_t lastDay;
+  ParseDay(kLastDay, lastDay);
+  std::vector<int64_t> timestamps;
+  PurchaseTimestamps(purchases, lastDay, timestamps);
+
+  std::vector<int64_t> expected = ExpectedTimestamps();
+  if (purchases.Size() != 2 || purchases.DayRollovers() != 2 || timestamps != expected)
+  {
+    std::cout << source << ": expected 2 purchases over 2 day rollovers at " << DescribeTimestamps(expected)
+              << ", got " << purchases.Size() << " over " << purchases.DayRollovers() << " at "
+              << DescribeTimestamps(timestamps) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+std::string Gzip(std::string_view data)
+{
+  z_stream stream{};
+  deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+  std::vector<unsigned char> buffer(deflateBound(&stream, static_cast<uLong>(data.size())));
+  stream.next_in = reinterpret_cast<unsigned char *>(const_cast<char *>(data.data()));
+  stream.avail_in = static_cast<unsigned>(data.size());
+  stream.next_out = buffer.data();
+  stream.avail_out = static_cast<unsigned>(buffer.size());
+  deflate(&stream, Z_FINISH);
+  std::string out(reinterpret_cast<const char *>(buffer.data()), stream.total_out);
+  deflateEnd(&stream);
+  return out;
+}
+
+bool WriteText(const std::filesystem::path &path, std::string_view text, std::ios::openmode mode)
+{
+  std::ofstream file(path, std::ios::binary | mode);
+  return static_cast<bool>(file.write(text.data(), text.size()));
+}
+
+/**
+ * 日付の変わり目を挟んで追記される latest.log を、保存した状態から読み直しながら追う
+ */
+bool CheckTail(const std::filesystem::path &directory)
+{
+  const ItemCatalog &catalog = ItemCatalog::Jerry();
+  std::filesystem::path logPath = directory / "latest.log";
+  std::filesystem::path statePath = directory / "tail.bin";
+  if (!WriteText(logPath, kMultiDayLog.substr(0, kTailSplit), std::ios::trunc))
+  {
+    std::cout << "could not write " << logPath.string() << std::endl;
+    return false;
+  }
+
+  TailStateStore store;
+  bool changed;
+  if (!ScanAppended(logPath.string(), catalog, store.Get(logPath.string()), changed) ||
+      !store.Save(statePath, catalog.Hash()))
+  {
+    std::cout << "tail: could not scan the first half" << std::endl;
+    return false;
+  }
+
+  TailStateStore reloaded;
+  if (!reloaded.Load(statePath, catalog.Hash()) ||
+      !WriteText(logPath, kMultiDayLog.substr(kTailSplit), std::ios::app) ||
+      !ScanAppended(logPath.string(), catalog, reloaded.Get(logPath.string()), changed))
+  {
+    std::cout << "tail: could not scan the appended half" << std::endl;
+    return false;
+  }
+  return CheckPurchases("tail", TailPurchases(reloaded.Get(logPath.string()), catalog));
+}
+
+/**
+ * 同じインスタンスの2つのログの3日目だけが重なるとき、重なった購入だけが重複になるか
+ */
+bool CheckDedup()
+{
+  const ItemCatalog &catalog = ItemCatalog::Jerry();
+  int32_t lastDay;
+  ParseDay(kLastDay, lastDay);
+
+  // 3日目の途中から始まるログ（日付をまたがないので、3日目の購入は全体のログと同じ日時になる）
+  std::string_view thirdDay = kMultiDayLog.substr(kMultiDayLog.find("[00:30:00]"));
+  PurchaseDeduplicator deduplicator;
+  PurchaseColumns kept;
+  deduplicator.Filter("Skyblock", lastDay, ExtractPurchases(kMultiDayLog, catalog), kept);
+  if (!CheckPurchases("dedup", kept))
+  {
+    return false;
+  }
+  deduplicator.Filter("Skyblock", lastDay, ExtractPurchases(thirdDay, catalog), kept);
+  if (!kept.Empty() || deduplicator.DuplicateCount() != 1)
+  {
+    std::cout << "dedup: expected the third day's purchase to be a duplicate, kept " << kept.Size() << " and removed "
+              << deduplicator.DuplicateCount() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+/**
+ * 購入がまばらな数日分のログで、購入の無い行で日付が変わっても正しい日付になるかを確かめるテスト
+ * 一度に走査・1バイトずつのストリーム・gzip・latest.log の増分読み込み・重複の除去のどれでも同じ日時になること
+ */
+int main()
+{
+  const ItemCatalog &catalog = ItemCatalog::Jerry();
+  bool ok = CheckPurchases("scan", ExtractPurchases(kMultiDayLog, catalog));
+
+  PurchaseStreamScanner scanner(64);
+  for (char c : kMultiDayLog)
+  {
+    scanner.Feed(std::string_view(&c, 1));
+  }
+  scanner.Finish();
+  ok = CheckPurchases("stream", scanner.Purchases()) && ok;
+
+  std::unique_ptr<GzipDecoder> decoder = CreateGzipDecoder(InflateBackend::ZLIB);
+  PurchaseColumns inflated;
+  ExtractPurchasesFromData(Gzip(kMultiDayLog), *decoder, catalog, inflated);
+  ok = CheckPurchases("gzip", inflated) && ok;
+
+  std::error_code ec;
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "JerryParserDayRolloverTest";
+  std::filesystem::create_directories(directory, ec);
+  ok = CheckTail(directory) && ok;
+  std::filesystem::remove_all(directory, ec);
+
+  ok = CheckDedup() && ok;
+
+  std::cout << (ok ? "Day rollovers on lines without purchases are counted" : "Day rollover check failed")
+            << std::endl;
+  return ok ? 0 : 1;
+}
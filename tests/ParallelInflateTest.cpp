@@ -0,0 +1,205 @@
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <zlib.h>
+
+#include "GzipDecoder.h"
+#include "ItemCatalog.h"
+#include "LogFile.h"
+#include "LogGenerator.h"
+#include "ParallelInflate.h"
+#include "PurchaseScanner.h"
+
+namespace
+{
+
+// 区切りを小さくして、数 MB のデータでも多数の区切りと推測の失敗を通す
+constexpr size_t kChunkSizes[] = {16 << 10, 64 << 10};
+constexpr size_t kThreadCounts[] = {1, 2, 4};
+
+std::string Gzip(std::string_view data, int level, int strategy, gz_header *header = nullptr)
+{
+  z_stream stream{};
+  deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, strategy);
+  if (header)
+  {
+    deflateSetHeader(&stream, header);
+  }
+  std::vector<unsigned char> buffer(deflateBound(&stream, static_cast<uLong>(data.size())) + 1024);
+  stream.next_in = reinterpret_cast<unsigned char *>(const_cast<char *>(data.data()));
+  stream.avail_in = static_cast<unsigned>(data.size());
+  stream.next_out = buffer.data();
+  stream.avail_out = static_cast<unsigned>(buffer.size());
+  deflate(&stream, Z_FINISH);
+  std::string out(reinterpret_cast<const char *>(buffer.data()), stream.total_out);
+  deflateEnd(&stream);
+  return out;
+}
+
+std::string RandomBytes(size_t size, uint32_t seed)
+{
+  std::mt19937 random(seed);
+  std::string bytes(size, '\0');
+  for (char &c : bytes)
+  {
+    c = static_cast<char>(random());
+  }
+  return bytes;
+}
+
+/**
+ * zlib（GzipReader）で展開した結果（壊れたデータは、そこまでに展開できた分）
+ */
+std::string InflateWithZlib(std::string_view data, bool &complete)
+{
+  GzipReader reader(data);
+  std::string out;
+  std::vector<char> buffer(1 << 16);
+  size_t readBytes;
+  while ((readBytes = reader.Read(buffer.data(), buffer.size())) > 0)
+  {
+    out.append(buffer.data(), readBytes);
+  }
+  complete = !reader.Failed() && reader.Complete();
+  return out;
+}
+
+/**
+ * 1つのメンバーだけの data を、区切りの大きさとスレッドの数を変えて展開し、zlib と同じ結果になるか
+ */
+bool CheckInflate(std::string_view name, std::string_view data)
+{
+  bool complete;
+  std::string expected = InflateWithZlib(data, complete);
+  bool ok = true;
+  for (size_t chunkSize : kChunkSizes)
+  {
+    for (size_t threads : kThreadCounts)
+    {
+      ParallelInflater inflater(threads, chunkSize);
+      std::string actual;
+      ParallelInflateResult result = inflater.Inflate(data, [&](std::string_view part) { actual.append(part); });
+      if (actual != expected || result.complete != complete || (complete && result.consumed != data.size()))
+      {
+        std::cout << name << " (chunk " << chunkSize << ", " << threads << " threads): expected " << expected.size()
+                  << " bytes" << (complete ? "" : " (incomplete)") << ", got " << actual.size() << " bytes"
+                  << (result.complete ? "" : " (incomplete)") << (actual == expected ? "" : " that differ")
+                  << std::endl;
+        ok = false;
+      }
+    }
+  }
+  return ok;
+}
+
+/**
+ * 様々な圧縮の仕方と、壊れたデータや途中で切れたデータ
+ */
+bool CheckStreams()
+{
+  LogGeneratorOptions options;
+  options.size = 2 * 1024 * 1024;
+  options.seed = 3;
+  std::string log = GenerateSyntheticLog(options);
+  bool ok = true;
+
+  for (int level : {1, 6, 9})
+  {
+    ok = CheckInflate("level " + std::to_string(level), Gzip(log, level, Z_DEFAULT_STRATEGY)) && ok;
+  }
+  ok = CheckInflate("filtered", Gzip(log, 6, Z_FILTERED)) && ok;
+  ok = CheckInflate("huffman only", Gzip(log, 6, Z_HUFFMAN_ONLY)) && ok;
+  ok = CheckInflate("rle", Gzip(log, 6, Z_RLE)) && ok;
+  ok = CheckInflate("fixed", Gzip(log, 6, Z_FIXED)) && ok;
+
+  // 圧縮できないデータは無圧縮ブロックになり、中にブロックの見出しに見えるだけのビット列を多数含む
+  std::string random = RandomBytes(512 * 1024, 5);
+  ok = CheckInflate("random", Gzip(random, 6, Z_DEFAULT_STRATEGY)) && ok;
+  std::string mixed;
+  for (size_t i = 0; i < 16; i++)
+  {
+    mixed += random.substr(i * 32768, 32768);
+    mixed += log.substr(i * 65536, 65536);
+  }
+  ok = CheckInflate("mixed", Gzip(mixed, 6, Z_DEFAULT_STRATEGY)) && ok;
+  ok = CheckInflate("repetitive", Gzip(std::string(4 * 1024 * 1024, 'a'), 9, Z_DEFAULT_STRATEGY)) && ok;
+  ok = CheckInflate("empty", Gzip("", 6, Z_DEFAULT_STRATEGY)) && ok;
+
+  gz_header header{};
+  std::string extra = "extra field";
+  header.extra = reinterpret_cast<Bytef *>(extra.data());
+  header.extra_len = static_cast<uInt>(extra.size());
+  header.name = reinterpret_cast<Bytef *>(const_cast<char *>("latest.log"));
+  header.comment = reinterpret_cast<Bytef *>(const_cast<char *>("comment"));
+  header.hcrc = 1;
+  ok = CheckInflate("header fields", Gzip(log, 6, Z_DEFAULT_STRATEGY, &header)) && ok;
+
+  std::string compressed = Gzip(log, 6, Z_DEFAULT_STRATEGY);
+  for (size_t divisor : {3, 2})
+  {
+    std::string corrupt = compressed;
+    corrupt[corrupt.size() / divisor] ^= 0x55;
+    ok = CheckInflate("corrupt at 1/" + std::to_string(divisor), corrupt) && ok;
+    ok = CheckInflate("truncated at 1/" + std::to_string(divisor), compressed.substr(0, compressed.size() / divisor)) &&
+         ok;
+  }
+  ok = CheckInflate("truncated trailer", compressed.substr(0, compressed.size() - 3)) && ok;
+  std::string badCrc = compressed;
+  badCrc[badCrc.size() - 8] ^= 1;
+  ok = CheckInflate("bad crc", badCrc) && ok;
+  return ok;
+}
+
+/**
+ * バックエンドとして、複数のメンバーと後ろのゴミを含むファイルから zlib と同じ購入を抽出するか
+ */
+bool CheckBackend()
+{
+  const ItemCatalog &catalog = ItemCatalog::Jerry();
+  std::unique_ptr<GzipDecoder> zlib = CreateGzipDecoder(InflateBackend::ZLIB);
+  std::unique_ptr<GzipDecoder> parallel = CreateGzipDecoder(InflateBackend::PARALLEL, 4);
+
+  LogGeneratorOptions options;
+  options.size = 8 * 1024 * 1024;
+  options.purchaseDensity = 0.01;
+  std::string first = GenerateSyntheticLog(options);
+  options.size = 1024 * 1024;
+  options.seed = 2;
+  std::string second = GenerateSyntheticLog(options);
+  std::string data = Gzip(first, 6, Z_DEFAULT_STRATEGY) + Gzip(second, 1, Z_DEFAULT_STRATEGY) + "trailing garbage";
+
+  bool ok = true;
+  for (std::string_view input : {std::string_view(data), std::string_view(data).substr(0, data.size() / 3)})
+  {
+    PurchaseColumns expected;
+    PurchaseColumns actual;
+    ExtractPurchasesFromData(input, *zlib, catalog, expected);
+    ExtractPurchasesFromData(input, *parallel, catalog, actual);
+    if (expected.Size() == 0 || actual.Kinds() != expected.Kinds() || actual.Costs() != expected.Costs() ||
+        actual.Times() != expected.Times() || actual.DayRollovers() != expected.DayRollovers())
+    {
+      std::cout << "backend (" << input.size() << " bytes): expected " << expected.Size() << " purchases, got "
+                << actual.Size() << (actual.Size() == expected.Size() ? " that differ" : "") << std::endl;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+} // namespace
+
+/**
+ * 1つの gzip メンバーを区切って並列に展開した結果が、zlib で先頭から展開した結果と同じになるかを確かめるテスト
+ */
+int main()
+{
+  bool ok = CheckStreams();
+  ok = CheckBackend() && ok;
+  std::cout << (ok ? "Parallel inflate matches zlib" : "Parallel inflate check failed") << std::endl;
+  return ok ? 0 : 1;
+}